@@ -0,0 +1,1188 @@
+// CTUI Benchmarks
+// Micro benchmarks of the hot library calls and macro benchmarks of frame
+// loops on the headless and terminal backends, reported as JSON and
+// optionally compared against an earlier run. The terminal benchmarks check
+// the terminal output against the layers after every sample; a mismatch
+// fails the benchmark and makes the exit status 1.
+//
+// usage: ctui_bench [--filter SUBSTRING] [--samples N] [--min-sample-ms MS]
+//                   [--json PATH] [--baseline PATH] [--threshold PERCENT]
+//                   [--work-dir DIR]
+
+#ifndef _WIN32
+// posix_openpt, grantpt, unlockpt and ptsname
+#define _XOPEN_SOURCE 600
+#endif
+
+#include <ctui/ctui.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/ioctl.h>
+#include <unistd.h>
+#endif
+
+#define BENCH_MAX_SAMPLES 64
+#define BENCH_NAME_LENGTH 64
+#define BENCH_MAX_RESULTS 64
+
+typedef struct TerminalModel TerminalModel;
+
+typedef struct BenchContext {
+  CTUI_Context *ctx;
+  CTUI_Console *console;
+  // set while a terminal benchmark runs
+  TerminalModel *terminal;
+  CTUI_Font *font;
+  const char *font_path;
+  const char *image_path;
+  CTUI_SVector2 console_tile_wh;
+  uint32_t rng;
+  size_t log_first_line;
+  // consumed results, so the timed work cannot be optimized out
+  volatile uint64_t sink;
+} BenchContext;
+
+typedef struct Benchmark {
+  const char *name;
+  // console size for benchmarks that need one, {0, 0} for none
+  CTUI_SVector2 console_tile_wh;
+  // runs op_count operations
+  void (*run)(BenchContext *bench, size_t op_count);
+  // 1 to run on the terminal backend over a pseudoterminal
+  int is_terminal;
+} Benchmark;
+
+typedef struct BenchResult {
+  char name[BENCH_NAME_LENGTH];
+  double ns_per_op;
+  double min_ns_per_op;
+  double max_ns_per_op;
+  size_t op_count;
+  size_t sample_count;
+} BenchResult;
+
+static uint32_t nextRandom(BenchContext *bench) {
+  // xorshift32, the same sequence on every run
+  uint32_t x = bench->rng;
+  x ^= x << 13;
+  x ^= x >> 17;
+  x ^= x << 5;
+  bench->rng = x;
+  return x;
+}
+
+// Atlas and font
+
+#define ATLAS_GLYPH_W 8
+#define ATLAS_GLYPH_H 8
+#define ATLAS_COLUMNS 16
+#define ATLAS_ROWS 16
+
+// Codepoints of the 256 atlas glyphs: ASCII, Latin-1 and, past the dense
+// range of the glyph table, box drawing and blocks.
+static uint32_t getAtlasCodepoint(size_t glyph_i) {
+  if (glyph_i < 192) {
+    return (uint32_t)(32 + glyph_i);
+  }
+  return (uint32_t)(0x2500 + (glyph_i - 192) * 2);
+}
+
+static int writeAtlasTga(const char *path) {
+  const size_t pixel_w = ATLAS_GLYPH_W * ATLAS_COLUMNS;
+  const size_t pixel_h = ATLAS_GLYPH_H * ATLAS_ROWS;
+  FILE *file = fopen(path, "wb");
+  if (file == NULL) {
+    return -1;
+  }
+  // uncompressed true color, 32 bits, top left origin
+  const uint8_t header[18] = {0,
+                              0,
+                              2,
+                              0,
+                              0,
+                              0,
+                              0,
+                              0,
+                              0,
+                              0,
+                              0,
+                              0,
+                              (uint8_t)(pixel_w & 0xFF),
+                              (uint8_t)(pixel_w >> 8),
+                              (uint8_t)(pixel_h & 0xFF),
+                              (uint8_t)(pixel_h >> 8),
+                              32,
+                              0x28};
+  fwrite(header, 1, sizeof(header), file);
+  for (size_t y = 0; y < pixel_h; y++) {
+    for (size_t x = 0; x < pixel_w; x++) {
+      // a pattern that differs per glyph, the contents do not matter
+      const size_t glyph_i = (y / ATLAS_GLYPH_H) * ATLAS_COLUMNS +
+                             x / ATLAS_GLYPH_W;
+      const uint8_t alpha =
+          ((x + y + glyph_i) % 3 == 0) ? 255 : 0;
+      const uint8_t bgra[4] = {255, 255, 255, alpha};
+      fwrite(bgra, 1, 4, file);
+    }
+  }
+  return fclose(file) == 0 ? 0 : -1;
+}
+
+static int writeCtuiFont(const char *path) {
+  FILE *file = fopen(path, "w");
+  if (file == NULL) {
+    return -1;
+  }
+  fprintf(file, "ctui_bench\n%d %d blend_fgbg\n", ATLAS_GLYPH_W,
+          ATLAS_GLYPH_H);
+  for (size_t glyph_i = 0; glyph_i < ATLAS_COLUMNS * ATLAS_ROWS; glyph_i++) {
+    const size_t x = (glyph_i % ATLAS_COLUMNS) * ATLAS_GLYPH_W;
+    const size_t y = (glyph_i / ATLAS_COLUMNS) * ATLAS_GLYPH_H;
+    fprintf(file, "%zu %zu %zu %zu 0 %u\n", x, x + ATLAS_GLYPH_W, y,
+            y + ATLAS_GLYPH_H, getAtlasCodepoint(glyph_i));
+  }
+  return fclose(file) == 0 ? 0 : -1;
+}
+
+static CTUI_Font *createBenchFont(BenchContext *bench) {
+  const char *image_paths[1] = {bench->image_path};
+  return CTUI_createFont(bench->font_path, image_paths, 1);
+}
+
+// Micro benchmarks
+
+static const char UTF8_TEXT[] =
+    "The quick brown fox jumps over the lazy dog. "
+    "\xc3\x9c"
+    "ber m\xc3\xa4"
+    "chtige Dr\xc3\xa4"
+    "chen \xe2\x94\x80\xe2\x94\x82\xe2\x94\x8c\xe2\x94\x90 "
+    "\xe6\x97\xa5\xe6\x9c\xac\xe8\xaa\x9e \xf0\x9f\x98\x80 end";
+
+static void runDecodeUtf8Cstr(BenchContext *bench, size_t op_count) {
+  uint64_t sum = 0;
+  const char *text = UTF8_TEXT;
+  for (size_t i = 0; i < op_count; i++) {
+    uint32_t codepoint = CTUI_decodeUtf8Cstr(&text);
+    if (codepoint == 0) {
+      text = UTF8_TEXT;
+      codepoint = CTUI_decodeUtf8Cstr(&text);
+    }
+    sum += codepoint;
+  }
+  bench->sink += sum;
+}
+
+static void runPushCstr(BenchContext *bench, size_t op_count) {
+  static const char *LINES[2] = {
+      "[12:00:01] INFO  request served in 3 ms, 200 OK, 1532 bytes sent",
+      "[12:00:02] WARN  request served in 9 ms, 404 Not Found, 0 bytes"};
+  CTUI_ConsoleLayer *layer = CTUI_getConsoleLayer(bench->console, 0);
+  const int height = (int)bench->console_tile_wh.y;
+  for (size_t i = 0; i < op_count; i++) {
+    CTUI_pushCstr(layer, LINES[i & 1], (CTUI_IVector2){0, (int)i % height}, 0,
+                  0, CTUI_RGBA(200, 200, 200, 255), CTUI_RGBA(0, 0, 0, 255));
+  }
+}
+
+static void runPushCodepoint(BenchContext *bench, size_t op_count) {
+  CTUI_ConsoleLayer *layer = CTUI_getConsoleLayer(bench->console, 0);
+  const size_t width = bench->console_tile_wh.x;
+  const size_t cell_count = width * bench->console_tile_wh.y;
+  for (size_t i = 0; i < op_count; i++) {
+    // the codepoint changes every pass, so each push is a real write
+    const size_t cell_i = i % cell_count;
+    const uint32_t codepoint = (uint32_t)('0' + (i / cell_count) % 10);
+    CTUI_pushCodepoint(layer, codepoint,
+                       (CTUI_IVector2){(int)(cell_i % width),
+                                       (int)(cell_i / width)},
+                       CTUI_RGBA(0, 255, 0, 255), CTUI_RGBA(0, 0, 0, 255));
+  }
+}
+
+static void runFill(BenchContext *bench, size_t op_count) {
+  CTUI_ConsoleLayer *layer = CTUI_getConsoleLayer(bench->console, 0);
+  for (size_t i = 0; i < op_count; i++) {
+    CTUI_fill(layer, (i & 1) ? '#' : ' ', CTUI_RGBA(255, 255, 255, 255),
+              CTUI_RGBA(0, 0, (uint8_t)i, 255));
+  }
+}
+
+static void runTryGetGlyphDense(BenchContext *bench, size_t op_count) {
+  uintptr_t sum = 0;
+  for (size_t i = 0; i < op_count; i++) {
+    sum += (uintptr_t)CTUI_tryGetGlyph(bench->font,
+                                       getAtlasCodepoint(i % 192));
+  }
+  bench->sink += sum;
+}
+
+static void runTryGetGlyphSparse(BenchContext *bench, size_t op_count) {
+  uintptr_t sum = 0;
+  for (size_t i = 0; i < op_count; i++) {
+    // every other codepoint is missing from the font
+    sum += (uintptr_t)CTUI_tryGetGlyph(bench->font,
+                                       (uint32_t)(0x2500 + i % 128));
+  }
+  bench->sink += sum;
+}
+
+static void runCreateFont(BenchContext *bench, size_t op_count) {
+  for (size_t i = 0; i < op_count; i++) {
+    CTUI_Font *font = createBenchFont(bench);
+    if (font == NULL) {
+      return;
+    }
+    CTUI_destroyFont(font);
+  }
+}
+
+static void runEventPushPop(BenchContext *bench, size_t op_count) {
+  CTUI_Event event = {0};
+  event.type = CTUI_EVENT_KEY;
+  event.console = bench->console;
+  event.data.key.action = CTUIA_PRESS;
+  uint64_t sum = 0;
+  for (size_t i = 0; i < op_count; i++) {
+    // bursts of 16 like a busy input frame
+    event.data.key.key = (CTUI_Key)(CTUIK_A + i % 26);
+    CTUI_pushEvent(bench->ctx, &event);
+    if ((i & 15) == 15 || i + 1 == op_count) {
+      CTUI_Event out;
+      while (CTUI_nextEvent(bench->ctx, &out)) {
+        sum += out.data.key.key;
+      }
+    }
+  }
+  bench->sink += sum;
+}
+
+// Macro benchmark: the matrix rain example frame, fed a fixed random sequence
+
+typedef struct Trail {
+  int alive;
+  int x;
+  int head;
+  int length;
+} Trail;
+
+static void runMatrixRain(BenchContext *bench, size_t op_count) {
+  const CTUI_SVector2 tile_wh = bench->console_tile_wh;
+  Trail *trails = calloc(tile_wh.x, sizeof(Trail));
+  if (trails == NULL) {
+    return;
+  }
+  CTUI_ConsoleLayer *layer0 = CTUI_getConsoleLayer(bench->console, 0);
+  CTUI_ConsoleLayer *layer1 = CTUI_getConsoleLayer(bench->console, 1);
+  const CTUI_Color black = CTUI_RGB(0, 0, 0);
+  const CTUI_Color red = CTUI_RGB(255, 85, 85);
+  for (size_t frame = 0; frame < op_count; frame++) {
+    CTUI_pollEvents(bench->ctx);
+    CTUI_Event event;
+    while (CTUI_nextEvent(bench->ctx, &event)) {
+    }
+    for (size_t i = 0; i < tile_wh.x; i++) {
+      Trail *trail = &trails[i];
+      if (!trail->alive) {
+        if (nextRandom(bench) % 50 == 0) {
+          trail->alive = 1;
+          trail->x = (int)i;
+          trail->head = 0;
+          trail->length = 5 + (int)(nextRandom(bench) % 50);
+        }
+      } else {
+        trail->head++;
+        if (trail->head - trail->length >= (int)tile_wh.y) {
+          trail->alive = 0;
+        }
+      }
+    }
+    CTUI_pushCstr(layer1, "Hello, and welcome to CTUI!", (CTUI_IVector2){1, 1},
+                  99, 0, red, black);
+    CTUI_pushCstr(layer1, "Press spacebar to start and stop time.",
+                  (CTUI_IVector2){1, 4}, 99, 0, red, black);
+    CTUI_fill(layer0, ' ', black, black);
+    for (size_t i = 0; i < tile_wh.x; i++) {
+      const Trail *trail = &trails[i];
+      if (!trail->alive) {
+        continue;
+      }
+      for (int j = 0; j < trail->length; j++) {
+        const int y = trail->head - j;
+        if (y >= 0 && y < (int)tile_wh.y) {
+          const float intensity = 1.0f - (float)j / trail->length;
+          CTUI_pushCodepoint(layer0, (uint32_t)('0' + nextRandom(bench) % 10),
+                             (CTUI_IVector2){trail->x, y},
+                             CTUI_RGB_NORM(0, intensity, 0), black);
+        }
+      }
+    }
+    CTUI_refresh(bench->ctx);
+  }
+  free(trails);
+}
+
+// Macro benchmark: a log that grows by a line a frame, so every row scrolls up
+// by one. Every fourth line mixes in two column CJK and Hangul text; a row
+// with wide glyphs is redrawn rather than scrolled, so the others scroll.
+
+static void getLogLine(size_t line_i, uint32_t *codepoints, CTUI_Color *fgs,
+                       CTUI_Color *bgs, size_t width) {
+  // xorshift32 seeded by the line, so a line is the same in every frame
+  uint32_t x = (uint32_t)line_i * 2654435761u + 1;
+  const int is_wide_line = line_i % 4 == 0;
+  const CTUI_Color fg = CTUI_RGB(128 + x % 128, 128 + (x >> 8) % 128, 160);
+  const CTUI_Color bg =
+      line_i % 7 == 0 ? CTUI_RGB(0, 0, 64) : CTUI_RGB(0, 0, 0);
+  for (size_t i = 0; i < width; i++) {
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    const uint32_t kind = x % 16;
+    if (is_wide_line && kind == 0) {
+      codepoints[i] = 0x4E00 + x / 16 % 0x5000;
+    } else if (is_wide_line && kind == 1) {
+      codepoints[i] = 0xAC00 + x / 16 % 11172;
+    } else if (kind < 4) {
+      codepoints[i] = ' ';
+    } else {
+      codepoints[i] = 'a' + x / 16 % 26;
+    }
+    fgs[i] = fg;
+    bgs[i] = bg;
+  }
+  // A wide glyph in the last column shows as a space.
+  if (line_i % 8 == 0) {
+    codepoints[width - 1] = 0x4E00 + (uint32_t)line_i % 0x5000;
+  }
+}
+
+static void runScrollLog(BenchContext *bench, size_t op_count) {
+  const size_t width = bench->console_tile_wh.x;
+  uint32_t *codepoints = malloc(width * sizeof(uint32_t));
+  CTUI_Color *colors = malloc(width * 2 * sizeof(CTUI_Color));
+  if (codepoints == NULL || colors == NULL) {
+    free(codepoints);
+    free(colors);
+    return;
+  }
+  CTUI_ConsoleLayer *layer = CTUI_getConsoleLayer(bench->console, 0);
+  for (size_t frame = 0; frame < op_count; frame++) {
+    bench->log_first_line++;
+    for (size_t y = 0; y < bench->console_tile_wh.y; y++) {
+      getLogLine(bench->log_first_line + y, codepoints, colors, colors + width,
+                 width);
+      CTUI_pushRow(layer, codepoints, colors, colors + width, width,
+                   (CTUI_IVector2){0, (int)y});
+    }
+    CTUI_refresh(bench->ctx);
+  }
+  free(codepoints);
+  free(colors);
+}
+
+#define BENCH_NO_CONSOLE {0, 0}
+
+static const Benchmark BENCHMARKS[] = {
+    {"decode_utf8_cstr", BENCH_NO_CONSOLE, runDecodeUtf8Cstr},
+    {"push_cstr_80x25", {80, 25}, runPushCstr},
+    {"push_codepoint_80x25", {80, 25}, runPushCodepoint},
+    {"push_codepoint_960x540", {960, 540}, runPushCodepoint},
+    {"fill_80x25", {80, 25}, runFill},
+    {"fill_960x540", {960, 540}, runFill},
+    {"try_get_glyph_dense", BENCH_NO_CONSOLE, runTryGetGlyphDense},
+    {"try_get_glyph_sparse", BENCH_NO_CONSOLE, runTryGetGlyphSparse},
+    {"create_font", BENCH_NO_CONSOLE, runCreateFont},
+    {"event_push_pop", BENCH_NO_CONSOLE, runEventPushPop},
+    {"matrix_rain_80x25", {80, 25}, runMatrixRain},
+    {"matrix_rain_160x50", {160, 50}, runMatrixRain},
+    {"matrix_rain_320x180", {320, 180}, runMatrixRain},
+    {"matrix_rain_640x360", {640, 360}, runMatrixRain},
+    {"matrix_rain_960x540", {960, 540}, runMatrixRain},
+#ifndef _WIN32
+    {"matrix_rain_terminal_80x25", {80, 25}, runMatrixRain, 1},
+    {"matrix_rain_terminal_160x50", {160, 50}, runMatrixRain, 1},
+    {"scroll_log_terminal_80x25", {80, 25}, runScrollLog, 1},
+    {"scroll_log_terminal_160x50", {160, 50}, runScrollLog, 1},
+#endif
+};
+
+// Terminal screen model
+// The terminal benchmarks draw to a pseudoterminal. A reader thread feeds
+// its output through a small VT model covering what the terminal backend
+// emits in truecolor: cursor movement, scroll margins, SU and SD, erase, SGR
+// colors, autowrap and wide glyphs.
+
+#ifndef _WIN32
+
+#define MODEL_MAX_PARAMS 16
+
+typedef struct ModelCell {
+  uint32_t codepoint;
+  // a is 0 while the color is up to the terminal
+  CTUI_Color fg;
+  CTUI_Color bg;
+  // right half of the wide glyph to the left
+  int is_covered;
+} ModelCell;
+
+typedef enum ModelState {
+  MODEL_STATE_GROUND = 0,
+  MODEL_STATE_ESCAPE,
+  MODEL_STATE_CSI
+} ModelState;
+
+struct TerminalModel {
+  int master_fd;
+  int slave_fd;
+  pthread_t reader;
+  int is_reader_started;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  int is_reader_done;
+  // BEL bytes parsed and sent, the model is current once they match
+  size_t bell_count;
+  size_t sent_bell_count;
+  size_t width;
+  size_t height;
+  ModelCell *cells;
+  // width while a wrap is pending
+  size_t cursor_x;
+  size_t cursor_y;
+  size_t top;
+  size_t bottom;
+  CTUI_Color fg;
+  CTUI_Color bg;
+  ModelState state;
+  unsigned params[MODEL_MAX_PARAMS];
+  size_t param_count;
+  // set by a private marker or an intermediate byte
+  int is_private;
+  uint32_t utf8_codepoint;
+  int utf8_remaining;
+};
+
+// The workloads draw no other wide codepoints.
+static int isModelWide(uint32_t codepoint) {
+  return (codepoint >= 0x4E00 && codepoint <= 0x9FFF) ||
+         (codepoint >= 0xAC00 && codepoint <= 0xD7A3);
+}
+
+// Erased cells are blank in a color that depends on the terminal.
+static void eraseModelCell(TerminalModel *model, size_t x, size_t y) {
+  model->cells[y * model->width + x] = (ModelCell){.codepoint = ' '};
+}
+
+static void scrollModel(TerminalModel *model, size_t count, int is_up) {
+  const size_t width = model->width;
+  const size_t region_h = model->bottom - model->top + 1;
+  count = count < region_h ? count : region_h;
+  ModelCell *region = model->cells + model->top * width;
+  const size_t moved_size = (region_h - count) * width * sizeof(ModelCell);
+  if (is_up) {
+    memmove(region, region + count * width, moved_size);
+  } else {
+    memmove(region + count * width, region, moved_size);
+  }
+  const size_t erase_y = is_up ? model->bottom + 1 - count : model->top;
+  for (size_t y = erase_y; y < erase_y + count; y++) {
+    for (size_t x = 0; x < width; x++) {
+      eraseModelCell(model, x, y);
+    }
+  }
+}
+
+static void feedModelLine(TerminalModel *model) {
+  if (model->cursor_y == model->bottom) {
+    scrollModel(model, 1, 1);
+  } else if (model->cursor_y + 1 < model->height) {
+    model->cursor_y++;
+  }
+}
+
+static void putModelCodepoint(TerminalModel *model, uint32_t codepoint) {
+  const size_t glyph_w = isModelWide(codepoint) ? 2 : 1;
+  if (model->cursor_x + glyph_w > model->width) {
+    model->cursor_x = 0;
+    feedModelLine(model);
+  }
+  const size_t x0 = model->cursor_x;
+  const size_t y = model->cursor_y;
+  ModelCell *row = model->cells + y * model->width;
+  // Overwriting either half of a wide glyph erases the other half.
+  for (size_t x = x0; x < x0 + glyph_w; x++) {
+    if (row[x].is_covered) {
+      eraseModelCell(model, x - 1, y);
+    } else if (x + 1 < model->width && row[x + 1].is_covered) {
+      eraseModelCell(model, x + 1, y);
+    }
+  }
+  row[x0] = (ModelCell){codepoint, model->fg, model->bg, 0};
+  if (glyph_w == 2) {
+    row[x0 + 1] = (ModelCell){0, model->fg, model->bg, 1};
+  }
+  model->cursor_x += glyph_w;
+}
+
+static unsigned getModelParam(const TerminalModel *model, size_t i,
+                              unsigned fallback) {
+  return i < model->param_count && model->params[i] != 0 ? model->params[i]
+                                                         : fallback;
+}
+
+static void setModelSgr(TerminalModel *model) {
+  const size_t count = model->param_count == 0 ? 1 : model->param_count;
+  for (size_t i = 0; i < count; i++) {
+    const unsigned param = model->params[i];
+    if (param == 0) {
+      model->fg = (CTUI_Color){0};
+      model->bg = (CTUI_Color){0};
+    } else if (param == 39) {
+      model->fg = (CTUI_Color){0};
+    } else if (param == 49) {
+      model->bg = (CTUI_Color){0};
+    } else if ((param == 38 || param == 48) && i + 1 < count) {
+      CTUI_Color *color = param == 38 ? &model->fg : &model->bg;
+      if (model->params[i + 1] == 2 && i + 4 < count) {
+        *color = CTUI_RGB(model->params[i + 2], model->params[i + 3],
+                          model->params[i + 4]);
+        i += 4;
+      } else {
+        // An indexed color never matches the truecolor layers.
+        *color = (CTUI_Color){0};
+        i += 2;
+      }
+    }
+  }
+}
+
+static void dispatchModelCsi(TerminalModel *model, unsigned char final) {
+  if (model->is_private) {
+    return;
+  }
+  // A cursor waiting to wrap is still in the last column.
+  if (model->cursor_x >= model->width) {
+    model->cursor_x = model->width - 1;
+  }
+  switch (final) {
+  case 'H': {
+    const size_t y = getModelParam(model, 0, 1) - 1;
+    const size_t x = getModelParam(model, 1, 1) - 1;
+    model->cursor_y = y < model->height ? y : model->height - 1;
+    model->cursor_x = x < model->width ? x : model->width - 1;
+    break;
+  }
+  case 'C': {
+    const size_t x = model->cursor_x + getModelParam(model, 0, 1);
+    model->cursor_x = x < model->width ? x : model->width - 1;
+    break;
+  }
+  case 'r': {
+    // xterm clamps the bottom margin to the screen
+    const size_t top = getModelParam(model, 0, 1) - 1;
+    size_t bottom = getModelParam(model, 1, (unsigned)model->height) - 1;
+    bottom = bottom < model->height ? bottom : model->height - 1;
+    if (top < bottom) {
+      model->top = top;
+      model->bottom = bottom;
+    }
+    model->cursor_x = 0;
+    model->cursor_y = 0;
+    break;
+  }
+  case 'S':
+    scrollModel(model, getModelParam(model, 0, 1), 1);
+    break;
+  case 'T':
+    scrollModel(model, getModelParam(model, 0, 1), 0);
+    break;
+  case 'J':
+    if (model->params[0] == 2) {
+      for (size_t y = 0; y < model->height; y++) {
+        for (size_t x = 0; x < model->width; x++) {
+          eraseModelCell(model, x, y);
+        }
+      }
+    }
+    break;
+  case 'm':
+    setModelSgr(model);
+    break;
+  default:
+    break;
+  }
+}
+
+static void feedModelByte(TerminalModel *model, unsigned char byte) {
+  switch (model->state) {
+  case MODEL_STATE_ESCAPE:
+    if (byte == '[') {
+      model->state = MODEL_STATE_CSI;
+      memset(model->params, 0, sizeof(model->params));
+      model->param_count = 0;
+      model->is_private = 0;
+    } else {
+      model->state = MODEL_STATE_GROUND;
+    }
+    return;
+  case MODEL_STATE_CSI:
+    if (byte >= '0' && byte <= '9') {
+      if (model->param_count == 0) {
+        model->param_count = 1;
+      }
+      unsigned *param = &model->params[model->param_count - 1];
+      *param = *param * 10 + (byte - '0');
+    } else if (byte == ';') {
+      if (model->param_count == 0) {
+        model->param_count = 1;
+      }
+      if (model->param_count < MODEL_MAX_PARAMS) {
+        model->param_count++;
+      }
+    } else if (byte >= 0x40 && byte <= 0x7E) {
+      dispatchModelCsi(model, byte);
+      model->state = MODEL_STATE_GROUND;
+    } else {
+      model->is_private = 1;
+    }
+    return;
+  case MODEL_STATE_GROUND:
+    break;
+  }
+  if (model->utf8_remaining > 0) {
+    model->utf8_codepoint = model->utf8_codepoint << 6 | (byte & 0x3F);
+    if (--model->utf8_remaining == 0) {
+      putModelCodepoint(model, model->utf8_codepoint);
+    }
+    return;
+  }
+  if (byte == 0x1B) {
+    model->state = MODEL_STATE_ESCAPE;
+  } else if (byte == '\a') {
+    model->bell_count++;
+    pthread_cond_broadcast(&model->cond);
+  } else if (byte == '\r') {
+    model->cursor_x = 0;
+  } else if (byte == '\n') {
+    feedModelLine(model);
+  } else if (byte >= 0xF0) {
+    model->utf8_codepoint = byte & 0x07;
+    model->utf8_remaining = 3;
+  } else if (byte >= 0xE0) {
+    model->utf8_codepoint = byte & 0x0F;
+    model->utf8_remaining = 2;
+  } else if (byte >= 0xC0) {
+    model->utf8_codepoint = byte & 0x1F;
+    model->utf8_remaining = 1;
+  } else if (byte >= 0x20) {
+    putModelCodepoint(model, byte);
+  }
+}
+
+static void *readTerminalOutput(void *arg) {
+  TerminalModel *model = arg;
+  unsigned char buffer[4096];
+  for (;;) {
+    const ssize_t result = read(model->master_fd, buffer, sizeof(buffer));
+    if (result < 0 && errno == EINTR) {
+      continue;
+    }
+    // EIO once the slave side is closed
+    if (result <= 0) {
+      break;
+    }
+    pthread_mutex_lock(&model->mutex);
+    for (ssize_t i = 0; i < result; i++) {
+      feedModelByte(model, buffer[i]);
+    }
+    pthread_mutex_unlock(&model->mutex);
+  }
+  pthread_mutex_lock(&model->mutex);
+  model->is_reader_done = 1;
+  pthread_cond_broadcast(&model->cond);
+  pthread_mutex_unlock(&model->mutex);
+  return NULL;
+}
+
+static void destroyTerminalModel(TerminalModel *model) {
+  if (model->slave_fd >= 0) {
+    close(model->slave_fd);
+  }
+  if (model->is_reader_started) {
+    pthread_join(model->reader, NULL);
+  }
+  if (model->master_fd >= 0) {
+    close(model->master_fd);
+  }
+  pthread_cond_destroy(&model->cond);
+  pthread_mutex_destroy(&model->mutex);
+  free(model->cells);
+  free(model);
+}
+
+static TerminalModel *createTerminalModel(CTUI_SVector2 cells_wh) {
+  TerminalModel *model = calloc(1, sizeof(TerminalModel));
+  if (model == NULL) {
+    return NULL;
+  }
+  pthread_mutex_init(&model->mutex, NULL);
+  pthread_cond_init(&model->cond, NULL);
+  model->width = cells_wh.x;
+  model->height = cells_wh.y;
+  model->bottom = cells_wh.y - 1;
+  model->cells = calloc(cells_wh.x * cells_wh.y, sizeof(ModelCell));
+  model->slave_fd = -1;
+  model->master_fd = posix_openpt(O_RDWR | O_NOCTTY);
+  if (model->cells == NULL || model->master_fd < 0 ||
+      grantpt(model->master_fd) != 0 || unlockpt(model->master_fd) != 0) {
+    destroyTerminalModel(model);
+    return NULL;
+  }
+  const char *slave_path = ptsname(model->master_fd);
+  if (slave_path != NULL) {
+    model->slave_fd = open(slave_path, O_RDWR | O_NOCTTY);
+  }
+  struct winsize winsize = {0};
+  winsize.ws_col = (unsigned short)cells_wh.x;
+  winsize.ws_row = (unsigned short)cells_wh.y;
+  if (model->slave_fd < 0 ||
+      ioctl(model->slave_fd, TIOCSWINSZ, &winsize) != 0) {
+    destroyTerminalModel(model);
+    return NULL;
+  }
+  for (size_t y = 0; y < model->height; y++) {
+    for (size_t x = 0; x < model->width; x++) {
+      eraseModelCell(model, x, y);
+    }
+  }
+  if (pthread_create(&model->reader, NULL, readTerminalOutput, model) != 0) {
+    destroyTerminalModel(model);
+    return NULL;
+  }
+  model->is_reader_started = 1;
+  return model;
+}
+
+// Waits until the model has parsed everything written to the terminal so far.
+static int syncTerminalModel(TerminalModel *model) {
+  if (write(model->slave_fd, "\a", 1) != 1) {
+    return -1;
+  }
+  pthread_mutex_lock(&model->mutex);
+  model->sent_bell_count++;
+  while (model->bell_count < model->sent_bell_count &&
+         !model->is_reader_done) {
+    pthread_cond_wait(&model->cond, &model->mutex);
+  }
+  const int is_synced = model->bell_count >= model->sent_bell_count;
+  pthread_mutex_unlock(&model->mutex);
+  return is_synced ? 0 : -1;
+}
+
+// Composes cell x, y of the console the way the terminal backend does.
+static ModelCell composeModelCell(CTUI_Console *console, size_t x, size_t y) {
+  ModelCell cell = {' ', CTUI_RGB(255, 255, 255), CTUI_RGB(0, 0, 0), 0};
+  for (size_t layer_i = 0; layer_i < CTUI_getConsoleLayerCount(console);
+       layer_i++) {
+    const CTUI_ConsoleLayer *layer = CTUI_getConsoleLayer(console, layer_i);
+    const CTUI_SVector2 tiles_wh = CTUI_getLayerTilesWh(layer);
+    const CTUI_DVector2 div_wh = CTUI_getLayerTileDivWh(layer);
+    const size_t tile_x = (size_t)((double)x * div_wh.x);
+    const size_t tile_y = (size_t)((double)y * div_wh.y);
+    if (tile_x >= tiles_wh.x || tile_y >= tiles_wh.y) {
+      continue;
+    }
+    const size_t tile_i = tile_y * tiles_wh.x + tile_x;
+    if (CTUI_getLayerBgs(layer)[tile_i].a != 0) {
+      cell.bg = CTUI_getLayerBgs(layer)[tile_i];
+    }
+    if (CTUI_getLayerCodepoints(layer)[tile_i] != 0) {
+      cell.codepoint = CTUI_getLayerCodepoints(layer)[tile_i];
+      cell.fg = CTUI_getLayerFgs(layer)[tile_i];
+    }
+  }
+  return cell;
+}
+
+static int isModelColor(CTUI_Color shown, CTUI_Color expected) {
+  return shown.a != 0 && shown.r == expected.r && shown.g == expected.g &&
+         shown.b == expected.b;
+}
+
+// Compares the screen model against the layers. Returns 0 if they match.
+static int checkTerminalModel(BenchContext *bench) {
+  TerminalModel *model = bench->terminal;
+  if (syncTerminalModel(model) != 0) {
+    fprintf(stderr, "ctui_bench: terminal output stopped\n");
+    return -1;
+  }
+  pthread_mutex_lock(&model->mutex);
+  int result = 0;
+  for (size_t y = 0; y < model->height && result == 0; y++) {
+    for (size_t x = 0; x < model->width; x++) {
+      const ModelCell *shown = &model->cells[y * model->width + x];
+      ModelCell expected = composeModelCell(bench->console, x, y);
+      // A wide glyph that does not fit the last column shows as a space.
+      const int is_wide = isModelWide(expected.codepoint);
+      if (is_wide && x + 1 == model->width) {
+        expected.codepoint = ' ';
+      }
+      const int is_cover_ok =
+          !shown->is_covered &&
+          (!is_wide || x + 1 == model->width ||
+           model->cells[y * model->width + x + 1].is_covered);
+      if (!is_cover_ok || shown->codepoint != expected.codepoint ||
+          !isModelColor(shown->bg, expected.bg) ||
+          (expected.codepoint != ' ' &&
+           !isModelColor(shown->fg, expected.fg))) {
+        fprintf(stderr,
+                "ctui_bench: terminal shows U+%04X %02X%02X%02X on "
+                "%02X%02X%02X at %zu,%zu, layers have U+%04X %02X%02X%02X "
+                "on %02X%02X%02X\n",
+                (unsigned)shown->codepoint, shown->fg.r, shown->fg.g,
+                shown->fg.b, shown->bg.r, shown->bg.g, shown->bg.b, x, y,
+                (unsigned)expected.codepoint, expected.fg.r, expected.fg.g,
+                expected.fg.b, expected.bg.r, expected.bg.g, expected.bg.b);
+        result = -1;
+        break;
+      }
+      // The right half shows nothing of its own.
+      if (is_wide && x + 1 < model->width) {
+        x++;
+      }
+    }
+  }
+  pthread_mutex_unlock(&model->mutex);
+  return result;
+}
+
+#endif
+
+// Harness
+
+typedef struct BenchOptions {
+  const char *filter;
+  size_t sample_count;
+  uint64_t min_sample_ns;
+  const char *json_path;
+  const char *baseline_path;
+  double threshold_percent;
+  const char *work_dir;
+} BenchOptions;
+
+static int compareDoubles(const void *a, const void *b) {
+  const double da = *(const double *)a;
+  const double db = *(const double *)b;
+  return (da > db) - (da < db);
+}
+
+static uint64_t timeRun(const Benchmark *benchmark, BenchContext *bench,
+                        size_t op_count) {
+  const uint64_t start_ns = CTUI_getMonotonicNs();
+  benchmark->run(bench, op_count);
+  return CTUI_getMonotonicNs() - start_ns;
+}
+
+// Destroys the console before the terminal model, which reads the console's
+// last output until the pseudoterminal closes.
+static void destroyBenchConsole(BenchContext *bench) {
+  if (bench->console != NULL) {
+    CTUI_destroyConsole(bench->console);
+    bench->console = NULL;
+  }
+#ifndef _WIN32
+  if (bench->terminal != NULL) {
+    destroyTerminalModel(bench->terminal);
+    bench->terminal = NULL;
+  }
+#endif
+}
+
+static int checkBenchConsole(BenchContext *bench) {
+#ifndef _WIN32
+  if (bench->terminal != NULL) {
+    return checkTerminalModel(bench);
+  }
+#endif
+  (void)bench;
+  return 0;
+}
+
+static int runBenchmark(const Benchmark *benchmark, BenchContext *bench,
+                        const BenchOptions *options, BenchResult *out_result) {
+  bench->rng = 0x9E3779B9u;
+  bench->log_first_line = 0;
+  bench->console_tile_wh = benchmark->console_tile_wh;
+  bench->console = NULL;
+  bench->terminal = NULL;
+  const CTUI_LayerInfo infos[2] = {
+      {.font = bench->font, .tile_div_wh = {1, 1}},
+      {.font = bench->font, .tile_div_wh = {2, 1}},
+  };
+  if (benchmark->is_terminal) {
+#ifndef _WIN32
+    bench->terminal = createTerminalModel(benchmark->console_tile_wh);
+    if (bench->terminal == NULL) {
+      return -1;
+    }
+    bench->console = CTUI_createTerminalConsoleFds(
+        bench->ctx, bench->terminal->slave_fd, bench->terminal->slave_fd, 2,
+        infos);
+    if (bench->console == NULL) {
+      destroyBenchConsole(bench);
+      return -1;
+    }
+    // The model knows truecolor only.
+    CTUI_setTerminalColorPalette(bench->console, CTUI_COLOR_PALETTE_TRUECOLOR,
+                                 CTUI_COLOR_METRIC_RGB);
+#endif
+  } else if (benchmark->console_tile_wh.x != 0) {
+    bench->console = CTUI_createHeadlessConsole(
+        bench->ctx, benchmark->console_tile_wh, 2, infos);
+    if (bench->console == NULL) {
+      return -1;
+    }
+  } else {
+    bench->console = CTUI_createHeadlessConsole(
+        bench->ctx, (CTUI_SVector2){1, 1}, 0, NULL);
+  }
+  // Double the operation count until a sample takes long enough to time.
+  size_t op_count = 1;
+  while (timeRun(benchmark, bench, op_count) < options->min_sample_ns &&
+         op_count < ((size_t)1 << 40)) {
+    op_count *= 2;
+  }
+  if (checkBenchConsole(bench) != 0) {
+    destroyBenchConsole(bench);
+    return -1;
+  }
+  double ns_per_op[BENCH_MAX_SAMPLES];
+  for (size_t i = 0; i < options->sample_count; i++) {
+    ns_per_op[i] =
+        (double)timeRun(benchmark, bench, op_count) / (double)op_count;
+    if (checkBenchConsole(bench) != 0) {
+      destroyBenchConsole(bench);
+      return -1;
+    }
+  }
+  qsort(ns_per_op, options->sample_count, sizeof(double), compareDoubles);
+  snprintf(out_result->name, BENCH_NAME_LENGTH, "%s", benchmark->name);
+  out_result->ns_per_op = ns_per_op[options->sample_count / 2];
+  out_result->min_ns_per_op = ns_per_op[0];
+  out_result->max_ns_per_op = ns_per_op[options->sample_count - 1];
+  out_result->op_count = op_count;
+  out_result->sample_count = options->sample_count;
+  destroyBenchConsole(bench);
+  return 0;
+}
+
+static int writeJson(const char *path, const BenchResult *results,
+                     size_t result_count) {
+  FILE *file = strcmp(path, "-") == 0 ? stdout : fopen(path, "w");
+  if (file == NULL) {
+    return -1;
+  }
+  fprintf(file, "{\n  \"version\": 1,\n  \"benchmarks\": [\n");
+  for (size_t i = 0; i < result_count; i++) {
+    const BenchResult *result = &results[i];
+    fprintf(file,
+            "    {\"name\": \"%s\", \"ns_per_op\": %.3f, "
+            "\"min_ns_per_op\": %.3f, \"max_ns_per_op\": %.3f, "
+            "\"ops_per_sample\": %zu, \"samples\": %zu}%s\n",
+            result->name, result->ns_per_op, result->min_ns_per_op,
+            result->max_ns_per_op, result->op_count, result->sample_count,
+            i + 1 < result_count ? "," : "");
+  }
+  fprintf(file, "  ]\n}\n");
+  return file == stdout ? 0 : (fclose(file) == 0 ? 0 : -1);
+}
+
+// Reads the name and ns_per_op pairs of a file written by writeJson.
+static size_t readBaseline(const char *path, BenchResult *results,
+                           size_t capacity) {
+  FILE *file = fopen(path, "r");
+  if (file == NULL) {
+    return 0;
+  }
+  size_t count = 0;
+  char line[512];
+  while (count < capacity && fgets(line, sizeof(line), file) != NULL) {
+    const char *name = strstr(line, "\"name\": \"");
+    const char *ns = strstr(line, "\"ns_per_op\": ");
+    if (name == NULL || ns == NULL) {
+      continue;
+    }
+    name += strlen("\"name\": \"");
+    const char *name_end = strchr(name, '"');
+    if (name_end == NULL || name_end - name >= BENCH_NAME_LENGTH) {
+      continue;
+    }
+    BenchResult *result = &results[count++];
+    memset(result, 0, sizeof(*result));
+    memcpy(result->name, name, (size_t)(name_end - name));
+    result->ns_per_op = strtod(ns + strlen("\"ns_per_op\": "), NULL);
+  }
+  fclose(file);
+  return count;
+}
+
+// Prints the change against the baseline. Returns the number of benchmarks
+// slower by more than the threshold.
+static size_t compareBaseline(const BenchOptions *options,
+                              const BenchResult *results,
+                              size_t result_count) {
+  BenchResult baseline[BENCH_MAX_RESULTS];
+  const size_t baseline_count =
+      readBaseline(options->baseline_path, baseline, BENCH_MAX_RESULTS);
+  if (baseline_count == 0) {
+    fprintf(stderr, "ctui_bench: no results in baseline %s\n",
+            options->baseline_path);
+    return 0;
+  }
+  size_t regression_count = 0;
+  fprintf(stderr, "%-28s %14s %14s %9s\n", "benchmark", "baseline ns",
+          "ns", "change");
+  for (size_t i = 0; i < result_count; i++) {
+    const BenchResult *before = NULL;
+    for (size_t j = 0; j < baseline_count; j++) {
+      if (strcmp(baseline[j].name, results[i].name) == 0) {
+        before = &baseline[j];
+        break;
+      }
+    }
+    if (before == NULL || before->ns_per_op <= 0.0) {
+      fprintf(stderr, "%-28s %14s %14.1f %9s\n", results[i].name, "-",
+              results[i].ns_per_op, "new");
+      continue;
+    }
+    const double change_percent =
+        (results[i].ns_per_op / before->ns_per_op - 1.0) * 100.0;
+    const int is_regression = change_percent > options->threshold_percent;
+    regression_count += is_regression;
+    fprintf(stderr, "%-28s %14.1f %14.1f %+8.1f%%%s\n", results[i].name,
+            before->ns_per_op, results[i].ns_per_op, change_percent,
+            is_regression ? "  REGRESSION" : "");
+  }
+  return regression_count;
+}
+
+static int parseOptions(int argc, char **argv, BenchOptions *options) {
+  for (int i = 1; i < argc; i++) {
+    const char *arg = argv[i];
+    const char *value = i + 1 < argc ? argv[i + 1] : NULL;
+    if (value == NULL) {
+      return -1;
+    }
+    if (strcmp(arg, "--filter") == 0) {
+      options->filter = value;
+    } else if (strcmp(arg, "--samples") == 0) {
+      options->sample_count = strtoul(value, NULL, 10);
+    } else if (strcmp(arg, "--min-sample-ms") == 0) {
+      options->min_sample_ns = strtoull(value, NULL, 10) * 1000000ULL;
+    } else if (strcmp(arg, "--json") == 0) {
+      options->json_path = value;
+    } else if (strcmp(arg, "--baseline") == 0) {
+      options->baseline_path = value;
+    } else if (strcmp(arg, "--threshold") == 0) {
+      options->threshold_percent = strtod(value, NULL);
+    } else if (strcmp(arg, "--work-dir") == 0) {
+      options->work_dir = value;
+    } else {
+      return -1;
+    }
+    i++;
+  }
+  if (options->sample_count == 0 ||
+      options->sample_count > BENCH_MAX_SAMPLES) {
+    return -1;
+  }
+  return 0;
+}
+
+int main(int argc, char **argv) {
+  BenchOptions options = {
+      .filter = NULL,
+      .sample_count = 9,
+      .min_sample_ns = 20000000ULL,
+      .json_path = "-",
+      .baseline_path = NULL,
+      .threshold_percent = 10.0,
+      .work_dir = ".",
+  };
+  if (parseOptions(argc, argv, &options) != 0) {
+    fprintf(stderr,
+            "usage: ctui_bench [--filter SUBSTRING] [--samples N] "
+            "[--min-sample-ms MS]\n"
+            "                  [--json PATH] [--baseline PATH] "
+            "[--threshold PERCENT]\n"
+            "                  [--work-dir DIR]\n");
+    return 2;
+  }
+
+  char image_path[1024];
+  char font_path[1024];
+  snprintf(image_path, sizeof(image_path), "%s/ctui_bench_atlas.tga",
+           options.work_dir);
+  snprintf(font_path, sizeof(font_path), "%s/ctui_bench.ctuifont",
+           options.work_dir);
+  if (writeAtlasTga(image_path) != 0 || writeCtuiFont(font_path) != 0) {
+    fprintf(stderr, "ctui_bench: cannot write the font to %s\n",
+            options.work_dir);
+    return 1;
+  }
+  BenchContext bench = {0};
+  bench.image_path = image_path;
+  bench.font_path = font_path;
+  bench.ctx = CTUI_createContext();
+  if (bench.ctx == NULL) {
+    return 1;
+  }
+  // frames are timed unpaced
+  CTUI_setTargetFrameNs(bench.ctx, 0);
+  bench.font = createBenchFont(&bench);
+  if (bench.font == NULL) {
+    fprintf(stderr, "ctui_bench: cannot load %s\n", font_path);
+    return 1;
+  }
+
+  BenchResult results[BENCH_MAX_RESULTS];
+  size_t result_count = 0;
+  int exit_code = 0;
+  for (size_t i = 0; i < sizeof(BENCHMARKS) / sizeof(BENCHMARKS[0]); i++) {
+    const Benchmark *benchmark = &BENCHMARKS[i];
+    if (options.filter != NULL &&
+        strstr(benchmark->name, options.filter) == NULL) {
+      continue;
+    }
+    if (runBenchmark(benchmark, &bench, &options, &results[result_count]) !=
+        0) {
+      fprintf(stderr, "ctui_bench: %s failed\n", benchmark->name);
+      exit_code = 1;
+      continue;
+    }
+    fprintf(stderr, "%-28s %14.1f ns/op\n", results[result_count].name,
+            results[result_count].ns_per_op);
+    result_count++;
+  }
+
+  if (writeJson(options.json_path, results, result_count) != 0) {
+    fprintf(stderr, "ctui_bench: cannot write %s\n", options.json_path);
+    exit_code = 1;
+  }
+  if (options.baseline_path != NULL &&
+      compareBaseline(&options, results, result_count) > 0) {
+    exit_code = 3;
+  }
+  CTUI_destroyFont(bench.font);
+  CTUI_destroyContext(bench.ctx);
+  remove(image_path);
+  remove(font_path);
+  return exit_code;
+}
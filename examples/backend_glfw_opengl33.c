@@ -23,10 +23,9 @@ int main() {
   const CTUI_LayerInfo infos[2] = {
       (CTUI_LayerInfo){.font = font_16x16, .tile_div_wh = {1, 1}},
       (CTUI_LayerInfo){.font = font_8x16, .tile_div_wh = {2, 1}}};
-  const CTUI_ColorMode color = CTUIC_RGBA32;
   const char *title = "glfw opengl33 window";
   CTUI_Console *console = CTUI_createGlfwOpengl33FakeTerminal(
-      ctx, tile_pixel_wh, layer_count, infos, color, title);
+      ctx, tile_pixel_wh, layer_count, infos, title);
   if (console == NULL) {
     return 3;
   }
@@ -106,13 +106,15 @@ int runMainLoopBody(CTUI_Context *ctx, CTUI_Console *console) {
   }
   CTUI_ConsoleLayer *layer0 = CTUI_getConsoleLayer(console, 0);
   CTUI_ConsoleLayer *layer1 = CTUI_getConsoleLayer(console, 1);
+  const CTUI_Color black = CTUI_RGBA(0, 0, 0, 255);
+  const CTUI_Color red = CTUI_RGBA(255, 85, 85, 255);
   CTUI_pushCstr(layer1, "Hello, and welcome to CTUI!", (CTUI_IVector2){1, 1},
-                99, 0, CTUI_BRIGHT_RED, CTUI_BLACK);
+                99, 0, red, black);
   CTUI_pushCstr(layer1, "Press spacebar to start and stop time.",
-                (CTUI_IVector2){1, 4}, 99, 0, CTUI_BRIGHT_RED, CTUI_BLACK);
+                (CTUI_IVector2){1, 4}, 99, 0, red, black);
   CTUI_pushCstr(layer1, "Press f to toggle fullscreen.", (CTUI_IVector2){1, 6},
-                99, 0, CTUI_BRIGHT_RED, CTUI_BLACK);
-  CTUI_fill(layer0, ' ', CTUI_BLACK, CTUI_BLACK);
+                99, 0, red, black);
+  CTUI_fill(layer0, ' ', black, black);
   for (size_t i = 0; i < TRAIL_COUNT; i++) {
     Trail *trail = &TRAILS[i];
     if (trail->alive == 0) {
@@ -124,9 +126,9 @@ int runMainLoopBody(CTUI_Context *ctx, CTUI_Console *console) {
         char digit = '0' + (rand() % 10);
         CTUI_Color fg_color;
         float intensity = 1.0f - (float)j / trail->length;
-        fg_color = CTUI_RGBA32N(0, intensity, 0, 1);
+        fg_color = CTUI_RGBA(0, CTUI_NORMAL255(intensity), 0, 255);
         CTUI_pushCodepoint(layer0, (uint32_t)digit,
-                           (CTUI_IVector2){trail->x, y}, fg_color, CTUI_BLACK);
+                           (CTUI_IVector2){trail->x, y}, fg_color, black);
       }
     }
   }
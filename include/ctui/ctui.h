@@ -26,14 +26,15 @@ typedef struct CTUI_Color {
 #define CTUI_RGBA(R, G, B, A)                                                  \
   (CTUI_Color) { .r = (R), .g = (G), .b = (B), .a = (A) }
 
-#define CTUI_RGB(R, G, B) (CTUI_COLOR){.r = (R), .g = (G), .b = (B), .a = 255}
+#define CTUI_RGB(R, G, B)                                                      \
+  (CTUI_Color) { .r = (R), .g = (G), .b = (B), .a = 255 }
 
 #define CTUI_RGBA_NORM(R, G, B, A)                                             \
-  CTUI_RGB(CTUI_NORMAL255((R)), CTUI_NORMAL255((G)), CTUI_NORMAL255((B)),      \
-           CTUI_NORMAL255((A)))
+  CTUI_RGBA(CTUI_NORMAL255((R)), CTUI_NORMAL255((G)), CTUI_NORMAL255((B)),     \
+            CTUI_NORMAL255((A)))
 
 #define CTUI_RGB_NORM(R, G, B)                                                 \
-  CTUI_RGB(CTUI_NORMAL255((R)), CTUI_NORMAL255((G)), CTUI_NORMAL255((B)), 255)
+  CTUI_RGB(CTUI_NORMAL255((R)), CTUI_NORMAL255((G)), CTUI_NORMAL255((B)))
 
 typedef struct CTUI_IVector2 {
   int x;
@@ -50,6 +51,11 @@ typedef struct CTUI_FVector2 {
   float y;
 } CTUI_FVector2;
 
+typedef struct CTUI_SRect {
+  CTUI_SVector2 xy;
+  CTUI_SVector2 wh;
+} CTUI_SRect;
+
 typedef struct CTUI_DVector2 {
   double x;
   double y;
@@ -134,6 +140,23 @@ typedef void (*CTUI_ShowWindowCallback)(CTUI_Console *console);
 typedef void (*CTUI_SetWindowedTileWhCallback)(CTUI_Console *console,
                                                CTUI_SVector2 tile_wh);
 typedef void (*CTUI_SetWindowedFullscreenCallback)(CTUI_Console *console);
+// Blocks until input arrives, wakeEvents is called or timeout_ns passes.
+typedef void (*CTUI_WaitEventsCallback)(CTUI_Console *console,
+                                        uint64_t timeout_ns);
+// Called from any thread to end a waitEvents in progress.
+typedef void (*CTUI_WakeEventsCallback)(CTUI_Console *console);
+// File descriptor that becomes readable when input arrives, -1 if none.
+typedef int (*CTUI_GetWaitFdCallback)(CTUI_Console *console);
+// Nanoseconds until pollEvents has to run again without new input, as when a
+// partial input sequence times out. CTUI_WAIT_FOREVER if it never has to.
+typedef uint64_t (*CTUI_GetWaitTimeoutCallback)(CTUI_Console *console);
+// Fence of the frame submitted by the last refresh.
+typedef uint64_t (*CTUI_GetFrameFenceCallback)(CTUI_Console *console);
+// Blocks until the frame of fence is presented or timeout_ns passes. Returns 1
+// if it was presented.
+typedef int (*CTUI_WaitFrameFenceCallback)(CTUI_Console *console,
+                                           uint64_t fence,
+                                           uint64_t timeout_ns);
 
 typedef struct CTUI_ConsoleLayer CTUI_ConsoleLayer;
 typedef void (*CTUI_PushCodepointCallback)(CTUI_ConsoleLayer *layer,
@@ -143,6 +166,23 @@ typedef void (*CTUI_PushCodepointCallback)(CTUI_ConsoleLayer *layer,
 typedef void (*CTUI_FillCallback)(CTUI_ConsoleLayer *layer, uint32_t codepoint,
                                   CTUI_Color fg, CTUI_Color bg);
 
+typedef struct CTUI_CodepointSpan {
+  // row major source tiles, stride elements apart per row
+  const uint32_t *codepoints;
+  // per tile colors, when NULL every tile uses fg / bg
+  const CTUI_Color *fgs;
+  const CTUI_Color *bgs;
+  CTUI_Color fg;
+  CTUI_Color bg;
+  size_t stride;
+} CTUI_CodepointSpan;
+
+// rect_wh is already clipped to the layer tile grid
+typedef void (*CTUI_PushCodepointsCallback)(CTUI_ConsoleLayer *layer,
+                                            const CTUI_CodepointSpan *span,
+                                            CTUI_SVector2 pos_xy,
+                                            CTUI_SVector2 rect_wh);
+
 typedef struct CTUI_PlatformVtable {
   int is_resizable;
   CTUI_DestroyCallback destroy;
@@ -183,11 +223,24 @@ typedef struct CTUI_PlatformVtable {
   CTUI_ShowWindowCallback showWindow;
   CTUI_SetWindowedTileWhCallback setWindowedTileWh;
   CTUI_SetWindowedFullscreenCallback setWindowedFullscreen;
+  // Blocking waits for CTUI_waitEvents. Platforms that cannot expose a file
+  // descriptor implement waitEvents and wakeEvents, the others getWaitFd.
+  CTUI_WaitEventsCallback waitEvents;
+  CTUI_WakeEventsCallback wakeEvents;
+  CTUI_GetWaitFdCallback getWaitFd;
+  CTUI_GetWaitTimeoutCallback getWaitTimeout;
+  // Frame fences for platforms that present frames after refresh returns.
+  // Without them every frame is presented by the time refresh returns.
+  CTUI_GetFrameFenceCallback getFrameFence;
+  CTUI_WaitFrameFenceCallback waitFrameFence;
   // Layer operations - platform-specific tile handling
   size_t layer_size; // Size of platform-specific layer struct (0 = use default
                      // CTUI_ConsoleLayer)
   CTUI_PushCodepointCallback pushCodepoint;
   CTUI_FillCallback fill;
+  // Whole row / rect write, one call per CTUI_pushRow / CTUI_pushCodepoints.
+  // When NULL, pushCodepoint is called per tile if set.
+  CTUI_PushCodepointsCallback pushCodepoints;
 } CTUI_PlatformVtable;
 
 typedef enum CTUI_Key {
@@ -331,6 +384,14 @@ typedef enum CTUI_MouseButton {
 
 typedef enum CTUI_Action { CTUIA_RELEASE = 0, CTUIA_PRESS = 1 } CTUI_Action;
 
+// CTUI_Event key and mouse button mods, the same bits as GLFW
+typedef enum CTUI_Mod {
+  CTUIM_SHIFT = 0x1,
+  CTUIM_CONTROL = 0x2,
+  CTUIM_ALT = 0x4,
+  CTUIM_SUPER = 0x8
+} CTUI_Mod;
+
 typedef enum CTUI_EventType {
   CTUI_EVENT_NONE = 0,
   CTUI_EVENT_KEY,
@@ -338,7 +399,13 @@ typedef enum CTUI_EventType {
   CTUI_EVENT_CURSOR_POS,
   CTUI_EVENT_SCROLL,
   CTUI_EVENT_RESIZE,
-  CTUI_EVENT_CLOSE
+  CTUI_EVENT_CLOSE,
+  // posted by the application, see CTUI_postEvent
+  CTUI_EVENT_CUSTOM,
+  // posted only to wake the event loop, carries no data
+  CTUI_EVENT_WAKEUP,
+  // a descriptor registered with CTUI_addWaitFd is readable
+  CTUI_EVENT_FD
 } CTUI_EventType;
 
 typedef struct CTUI_Event {
@@ -366,6 +433,14 @@ typedef struct CTUI_Event {
     struct {
       CTUI_SVector2 console_tile_wh;
     } resize;
+    struct {
+      uint64_t id;
+      void *user_data;
+    } custom;
+    struct {
+      int fd;
+      uint64_t id;
+    } fd;
   } data;
 } CTUI_Event;
 
@@ -403,15 +478,55 @@ typedef struct CTUI_Image {
 typedef struct CTUI_Context CTUI_Context;
 typedef struct CTUI_Font CTUI_Font;
 
+typedef struct CTUI_GlyphSlot {
+  uint32_t _codepoint;
+  // index into CTUI_Font::_glyphs, CTUI_GLYPH_SLOT_EMPTY if unused
+  uint32_t _glyph_i;
+} CTUI_GlyphSlot;
+
+#define CTUI_GLYPH_SLOT_EMPTY UINT32_MAX
+
+// Glyph index of an empty tile or of a codepoint the font has no glyph for.
+#define CTUI_GLYPH_INDEX_NONE UINT32_MAX
+
+// Codepoints below this are looked up in a flat array (ASCII, Latin, arrows,
+// box drawing, block elements, geometric shapes and misc symbols).
+#define CTUI_GLYPH_DENSE_LIMIT 0x2700
+
 typedef struct CTUI_Font {
   CTUI_Image _image;
-  size_t _max_map_offset;
-  size_t _map_size;
-  CTUI_Glyph *_glyph_map;
+  // glyphs in font file order
+  size_t _glyph_count;
+  CTUI_Glyph *_glyphs;
+  // glyph by codepoint for codepoints below _dense_size, NULL if missing
+  size_t _dense_size;
+  CTUI_Glyph **_dense_glyphs;
+  // Robin Hood hash for the remaining codepoints, power of two capacity
+  size_t _sparse_mask;
+  size_t _sparse_count;
+  size_t _max_probe_length;
+  CTUI_GlyphSlot *_sparse_slots;
+  // .ctuifontbin mapping backing _glyphs, _sparse_slots and _image._pixels,
+  // NULL when they are heap allocated
+  void *_mapped_data;
+  size_t _mapped_size;
 } CTUI_Font;
 
+typedef struct CTUI_GlyphTableStats {
+  size_t glyph_count;
+  // glyphs found with a single array load
+  size_t dense_count;
+  size_t dense_size;
+  // glyphs in the hashed table
+  size_t sparse_count;
+  size_t sparse_capacity;
+  // probe lengths of hashed glyphs, 0 = found in its home slot
+  size_t max_probe_length;
+  double mean_probe_length;
+} CTUI_GlyphTableStats;
+
 typedef struct CTUI_ConsoleTile {
-  CTUI_SVector2 _pos_xy;
+  // 0 = empty tile
   uint32_t _codepoint;
   CTUI_Color _fg;
   CTUI_Color _bg;
@@ -421,13 +536,102 @@ typedef struct CTUI_ConsoleLayer {
   CTUI_Console *_console;
   CTUI_DVector2 _tile_div_wh;
   CTUI_Font *_font;
+  // dense tile grid, console tile wh * tile div wh, row major
+  CTUI_SVector2 _tiles_wh;
+  // one plane per tile attribute (structure of arrays)
+  uint32_t *_codepoints;
+  CTUI_Color *_fgs;
+  CTUI_Color *_bgs;
+  // index into _font->_glyphs per tile, resolved when the tile is written,
+  // NULL unless the layer is glyph indexed
+  uint32_t *_glyph_indices;
+  int _is_glyph_indexed;
+  // incremented by every write that changed a tile
+  uint64_t _generation;
+  // _generation when the damage was last cleared
+  uint64_t _clean_generation;
+  // per row damage, x = first dirty column, y = one past the last (x >= y is
+  // a clean row)
+  CTUI_SVector2 *_row_damage;
+  // bounding box of all damage, max exclusive
+  CTUI_SVector2 _damage_min_xy;
+  CTUI_SVector2 _damage_max_xy;
 } CTUI_ConsoleLayer;
 
 typedef struct CTUI_LayerInfo {
   CTUI_Font *font;
   CTUI_DVector2 tile_div_wh;
+  // resolve glyphs when tiles are written instead of when they are rendered,
+  // see CTUI_getLayerGlyphIndices
+  int is_glyph_indexed;
 } CTUI_LayerInfo;
 
+typedef enum CTUI_FrameStage {
+  // between the end of the last CTUI_refresh and the start of this one
+  CTUI_FRAME_STAGE_APP = 0,
+  // renderer vertex or instance building
+  CTUI_FRAME_STAGE_BUILD,
+  // renderer buffer uploads
+  CTUI_FRAME_STAGE_UPLOAD,
+  // renderer draw calls or rasterization
+  CTUI_FRAME_STAGE_DRAW,
+  // platform buffer swap or presentation
+  CTUI_FRAME_STAGE_SWAP,
+  // frame pacing wait in CTUI_refresh
+  CTUI_FRAME_STAGE_SLEEP,
+  // end of the last CTUI_refresh to the end of this one
+  CTUI_FRAME_STAGE_TOTAL,
+  CTUI_FRAME_STAGE_COUNT,
+} CTUI_FrameStage;
+
+typedef struct CTUI_FrameTimes {
+  uint64_t stage_ns[CTUI_FRAME_STAGE_COUNT];
+} CTUI_FrameTimes;
+
+// frames kept for CTUI_getFrameStagePercentileNs
+#define CTUI_FRAME_HISTORY_LENGTH 256
+
+typedef struct CTUI_ConsoleCounters {
+  // tiles written through the push and fill functions, after clipping
+  uint64_t cells_pushed;
+  // pushed tiles whose contents changed
+  uint64_t cells_overwritten;
+  // renderer lookups of codepoints missing from the layer font
+  uint64_t glyph_misses;
+  uint64_t draw_calls;
+  uint64_t bytes_uploaded;
+} CTUI_ConsoleCounters;
+
+typedef enum CTUI_FramePacing {
+  // after a missed deadline, drop the missed frame slots and stay in phase
+  CTUI_FRAME_PACING_SKIP = 0,
+  // after a missed deadline, refresh without waiting until back on schedule
+  CTUI_FRAME_PACING_CATCH_UP,
+} CTUI_FramePacing;
+
+// CTUI_FRAME_PACING_CATCH_UP gives up and resyncs when this far behind.
+#define CTUI_FRAME_PACING_MAX_CATCH_UP_FRAMES 4
+
+typedef enum CTUI_EventCoalescing {
+  CTUI_COALESCE_NONE = 0,
+  // a CURSOR_POS replaces a CURSOR_POS of the same console at the queue tail
+  CTUI_COALESCE_CURSOR = 1 << 0,
+  // a SCROLL adds to a SCROLL of the same console at the queue tail
+  CTUI_COALESCE_SCROLL = 1 << 1,
+  // a RESIZE drops the RESIZE events already queued for its console
+  CTUI_COALESCE_RESIZE = 1 << 2,
+  // CURSOR_POS events are only queued when the cursor enters another tile
+  CTUI_COALESCE_CURSOR_TILE = 1 << 3,
+  CTUI_COALESCE_ALL =
+      CTUI_COALESCE_CURSOR | CTUI_COALESCE_SCROLL | CTUI_COALESCE_RESIZE,
+} CTUI_EventCoalescing;
+
+typedef struct CTUI_PostRing CTUI_PostRing;
+typedef struct CTUI_Waiter CTUI_Waiter;
+
+// events CTUI_postEvent can hold before the main thread drains them
+#define CTUI_POST_RING_LENGTH 1024
+
 typedef struct CTUI_Context {
   CTUI_Console *_first_console;
   CTUI_Font *_first_font;
@@ -435,8 +639,30 @@ typedef struct CTUI_Context {
   size_t _event_queue_capacity;
   size_t _event_queue_count;
   size_t _event_queue_head;
+  // lock-free queue written by any thread, read by the main thread
+  CTUI_PostRing *_post_ring;
+  // CTUI_EventCoalescing flags applied by CTUI_pushEvent
+  int _event_coalescing;
+  // wake pipe and registered descriptors for CTUI_waitEvents
+  CTUI_Waiter *_waiter;
   uint64_t _target_frame_ns;
+  // CTUI_getMonotonicNs of the last paced refresh
   uint64_t _last_frame_ns;
+  // CTUI_getMonotonicNs deadline of the next refresh, 0 = not scheduled
+  uint64_t _next_frame_ns;
+  // busy wait this long before a deadline instead of sleeping
+  uint64_t _frame_spin_ns;
+  CTUI_FramePacing _frame_pacing;
+  uint64_t _missed_frame_count;
+  uint64_t _skipped_frame_count;
+  // CTUI_getMonotonicNs at the end of the last refresh, 0 before the first
+  uint64_t _refresh_end_ns;
+  // stages of the frame in progress
+  CTUI_FrameTimes _frame_times;
+  // ring of completed frames
+  CTUI_FrameTimes _frame_history[CTUI_FRAME_HISTORY_LENGTH];
+  size_t _frame_history_count;
+  size_t _frame_history_head;
 } CTUI_Context;
 
 typedef struct CTUI_Console {
@@ -451,6 +677,10 @@ typedef struct CTUI_Console {
   size_t _layer_size;
   void *_layers;
   CTUI_Color _fill_bg_color;
+  CTUI_ConsoleCounters _counters;
+  // tile of the last queued CURSOR_POS, for CTUI_COALESCE_CURSOR_TILE
+  int _has_cursor_tile : 1;
+  CTUI_IVector2 _cursor_tile_xy;
 } CTUI_Console;
 
 int CTUI_getHasRealTerminal();
@@ -465,21 +695,91 @@ void CTUI_setTargetFrameNs(CTUI_Context *ctx, uint64_t target_frame_ns);
 
 uint64_t CTUI_getTargetFrameNs(CTUI_Context *ctx);
 
+// Nanoseconds on a clock that never jumps, for comparing frame times.
+uint64_t CTUI_getMonotonicNs();
+
+void CTUI_setFramePacing(CTUI_Context *ctx, CTUI_FramePacing pacing);
+
+CTUI_FramePacing CTUI_getFramePacing(CTUI_Context *ctx);
+
+// Sleeping wakes up to a scheduler slice late; spinning through the last
+// spin_ns before each deadline trades CPU time for precision.
+void CTUI_setFrameSpinNs(CTUI_Context *ctx, uint64_t spin_ns);
+
+uint64_t CTUI_getFrameSpinNs(CTUI_Context *ctx);
+
+// Renderers and platforms report the time spent in their stages here.
+void CTUI_addFrameStageNs(CTUI_Context *ctx, CTUI_FrameStage stage,
+                          uint64_t ns);
+
+// Stage times of the last completed frame.
+CTUI_FrameTimes CTUI_getLastFrameTimes(CTUI_Context *ctx);
+
+size_t CTUI_getFrameHistoryCount(CTUI_Context *ctx);
+
+// Nearest rank percentile (0 to 100) of a stage over the frame history.
+uint64_t CTUI_getFrameStagePercentileNs(CTUI_Context *ctx,
+                                        CTUI_FrameStage stage,
+                                        double percentile);
+
+CTUI_ConsoleCounters CTUI_getConsoleCounters(const CTUI_Console *console);
+
+void CTUI_resetConsoleCounters(CTUI_Console *console);
+
+// Refreshes that started after their deadline.
+uint64_t CTUI_getMissedFrameCount(CTUI_Context *ctx);
+
+// Frame slots dropped by CTUI_FRAME_PACING_SKIP or a catch up resync.
+uint64_t CTUI_getSkippedFrameCount(CTUI_Context *ctx);
+
 int CTUI_hasConsole(CTUI_Context *ctx);
 
 void CTUI_pollEvents(CTUI_Context *ctx);
 
 void CTUI_pushEvent(CTUI_Context *ctx, CTUI_Event *event);
 
+#define CTUI_WAIT_FOREVER UINT64_MAX
+
+// Polls events, then blocks until an event is queued or timeout_ns passes.
+// Returns 1 if CTUI_nextEvent has an event.
+int CTUI_waitEvents(CTUI_Context *ctx, uint64_t timeout_ns);
+
+// Makes a CTUI_waitEvents in progress return, callable from any thread.
+void CTUI_wakeEvents(CTUI_Context *ctx);
+
+// Queues a CTUI_EVENT_FD with id whenever fd is readable during
+// CTUI_waitEvents. Returns -1 on failure or platforms without poll().
+int CTUI_addWaitFd(CTUI_Context *ctx, int fd, uint64_t id);
+
+void CTUI_removeWaitFd(CTUI_Context *ctx, int fd);
+
+// Sets the CTUI_EventCoalescing flags used when events are queued.
+void CTUI_setEventCoalescing(CTUI_Context *ctx, int coalescing);
+
+int CTUI_getEventCoalescing(CTUI_Context *ctx);
+
+// Queues an event from any thread without locking, usually a
+// CTUI_EVENT_CUSTOM or CTUI_EVENT_WAKEUP. Posted events reach
+// CTUI_nextEvent after the events already queued on the main thread.
+// Returns -1 if CTUI_POST_RING_LENGTH posted events are still undrained.
+int CTUI_postEvent(CTUI_Context *ctx, const CTUI_Event *event);
+
 int CTUI_nextEvent(CTUI_Context *ctx, CTUI_Event *event);
 
+// ctuifont_path may also name a .ctuifontbin written by CTUI_writeFontBin,
+// which is mapped in place and needs no image_paths.
 CTUI_Font *CTUI_createFont(const char *ctuifont_path, const char **image_paths,
                            size_t image_count);
 
+// Writes the glyph table and decoded atlas pages of font as a .ctuifontbin.
+int CTUI_writeFontBin(const CTUI_Font *font, const char *ctuifontbin_path);
+
 void CTUI_destroyFont(CTUI_Font *font);
 
 CTUI_Glyph *CTUI_tryGetGlyph(CTUI_Font *font, uint32_t codepoint);
 
+CTUI_GlyphTableStats CTUI_getGlyphTableStats(const CTUI_Font *font);
+
 CTUI_SVector2 CTUI_getGlyphTilesWh(const CTUI_Glyph *glyph);
 
 uint32_t CTUI_getGlyphCodepoint(const CTUI_Glyph *glyph);
@@ -501,6 +801,63 @@ const CTUI_Font *CTUI_getFont(const CTUI_ConsoleLayer *layer);
 
 void CTUI_setFont(CTUI_ConsoleLayer *layer, CTUI_Font *font);
 
+CTUI_SVector2 CTUI_getLayerTilesWh(const CTUI_ConsoleLayer *layer);
+
+const uint32_t *CTUI_getLayerCodepoints(const CTUI_ConsoleLayer *layer);
+
+// Per tile indices into the layer font's _glyphs, CTUI_GLYPH_INDEX_NONE for
+// empty tiles and missing glyphs. NULL unless the layer is glyph indexed.
+const uint32_t *CTUI_getLayerGlyphIndices(const CTUI_ConsoleLayer *layer);
+
+const CTUI_Color *CTUI_getLayerFgs(const CTUI_ConsoleLayer *layer);
+
+const CTUI_Color *CTUI_getLayerBgs(const CTUI_ConsoleLayer *layer);
+
+CTUI_ConsoleTile CTUI_getLayerTile(const CTUI_ConsoleLayer *layer,
+                                   CTUI_SVector2 tile_xy);
+
+void CTUI_clearLayer(CTUI_ConsoleLayer *layer);
+
+uint64_t CTUI_getLayerGeneration(const CTUI_ConsoleLayer *layer);
+
+// Generation the layer had when its damage was last cleared. A renderer whose
+// retained copy of the layer is at this generation only needs the damage.
+uint64_t CTUI_getLayerCleanGeneration(const CTUI_ConsoleLayer *layer);
+
+// Returns 1 and the bounding rect of all tiles changed since the damage was
+// last cleared, or 0 if nothing changed.
+int CTUI_getLayerDamage(const CTUI_ConsoleLayer *layer, CTUI_SRect *out_rect);
+
+// Returns 1 and the changed column span of row tile_y, or 0 if the row is
+// clean.
+int CTUI_getLayerRowDamage(const CTUI_ConsoleLayer *layer, size_t tile_y,
+                           CTUI_SRect *out_rect);
+
+// Marks tiles as changed, for backends that write tiles themselves.
+void CTUI_damageLayer(CTUI_ConsoleLayer *layer, CTUI_SRect rect);
+
+// Called by CTUI_refresh after every platform refresh.
+void CTUI_clearLayerDamage(CTUI_ConsoleLayer *layer);
+
+// Allocates console->_layers (platform layer_size stride) and the tile grid of
+// every layer for console->_console_tile_wh. Returns 0 on success.
+int CTUI_initConsoleLayers(CTUI_Console *console, size_t layer_count,
+                           const CTUI_LayerInfo *layer_infos);
+
+// Sets console->_console_tile_wh and resizes every layer grid, keeping the
+// overlapping tiles. Returns 0 on success.
+int CTUI_resizeConsoleLayers(CTUI_Console *console,
+                             CTUI_SVector2 console_tile_wh);
+
+void CTUI_freeConsoleLayers(CTUI_Console *console);
+
+// Makes the layers of snapshot a copy of those of console, with the same
+// generations and damage, for rendering on another thread. Only the damage is
+// copied when snapshot holds console as of its last damage clear. snapshot
+// starts zeroed and is freed with CTUI_freeConsoleLayers. Returns 0 on
+// success.
+int CTUI_snapshotConsoleLayers(CTUI_Console *snapshot, CTUI_Console *console);
+
 CTUI_SVector2 CTUI_getConsoleTileWh(const CTUI_Console *console);
 
 size_t CTUI_getConsoleLayerCount(const CTUI_Console *console);
@@ -566,6 +923,17 @@ void CTUI_setWindowOpacity(CTUI_Console *console, float opacity);
 
 float CTUI_getWindowOpacity(CTUI_Console *console);
 
+// Fence of the frame submitted by the last CTUI_refresh, for consoles that
+// present frames after CTUI_refresh returns. Wait for it before destroying
+// fonts or consoles the frame may still be drawn with.
+uint64_t CTUI_getFrameFence(CTUI_Console *console);
+
+// Blocks until the frame of fence is presented or timeout_ns passes, 0 only
+// checks and CTUI_WAIT_FOREVER does not time out. Returns 1 if it was
+// presented.
+int CTUI_waitFrameFence(CTUI_Console *console, uint64_t fence,
+                        uint64_t timeout_ns);
+
 int CTUI_getHasViewport(CTUI_Console *console);
 
 void CTUI_transformViewport(CTUI_Console *console, CTUI_FVector2 translation,
@@ -584,8 +952,33 @@ int CTUI_getKeyState(CTUI_Console *console, CTUI_Key key);
 void CTUI_pushCodepoint(CTUI_ConsoleLayer *layer, uint32_t codepoint,
                         CTUI_IVector2 pos_xy, CTUI_Color fg, CTUI_Color bg);
 
+// Writes a rect of rect_wh tiles at pos_xy, clipped to the layer, with a
+// single platform dispatch.
+void CTUI_pushSpan(CTUI_ConsoleLayer *layer, const CTUI_CodepointSpan *span,
+                   CTUI_SVector2 rect_wh, CTUI_IVector2 pos_xy);
+
+void CTUI_pushRow(CTUI_ConsoleLayer *layer, const uint32_t *codepoints,
+                  const CTUI_Color *fgs, const CTUI_Color *bgs, size_t count,
+                  CTUI_IVector2 pos_xy);
+
+// codepoints, fgs and bgs are row major arrays of rect_wh.x * rect_wh.y
+void CTUI_pushCodepoints(CTUI_ConsoleLayer *layer, const uint32_t *codepoints,
+                         const CTUI_Color *fgs, const CTUI_Color *bgs,
+                         CTUI_SVector2 rect_wh, CTUI_IVector2 pos_xy);
+
 uint32_t CTUI_decodeUtf8Cstr(const char **str);
 
+// Decodes length bytes of UTF-8 into out, which must have room for length
+// codepoints, and returns the codepoint count. Invalid input is replaced
+// exactly like CTUI_decodeUtf8Cstr; NUL bytes decode to 0.
+size_t CTUI_decodeUtf8Buffer(const char *buffer, size_t length,
+                             uint32_t *out);
+
+// CTUI_pushCstr for text that is not NUL terminated.
+void CTUI_pushUtf8(CTUI_ConsoleLayer *layer, const char *text, size_t length,
+                   CTUI_IVector2 pos_xy, size_t wrap_width, size_t max_height,
+                   CTUI_Color fg, CTUI_Color bg);
+
 void CTUI_pushCstr(CTUI_ConsoleLayer *layer, const char *text,
                    CTUI_IVector2 pos_xy, size_t wrap_width, size_t max_height,
                    CTUI_Color fg, CTUI_Color bg);
@@ -595,6 +988,101 @@ void CTUI_fill(CTUI_ConsoleLayer *layer, uint32_t codepoint, CTUI_Color fg,
 
 void CTUI_refresh(CTUI_Context *ctx);
 
+// Resizes the console tile grid through the platform resize callback.
+void CTUI_resizeConsole(CTUI_Console *console, CTUI_SVector2 console_tile_wh);
+
+CTUI_Console *CTUI_createHeadlessConsole(CTUI_Context *context,
+                                         CTUI_SVector2 console_tile_wh,
+                                         size_t layer_count,
+                                         const CTUI_LayerInfo *layer_infos);
+
+// Number of refreshes presented by a headless console.
+size_t CTUI_getHeadlessFrameCount(const CTUI_Console *console);
+
+// Reads a tile of layer layer_i as of the last refresh.
+CTUI_ConsoleTile CTUI_getHeadlessTile(CTUI_Console *console, size_t layer_i,
+                                      CTUI_SVector2 tile_xy);
+
+// Moves the simulated cursor and queues a CTUI_EVENT_CURSOR_POS.
+void CTUI_setHeadlessCursorTilePos(CTUI_Console *console,
+                                   CTUI_DVector2 tile_pos);
+
+// Console drawn on the terminal of stdin and stdout, sized to it and resized
+// with it. Returns NULL when stdin is not a terminal.
+CTUI_Console *CTUI_createTerminalConsole(CTUI_Context *context,
+                                         size_t layer_count,
+                                         const CTUI_LayerInfo *layer_infos);
+
+// CTUI_createTerminalConsole on other descriptors, such as a pty.
+CTUI_Console *CTUI_createTerminalConsoleFds(CTUI_Context *context, int in_fd,
+                                            int out_fd, size_t layer_count,
+                                            const CTUI_LayerInfo *layer_infos);
+
+typedef enum CTUI_TerminalSyncUpdate {
+  // on once the terminal reports DEC mode 2026
+  CTUI_TERMINAL_SYNC_UPDATE_AUTO = 0,
+  CTUI_TERMINAL_SYNC_UPDATE_ON,
+  CTUI_TERMINAL_SYNC_UPDATE_OFF
+} CTUI_TerminalSyncUpdate;
+
+typedef struct CTUI_TerminalStats {
+  // refreshes that wrote output
+  uint64_t frame_count;
+  uint64_t bytes_written;
+  uint64_t last_frame_bytes;
+  // write calls, one per frame unless the terminal took a partial write
+  uint64_t write_calls;
+} CTUI_TerminalStats;
+
+// Sets whether frames are wrapped in synchronized update (DEC mode 2026)
+// markers, so the terminal shows each frame whole.
+void CTUI_setTerminalSyncUpdate(CTUI_Console *console,
+                                CTUI_TerminalSyncUpdate sync_update);
+
+CTUI_TerminalSyncUpdate
+CTUI_getTerminalSyncUpdate(const CTUI_Console *console);
+
+// Returns 1 if frames are currently sent as synchronized updates.
+int CTUI_getTerminalSyncUpdateActive(const CTUI_Console *console);
+
+CTUI_TerminalStats CTUI_getTerminalStats(const CTUI_Console *console);
+
+typedef enum CTUI_ColorPalette {
+  CTUI_COLOR_PALETTE_TRUECOLOR = 0,
+  CTUI_COLOR_PALETTE_256,
+  CTUI_COLOR_PALETTE_16
+} CTUI_ColorPalette;
+
+typedef enum CTUI_ColorMetric {
+  // squared distance in sRGB
+  CTUI_COLOR_METRIC_RGB = 0,
+  // squared distance in OKLab, slower to build but closer to what is seen
+  CTUI_COLOR_METRIC_PERCEPTUAL
+} CTUI_ColorMetric;
+
+// entries of a color lookup table, indexed by r >> 3 << 10 | g >> 3 << 5 |
+// b >> 3
+#define CTUI_COLOR_LUT_SIZE (32 * 32 * 32)
+
+// Writes the rgb of xterm palette index 0-255.
+void CTUI_getPaletteColor(size_t index, uint8_t *out_rgb);
+
+// Fills lut, CTUI_COLOR_LUT_SIZE bytes, with the nearest palette index of
+// every entry. palette is CTUI_COLOR_PALETTE_256 or CTUI_COLOR_PALETTE_16.
+void CTUI_buildColorLut(uint8_t *lut, CTUI_ColorPalette palette,
+                        CTUI_ColorMetric metric);
+
+void CTUI_quantizeColors(const uint8_t *lut, const CTUI_Color *colors,
+                         uint8_t *out_indices, size_t count);
+
+// Sets the colors a terminal console is drawn with. The default is guessed
+// from COLORTERM and TERM. Returns 0 on success.
+int CTUI_setTerminalColorPalette(CTUI_Console *console,
+                                 CTUI_ColorPalette palette,
+                                 CTUI_ColorMetric metric);
+
+CTUI_ColorPalette CTUI_getTerminalColorPalette(const CTUI_Console *console);
+
 typedef void *(*CTUI_GLGetProcAddress)(const char *name);
 
 CTUI_Renderer *
@@ -602,11 +1090,49 @@ CTUI_createOpenGL33Renderer(CTUI_GLGetProcAddress getProcAddress);
 
 void CTUI_destroyOpenGL33Renderer(CTUI_Renderer *renderer);
 
+typedef enum CTUI_GL33Mode {
+  // six vertices per tile
+  CTUI_GL33_MODE_VERTICES = 0,
+  // one 16 byte instance per tile, glyph rects in a texture buffer
+  CTUI_GL33_MODE_INSTANCED,
+  // glyph index, fg and bg textures with one texel per tile, drawn with one
+  // quad per layer, only the damaged tiles are uploaded
+  CTUI_GL33_MODE_GRID,
+} CTUI_GL33Mode;
+
+void CTUI_setOpenGL33RendererMode(CTUI_Renderer *renderer, CTUI_GL33Mode mode);
+
+CTUI_GL33Mode CTUI_getOpenGL33RendererMode(const CTUI_Renderer *renderer);
+
+// Renders into an RGBA8 framebuffer on the CPU, sized with
+// CTUI_rendererResize. Row bands are drawn by thread_count threads including
+// the caller; 0 uses one per online CPU. On Windows they are all drawn by the
+// caller.
+CTUI_Renderer *CTUI_createSoftwareRenderer(size_t thread_count);
+
+void CTUI_destroySoftwareRenderer(CTUI_Renderer *renderer);
+
+// Pixels of the last render, top row first, 4 bytes per pixel.
+const uint8_t *CTUI_getSoftwareRendererPixels(const CTUI_Renderer *renderer,
+                                              CTUI_IVector2 *out_pixel_wh);
+
 CTUI_Console *CTUI_createGlfwOpengl33FakeTerminal(
     CTUI_Context *context, CTUI_DVector2 tile_pixel_wh, size_t layer_count,
     const CTUI_LayerInfo *layer_infos,
     const char *title);
 
+// Moves the rendering and buffer swaps of a GLFW console to a render thread.
+// CTUI_refresh then copies the layers into a snapshot for the thread and
+// returns, so the next frame is built while this one is drawn and swapped.
+// It only waits when the previous frame is not drawn yet. Renderer stage
+// times and counters are reported by the first refresh after the frame is
+// presented. The GL context is current on the render thread while it runs.
+// Returns 0 on success. On Windows frames are always drawn by CTUI_refresh
+// and enabling the thread returns -1.
+int CTUI_setGlfwRenderThread(CTUI_Console *console, int is_enabled);
+
+int CTUI_getGlfwRenderThread(const CTUI_Console *console);
+
 #ifdef __cplusplus
 }
 #endif
@@ -1,4 +1,6 @@
 #include <ctui/ctui.h>
+#include <math.h>
+#include <stdatomic.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -7,11 +9,34 @@
 #ifdef _WIN32
 #include <windows.h>
 #else
-#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
 #include <time.h>
+#include <unistd.h>
 #endif
 #include <fnv/fnv.h>
 
+#define CTUI_PUSH_UTF8_CHUNK_LENGTH 256
+
+#define CTUI_FONTBIN_VERSION 1
+// section alignment in .ctuifontbin files
+#define CTUI_FONTBIN_ALIGN 64
+
+#if defined(__AVX2__)
+#define CTUI_SIMD_AVX2
+#include <immintrin.h>
+#endif
+#if defined(__SSE2__) || defined(_M_X64) ||                                   \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CTUI_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
 #define STB_IMAGE_IMPLEMENTATION
 #include <stb/stb_image.h>
 
@@ -50,30 +75,206 @@ void CTUI_rendererMakeCurrent(CTUI_Renderer *r) {
     r->vtable->makeCurrent(r);
 }
 
+// Bounded MPSC ring after Dmitry Vyukov's queue: a slot is free for the
+// producer at position pos when its sequence is pos, and holds an event for
+// the consumer when its sequence is pos + 1.
+typedef struct CTUI_PostSlot {
+  atomic_size_t sequence;
+  CTUI_Event event;
+} CTUI_PostSlot;
+
+typedef struct CTUI_PostRing {
+  atomic_size_t enqueue_pos;
+  // keep producers and the consumer on separate cache lines
+  char _padding[64 - sizeof(atomic_size_t)];
+  size_t dequeue_pos;
+  CTUI_PostSlot slots[CTUI_POST_RING_LENGTH];
+} CTUI_PostRing;
+
+typedef struct CTUI_WaitFd {
+  int fd;
+  uint64_t id;
+} CTUI_WaitFd;
+
+struct CTUI_Waiter {
+  // set while the main thread blocks in CTUI_waitEvents
+  atomic_int is_waiting;
+  // console whose platform waitEvents is blocking, NULL if polling
+  _Atomic(CTUI_Console *) waiting_console;
+#ifndef _WIN32
+  // non-blocking self pipe written by CTUI_wakeEvents
+  int wake_fds[2];
+  CTUI_WaitFd *fds;
+  size_t fd_count;
+  size_t fd_capacity;
+  // A platform waitEvents cannot watch descriptors, so while one blocks this
+  // thread polls them and wakes the platform.
+  pthread_t watcher;
+  int is_watcher_started;
+  pthread_mutex_t mutex;
+  pthread_cond_t cond;
+  int is_watching;
+  // set while the watcher is in poll() without the mutex
+  int is_polling;
+  int is_stopping;
+#endif
+};
+
+static CTUI_Waiter *CTUI_createWaiter() {
+  CTUI_Waiter *waiter = calloc(1, sizeof(CTUI_Waiter));
+  if (waiter == NULL) {
+    return NULL;
+  }
+  atomic_init(&waiter->is_waiting, 0);
+  atomic_init(&waiter->waiting_console, NULL);
+#ifndef _WIN32
+  if (pipe(waiter->wake_fds) != 0) {
+    free(waiter);
+    return NULL;
+  }
+  for (int i = 0; i < 2; i++) {
+    fcntl(waiter->wake_fds[i], F_SETFL,
+          fcntl(waiter->wake_fds[i], F_GETFL) | O_NONBLOCK);
+    fcntl(waiter->wake_fds[i], F_SETFD, FD_CLOEXEC);
+  }
+  pthread_mutex_init(&waiter->mutex, NULL);
+  pthread_cond_init(&waiter->cond, NULL);
+#endif
+  return waiter;
+}
+
+static void CTUI_destroyWaiter(CTUI_Waiter *waiter) {
+#ifndef _WIN32
+  if (waiter->is_watcher_started) {
+    pthread_mutex_lock(&waiter->mutex);
+    waiter->is_stopping = 1;
+    pthread_cond_signal(&waiter->cond);
+    pthread_mutex_unlock(&waiter->mutex);
+    const char byte = 0;
+    (void)!write(waiter->wake_fds[1], &byte, 1);
+    pthread_join(waiter->watcher, NULL);
+  }
+  pthread_mutex_destroy(&waiter->mutex);
+  pthread_cond_destroy(&waiter->cond);
+  close(waiter->wake_fds[0]);
+  close(waiter->wake_fds[1]);
+  if (waiter->fds != NULL) {
+    free(waiter->fds);
+  }
+#endif
+  free(waiter);
+}
+
 static void CTUI_initEventQueue(CTUI_Context *ctx) {
   ctx->_event_queue_capacity = 32;
   ctx->_event_queue = calloc(ctx->_event_queue_capacity, sizeof(CTUI_Event));
   ctx->_event_queue_count = 0;
   ctx->_event_queue_head = 0;
+  ctx->_post_ring = calloc(1, sizeof(CTUI_PostRing));
+  if (ctx->_post_ring != NULL) {
+    atomic_init(&ctx->_post_ring->enqueue_pos, 0);
+    for (size_t i = 0; i < CTUI_POST_RING_LENGTH; i++) {
+      atomic_init(&ctx->_post_ring->slots[i].sequence, i);
+    }
+  }
 }
 
 static void CTUI_freeEventQueue(CTUI_Context *ctx) {
   if (ctx->_event_queue != NULL) {
     free(ctx->_event_queue);
   }
+  if (ctx->_post_ring != NULL) {
+    free(ctx->_post_ring);
+  }
   ctx->_event_queue = NULL;
+  ctx->_post_ring = NULL;
   ctx->_event_queue_capacity = 0;
   ctx->_event_queue_count = 0;
   ctx->_event_queue_head = 0;
 }
 
+int CTUI_postEvent(CTUI_Context *ctx, const CTUI_Event *event) {
+  CTUI_PostRing *ring = ctx->_post_ring;
+  if (ring == NULL) {
+    return -1;
+  }
+  size_t pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+  CTUI_PostSlot *slot;
+  for (;;) {
+    slot = &ring->slots[pos & (CTUI_POST_RING_LENGTH - 1)];
+    const size_t sequence =
+        atomic_load_explicit(&slot->sequence, memory_order_acquire);
+    const intptr_t difference = (intptr_t)sequence - (intptr_t)pos;
+    if (difference == 0) {
+      if (atomic_compare_exchange_weak_explicit(&ring->enqueue_pos, &pos,
+                                                pos + 1, memory_order_relaxed,
+                                                memory_order_relaxed)) {
+        break;
+      }
+    } else if (difference < 0) {
+      // The consumer has not freed this slot yet.
+      return -1;
+    } else {
+      pos = atomic_load_explicit(&ring->enqueue_pos, memory_order_relaxed);
+    }
+  }
+  slot->event = *event;
+  atomic_store_explicit(&slot->sequence, pos + 1, memory_order_release);
+  CTUI_wakeEvents(ctx);
+  return 0;
+}
+
+static int CTUI_hasPostedEvents(CTUI_Context *ctx) {
+  CTUI_PostRing *ring = ctx->_post_ring;
+  if (ring == NULL) {
+    return 0;
+  }
+  const size_t pos = ring->dequeue_pos;
+  CTUI_PostSlot *slot = &ring->slots[pos & (CTUI_POST_RING_LENGTH - 1)];
+  return atomic_load_explicit(&slot->sequence, memory_order_acquire) ==
+         pos + 1;
+}
+
+static int CTUI_takePostedEvent(CTUI_Context *ctx, CTUI_Event *event) {
+  CTUI_PostRing *ring = ctx->_post_ring;
+  if (ring == NULL) {
+    return 0;
+  }
+  const size_t pos = ring->dequeue_pos;
+  CTUI_PostSlot *slot = &ring->slots[pos & (CTUI_POST_RING_LENGTH - 1)];
+  const size_t sequence =
+      atomic_load_explicit(&slot->sequence, memory_order_acquire);
+  if (sequence != pos + 1) {
+    return 0;
+  }
+  *event = slot->event;
+  atomic_store_explicit(&slot->sequence, pos + CTUI_POST_RING_LENGTH,
+                        memory_order_release);
+  ring->dequeue_pos = pos + 1;
+  return 1;
+}
+
+// Moves posted events behind the main thread queue.
+static void CTUI_drainPostedEvents(CTUI_Context *ctx) {
+  CTUI_Event event;
+  while (CTUI_takePostedEvent(ctx, &event)) {
+    CTUI_pushEvent(ctx, &event);
+  }
+}
+
 int CTUI_nextEvent(CTUI_Context *ctx, CTUI_Event *event) {
-  if (ctx->_event_queue_count > 0) {
+  if (ctx->_event_queue_count == 0) {
+    CTUI_drainPostedEvents(ctx);
+  }
+  while (ctx->_event_queue_count > 0) {
     size_t idx = ctx->_event_queue_head;
     *event = ctx->_event_queue[idx];
     ctx->_event_queue_head =
         (ctx->_event_queue_head + 1) % ctx->_event_queue_capacity;
     ctx->_event_queue_count--;
+    // superseded by coalescing
+    if (event->type == CTUI_EVENT_NONE)
+      continue;
     return 1;
   }
   return 0;
@@ -83,6 +284,158 @@ int CTUI_hasConsole(CTUI_Context *context) {
   return context->_first_console != NULL;
 }
 
+static CTUI_SVector2 CTUI_calcLayerTilesWh(CTUI_SVector2 console_tile_wh,
+                                           CTUI_DVector2 tile_div_wh) {
+  CTUI_SVector2 tiles_wh;
+  tiles_wh.x = (size_t)ceil((double)console_tile_wh.x * tile_div_wh.x);
+  tiles_wh.y = (size_t)ceil((double)console_tile_wh.y * tile_div_wh.y);
+  return tiles_wh;
+}
+
+static void CTUI_freeLayerGrid(CTUI_ConsoleLayer *layer) {
+  if (layer->_codepoints != NULL) {
+    free(layer->_codepoints);
+  }
+  if (layer->_fgs != NULL) {
+    free(layer->_fgs);
+  }
+  if (layer->_bgs != NULL) {
+    free(layer->_bgs);
+  }
+  if (layer->_row_damage != NULL) {
+    free(layer->_row_damage);
+  }
+  if (layer->_glyph_indices != NULL) {
+    free(layer->_glyph_indices);
+  }
+  layer->_codepoints = NULL;
+  layer->_fgs = NULL;
+  layer->_bgs = NULL;
+  layer->_row_damage = NULL;
+  layer->_glyph_indices = NULL;
+  layer->_tiles_wh = (CTUI_SVector2){0, 0};
+  layer->_damage_min_xy = (CTUI_SVector2){0, 0};
+  layer->_damage_max_xy = (CTUI_SVector2){0, 0};
+}
+
+static inline int CTUI_colorEquals(CTUI_Color a, CTUI_Color b) {
+  return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+static void CTUI_markLayerRowDamage(CTUI_ConsoleLayer *layer, size_t tile_y,
+                                    size_t begin_x, size_t end_x) {
+  CTUI_SVector2 *row_damage = &layer->_row_damage[tile_y];
+  if (row_damage->x >= row_damage->y) {
+    row_damage->x = begin_x;
+    row_damage->y = end_x;
+  } else {
+    if (begin_x < row_damage->x)
+      row_damage->x = begin_x;
+    if (end_x > row_damage->y)
+      row_damage->y = end_x;
+  }
+  if (layer->_damage_min_xy.x >= layer->_damage_max_xy.x) {
+    layer->_damage_min_xy = (CTUI_SVector2){begin_x, tile_y};
+    layer->_damage_max_xy = (CTUI_SVector2){end_x, tile_y + 1};
+    return;
+  }
+  if (begin_x < layer->_damage_min_xy.x)
+    layer->_damage_min_xy.x = begin_x;
+  if (end_x > layer->_damage_max_xy.x)
+    layer->_damage_max_xy.x = end_x;
+  if (tile_y < layer->_damage_min_xy.y)
+    layer->_damage_min_xy.y = tile_y;
+  if (tile_y + 1 > layer->_damage_max_xy.y)
+    layer->_damage_max_xy.y = tile_y + 1;
+}
+
+static uint32_t CTUI_resolveGlyphIndex(CTUI_Font *font, uint32_t codepoint) {
+  if (font == NULL || codepoint == 0) {
+    return CTUI_GLYPH_INDEX_NONE;
+  }
+  const CTUI_Glyph *glyph = CTUI_tryGetGlyph(font, codepoint);
+  return glyph != NULL ? (uint32_t)(glyph - font->_glyphs)
+                       : CTUI_GLYPH_INDEX_NONE;
+}
+
+static void CTUI_resolveLayerGlyphs(CTUI_ConsoleLayer *layer) {
+  if (layer->_glyph_indices == NULL) {
+    return;
+  }
+  const size_t tiles_count = layer->_tiles_wh.x * layer->_tiles_wh.y;
+  uint32_t last_codepoint = 0;
+  uint32_t last_glyph_i = CTUI_GLYPH_INDEX_NONE;
+  for (size_t tile_i = 0; tile_i < tiles_count; tile_i++) {
+    const uint32_t codepoint = layer->_codepoints[tile_i];
+    if (codepoint != last_codepoint) {
+      last_codepoint = codepoint;
+      last_glyph_i = CTUI_resolveGlyphIndex(layer->_font, codepoint);
+    }
+    layer->_glyph_indices[tile_i] = last_glyph_i;
+  }
+}
+
+static void CTUI_markLayerFullDamage(CTUI_ConsoleLayer *layer) {
+  for (size_t tile_y = 0; tile_y < layer->_tiles_wh.y; tile_y++) {
+    layer->_row_damage[tile_y] = (CTUI_SVector2){0, layer->_tiles_wh.x};
+  }
+  layer->_damage_min_xy = (CTUI_SVector2){0, 0};
+  layer->_damage_max_xy = layer->_tiles_wh;
+  layer->_generation++;
+}
+
+static int CTUI_resizeLayerGrid(CTUI_ConsoleLayer *layer,
+                                CTUI_SVector2 tiles_wh) {
+  if (layer->_tiles_wh.x == tiles_wh.x && layer->_tiles_wh.y == tiles_wh.y) {
+    return 0;
+  }
+  const size_t tiles_count = tiles_wh.x * tiles_wh.y;
+  if (tiles_count == 0) {
+    CTUI_freeLayerGrid(layer);
+    return 0;
+  }
+  uint32_t *codepoints = calloc(tiles_count, sizeof(uint32_t));
+  CTUI_Color *fgs = calloc(tiles_count, sizeof(CTUI_Color));
+  CTUI_Color *bgs = calloc(tiles_count, sizeof(CTUI_Color));
+  CTUI_SVector2 *row_damage = calloc(tiles_wh.y, sizeof(CTUI_SVector2));
+  uint32_t *glyph_indices = NULL;
+  if (layer->_is_glyph_indexed) {
+    glyph_indices = malloc(tiles_count * sizeof(uint32_t));
+  }
+  if (codepoints == NULL || fgs == NULL || bgs == NULL || row_damage == NULL ||
+      (layer->_is_glyph_indexed && glyph_indices == NULL)) {
+    free(codepoints);
+    free(fgs);
+    free(bgs);
+    free(row_damage);
+    free(glyph_indices);
+    return -1;
+  }
+  // Keep the tiles that are still inside the grid.
+  const size_t copy_w =
+      layer->_tiles_wh.x < tiles_wh.x ? layer->_tiles_wh.x : tiles_wh.x;
+  const size_t copy_h =
+      layer->_tiles_wh.y < tiles_wh.y ? layer->_tiles_wh.y : tiles_wh.y;
+  for (size_t y = 0; y < copy_h; y++) {
+    const size_t src_i = y * layer->_tiles_wh.x;
+    const size_t dst_i = y * tiles_wh.x;
+    memcpy(&codepoints[dst_i], &layer->_codepoints[src_i],
+           copy_w * sizeof(uint32_t));
+    memcpy(&fgs[dst_i], &layer->_fgs[src_i], copy_w * sizeof(CTUI_Color));
+    memcpy(&bgs[dst_i], &layer->_bgs[src_i], copy_w * sizeof(CTUI_Color));
+  }
+  CTUI_freeLayerGrid(layer);
+  layer->_codepoints = codepoints;
+  layer->_fgs = fgs;
+  layer->_bgs = bgs;
+  layer->_row_damage = row_damage;
+  layer->_glyph_indices = glyph_indices;
+  layer->_tiles_wh = tiles_wh;
+  CTUI_resolveLayerGlyphs(layer);
+  CTUI_markLayerFullDamage(layer);
+  return 0;
+}
+
 void CTUI_pushCodepoint(CTUI_ConsoleLayer *layer, uint32_t codepoint,
                         CTUI_IVector2 pos_xy, CTUI_Color fg, CTUI_Color bg) {
   if (pos_xy.x < 0 || pos_xy.y < 0) {
@@ -90,172 +443,1052 @@ void CTUI_pushCodepoint(CTUI_ConsoleLayer *layer, uint32_t codepoint,
   }
   CTUI_Console *console = layer->_console;
   if (console->_platform != NULL && console->_platform->pushCodepoint != NULL) {
+    console->_counters.cells_pushed++;
     console->_platform->pushCodepoint(layer, codepoint, pos_xy, fg, bg);
+    return;
+  }
+  if ((size_t)pos_xy.x >= layer->_tiles_wh.x ||
+      (size_t)pos_xy.y >= layer->_tiles_wh.y) {
+    return;
+  }
+  console->_counters.cells_pushed++;
+  const size_t tile_i =
+      (size_t)pos_xy.y * layer->_tiles_wh.x + (size_t)pos_xy.x;
+  if (layer->_codepoints[tile_i] == codepoint &&
+      CTUI_colorEquals(layer->_fgs[tile_i], fg) &&
+      CTUI_colorEquals(layer->_bgs[tile_i], bg)) {
+    return;
+  }
+  layer->_codepoints[tile_i] = codepoint;
+  layer->_fgs[tile_i] = fg;
+  layer->_bgs[tile_i] = bg;
+  if (layer->_glyph_indices != NULL) {
+    layer->_glyph_indices[tile_i] =
+        CTUI_resolveGlyphIndex(layer->_font, codepoint);
+  }
+  console->_counters.cells_overwritten++;
+  CTUI_markLayerRowDamage(layer, (size_t)pos_xy.y, (size_t)pos_xy.x,
+                          (size_t)pos_xy.x + 1);
+  layer->_generation++;
+}
+
+static void CTUI_pushSpanDefault(CTUI_ConsoleLayer *layer,
+                                 const CTUI_CodepointSpan *span,
+                                 CTUI_SVector2 pos_xy, CTUI_SVector2 rect_wh) {
+  int changed = 0;
+  uint64_t overwritten = 0;
+  // spans are mostly runs of few codepoints, so the last lookup is reused
+  uint32_t last_codepoint = 0;
+  uint32_t last_glyph_i = CTUI_GLYPH_INDEX_NONE;
+  for (size_t row = 0; row < rect_wh.y; row++) {
+    const size_t tile_y = pos_xy.y + row;
+    const size_t src_i = row * span->stride;
+    const size_t dst_i = tile_y * layer->_tiles_wh.x + pos_xy.x;
+    const uint32_t *codepoints = &span->codepoints[src_i];
+    uint32_t *dst_codepoints = &layer->_codepoints[dst_i];
+    CTUI_Color *dst_fgs = &layer->_fgs[dst_i];
+    CTUI_Color *dst_bgs = &layer->_bgs[dst_i];
+    size_t begin_x = rect_wh.x;
+    size_t end_x = 0;
+    for (size_t col = 0; col < rect_wh.x; col++) {
+      const CTUI_Color fg =
+          span->fgs != NULL ? span->fgs[src_i + col] : span->fg;
+      const CTUI_Color bg =
+          span->bgs != NULL ? span->bgs[src_i + col] : span->bg;
+      if (dst_codepoints[col] == codepoints[col] &&
+          CTUI_colorEquals(dst_fgs[col], fg) &&
+          CTUI_colorEquals(dst_bgs[col], bg)) {
+        continue;
+      }
+      dst_codepoints[col] = codepoints[col];
+      dst_fgs[col] = fg;
+      dst_bgs[col] = bg;
+      if (layer->_glyph_indices != NULL) {
+        if (codepoints[col] != last_codepoint) {
+          last_codepoint = codepoints[col];
+          last_glyph_i = CTUI_resolveGlyphIndex(layer->_font, last_codepoint);
+        }
+        layer->_glyph_indices[dst_i + col] = last_glyph_i;
+      }
+      overwritten++;
+      if (col < begin_x)
+        begin_x = col;
+      end_x = col + 1;
+    }
+    if (begin_x < end_x) {
+      CTUI_markLayerRowDamage(layer, tile_y, pos_xy.x + begin_x,
+                              pos_xy.x + end_x);
+      changed = 1;
+    }
+  }
+  layer->_console->_counters.cells_overwritten += overwritten;
+  if (changed) {
+    layer->_generation++;
   }
 }
 
-uint32_t CTUI_decodeUtf8Cstr(const char **str) {
-  const unsigned char *s = (const unsigned char *)*str;
-  if (*s == 0) {
-    return 0;
+void CTUI_pushSpan(CTUI_ConsoleLayer *layer, const CTUI_CodepointSpan *span,
+                   CTUI_SVector2 rect_wh, CTUI_IVector2 pos_xy) {
+  // Clip the rect to the tile grid, skipping the clipped source tiles.
+  size_t skip_x = 0;
+  size_t skip_y = 0;
+  if (pos_xy.x < 0) {
+    skip_x = (size_t)-(int64_t)pos_xy.x;
+    pos_xy.x = 0;
+  }
+  if (pos_xy.y < 0) {
+    skip_y = (size_t)-(int64_t)pos_xy.y;
+    pos_xy.y = 0;
+  }
+  if (skip_x >= rect_wh.x || skip_y >= rect_wh.y ||
+      (size_t)pos_xy.x >= layer->_tiles_wh.x ||
+      (size_t)pos_xy.y >= layer->_tiles_wh.y) {
+    return;
+  }
+  CTUI_SVector2 dst_xy = {(size_t)pos_xy.x, (size_t)pos_xy.y};
+  CTUI_SVector2 dst_wh = {rect_wh.x - skip_x, rect_wh.y - skip_y};
+  if (dst_wh.x > layer->_tiles_wh.x - dst_xy.x)
+    dst_wh.x = layer->_tiles_wh.x - dst_xy.x;
+  if (dst_wh.y > layer->_tiles_wh.y - dst_xy.y)
+    dst_wh.y = layer->_tiles_wh.y - dst_xy.y;
+  const size_t skip_i = skip_y * span->stride + skip_x;
+  CTUI_CodepointSpan clipped = *span;
+  clipped.codepoints += skip_i;
+  if (clipped.fgs != NULL)
+    clipped.fgs += skip_i;
+  if (clipped.bgs != NULL)
+    clipped.bgs += skip_i;
+
+  CTUI_PlatformVtable *platform = layer->_console->_platform;
+  layer->_console->_counters.cells_pushed += dst_wh.x * dst_wh.y;
+  if (platform != NULL && platform->pushCodepoints != NULL) {
+    platform->pushCodepoints(layer, &clipped, dst_xy, dst_wh);
+    return;
   }
+  if (platform != NULL && platform->pushCodepoint != NULL) {
+    for (size_t row = 0; row < dst_wh.y; row++) {
+      for (size_t col = 0; col < dst_wh.x; col++) {
+        const size_t src_i = row * clipped.stride + col;
+        platform->pushCodepoint(
+            layer, clipped.codepoints[src_i],
+            (CTUI_IVector2){(int)(dst_xy.x + col), (int)(dst_xy.y + row)},
+            clipped.fgs != NULL ? clipped.fgs[src_i] : clipped.fg,
+            clipped.bgs != NULL ? clipped.bgs[src_i] : clipped.bg);
+      }
+    }
+    return;
+  }
+  CTUI_pushSpanDefault(layer, &clipped, dst_xy, dst_wh);
+}
+
+void CTUI_pushRow(CTUI_ConsoleLayer *layer, const uint32_t *codepoints,
+                  const CTUI_Color *fgs, const CTUI_Color *bgs, size_t count,
+                  CTUI_IVector2 pos_xy) {
+  const CTUI_CodepointSpan span = {
+      .codepoints = codepoints, .fgs = fgs, .bgs = bgs, .stride = count};
+  CTUI_pushSpan(layer, &span, (CTUI_SVector2){count, 1}, pos_xy);
+}
+
+void CTUI_pushCodepoints(CTUI_ConsoleLayer *layer, const uint32_t *codepoints,
+                         const CTUI_Color *fgs, const CTUI_Color *bgs,
+                         CTUI_SVector2 rect_wh, CTUI_IVector2 pos_xy) {
+  const CTUI_CodepointSpan span = {
+      .codepoints = codepoints, .fgs = fgs, .bgs = bgs, .stride = rect_wh.x};
+  CTUI_pushSpan(layer, &span, rect_wh, pos_xy);
+}
 
+// Decodes the sequence at s, reading at most remaining bytes; bytes past the
+// end read as 0 like a NUL terminator would. Shared by the C string and
+// buffer decoders so both replace invalid input identically.
+static inline uint32_t CTUI_decodeUtf8Sequence(const unsigned char *s,
+                                               size_t remaining,
+                                               size_t *out_bytes) {
+#define CTUI_UTF8_BYTE(I) ((size_t)(I) < remaining ? s[(I)] : 0u)
   uint32_t codepoint;
-  int bytes;
 
   if ((s[0] & 0x80) == 0) {
     // 1-byte ASCII: 0xxxxxxx
-    codepoint = s[0];
-    bytes = 1;
+    *out_bytes = 1;
+    return s[0];
   } else if ((s[0] & 0xE0) == 0xC0) {
     // 2-byte: 110xxxxx 10xxxxxx
-    if ((s[1] & 0xC0) != 0x80) {
-      *str += 1;
+    if ((CTUI_UTF8_BYTE(1) & 0xC0) != 0x80) {
+      *out_bytes = 1;
       return UTF32_REPLACEMENT_CHARACTER;
     }
+    *out_bytes = 2;
     codepoint = ((uint32_t)(s[0] & 0x1F) << 6) | (s[1] & 0x3F);
     if (codepoint < 0x80) {
-      *str += 2;
       return UTF32_REPLACEMENT_CHARACTER;
     }
-    bytes = 2;
+    return codepoint;
   } else if ((s[0] & 0xF0) == 0xE0) {
     // 3-byte: 1110xxxx 10xxxxxx 10xxxxxx
-    if ((s[1] & 0xC0) != 0x80 || (s[2] & 0xC0) != 0x80) {
-      *str += 1;
+    if ((CTUI_UTF8_BYTE(1) & 0xC0) != 0x80 ||
+        (CTUI_UTF8_BYTE(2) & 0xC0) != 0x80) {
+      *out_bytes = 1;
       return UTF32_REPLACEMENT_CHARACTER;
     }
+    *out_bytes = 3;
     codepoint = ((uint32_t)(s[0] & 0x0F) << 12) |
                 ((uint32_t)(s[1] & 0x3F) << 6) | (s[2] & 0x3F);
     if (codepoint < 0x800) {
-      *str += 3;
       return UTF32_REPLACEMENT_CHARACTER;
     }
-    bytes = 3;
+    return codepoint;
   } else if ((s[0] & 0xF8) == 0xF0) {
     // 4-byte: 11110xxx 10xxxxxx 10xxxxxx 10xxxxxx
-    if ((s[1] & 0xC0) != 0x80 || (s[2] & 0xC0) != 0x80 ||
-        (s[3] & 0xC0) != 0x80) {
-      *str += 1;
-      return 0xFFFD;
+    if ((CTUI_UTF8_BYTE(1) & 0xC0) != 0x80 ||
+        (CTUI_UTF8_BYTE(2) & 0xC0) != 0x80 ||
+        (CTUI_UTF8_BYTE(3) & 0xC0) != 0x80) {
+      *out_bytes = 1;
+      return UTF32_REPLACEMENT_CHARACTER;
     }
+    *out_bytes = 4;
     codepoint = ((uint32_t)(s[0] & 0x07) << 18) |
                 ((uint32_t)(s[1] & 0x3F) << 12) |
                 ((uint32_t)(s[2] & 0x3F) << 6) | (s[3] & 0x3F);
     if (codepoint < 0x10000 || codepoint > 0x10FFFF) {
-      *str += 4;
       return UTF32_REPLACEMENT_CHARACTER;
     }
-    bytes = 4;
-  } else {
-    // invalid leading byte
-    *str += 1;
-    return UTF32_REPLACEMENT_CHARACTER;
+    return codepoint;
   }
+  // invalid leading byte
+  *out_bytes = 1;
+  return UTF32_REPLACEMENT_CHARACTER;
+#undef CTUI_UTF8_BYTE
+}
 
+uint32_t CTUI_decodeUtf8Cstr(const char **str) {
+  const unsigned char *s = (const unsigned char *)*str;
+  if (*s == 0) {
+    return 0;
+  }
+  // The NUL terminator stops every continuation check, so no length is needed.
+  size_t bytes;
+  const uint32_t codepoint = CTUI_decodeUtf8Sequence(s, SIZE_MAX, &bytes);
   *str += bytes;
   return codepoint;
 }
 
-void CTUI_pushCstr(CTUI_ConsoleLayer *layer, const char *text,
+size_t CTUI_decodeUtf8Buffer(const char *buffer, size_t length,
+                             uint32_t *out) {
+  const unsigned char *s = (const unsigned char *)buffer;
+  size_t in_i = 0;
+  size_t out_i = 0;
+  while (in_i < length) {
+    // All-ASCII blocks widen straight to codepoints.
+#if defined(CTUI_SIMD_AVX2)
+    while (length - in_i >= 32) {
+      const __m256i bytes = _mm256_loadu_si256((const __m256i *)(s + in_i));
+      if (_mm256_movemask_epi8(bytes) != 0) {
+        break;
+      }
+      for (size_t part = 0; part < 32; part += 8) {
+        const __m128i part_bytes =
+            _mm_loadl_epi64((const __m128i *)(s + in_i + part));
+        _mm256_storeu_si256((__m256i *)(out + out_i + part),
+                            _mm256_cvtepu8_epi32(part_bytes));
+      }
+      in_i += 32;
+      out_i += 32;
+    }
+#endif
+#if defined(CTUI_SIMD_SSE2)
+    while (length - in_i >= 16) {
+      const __m128i bytes = _mm_loadu_si128((const __m128i *)(s + in_i));
+      if (_mm_movemask_epi8(bytes) != 0) {
+        break;
+      }
+      const __m128i zero = _mm_setzero_si128();
+      const __m128i lo16 = _mm_unpacklo_epi8(bytes, zero);
+      const __m128i hi16 = _mm_unpackhi_epi8(bytes, zero);
+      __m128i *dst = (__m128i *)(out + out_i);
+      _mm_storeu_si128(dst + 0, _mm_unpacklo_epi16(lo16, zero));
+      _mm_storeu_si128(dst + 1, _mm_unpackhi_epi16(lo16, zero));
+      _mm_storeu_si128(dst + 2, _mm_unpacklo_epi16(hi16, zero));
+      _mm_storeu_si128(dst + 3, _mm_unpackhi_epi16(hi16, zero));
+      in_i += 16;
+      out_i += 16;
+    }
+#endif
+    // ASCII up to the next multi-byte sequence (or the tail of the buffer).
+    while (in_i < length && s[in_i] < 0x80) {
+      out[out_i++] = s[in_i++];
+    }
+    if (in_i >= length) {
+      break;
+    }
+    size_t bytes;
+    out[out_i++] = CTUI_decodeUtf8Sequence(s + in_i, length - in_i, &bytes);
+    in_i += bytes;
+  }
+  return out_i;
+}
+
+// Returns the end of the next decode chunk starting at begin, backed off so a
+// multi-byte sequence is never split between two chunks.
+static size_t CTUI_getUtf8ChunkEnd(const unsigned char *s, size_t begin,
+                                   size_t length) {
+  if (length - begin <= CTUI_PUSH_UTF8_CHUNK_LENGTH) {
+    return length;
+  }
+  const size_t end = begin + CTUI_PUSH_UTF8_CHUNK_LENGTH;
+  for (size_t back = 1; back <= 3; back++) {
+    const unsigned char byte = s[end - back];
+    if ((byte & 0xC0) != 0x80) {
+      return byte >= 0xC0 ? end - back : end;
+    }
+  }
+  return end;
+}
+
+static void CTUI_pushUtf8Run(CTUI_ConsoleLayer *layer,
+                             CTUI_CodepointSpan *span,
+                             const uint32_t *codepoints, size_t count, int x,
+                             int y) {
+  if (count == 0) {
+    return;
+  }
+  span->codepoints = codepoints;
+  span->stride = count;
+  CTUI_pushSpan(layer, span, (CTUI_SVector2){count, 1}, (CTUI_IVector2){x, y});
+}
+
+void CTUI_pushUtf8(CTUI_ConsoleLayer *layer, const char *text, size_t length,
                    CTUI_IVector2 pos_xy, size_t wrap_width, size_t max_height,
                    CTUI_Color fg, CTUI_Color bg) {
   if (text == NULL) {
     return;
   }
+  const unsigned char *s = (const unsigned char *)text;
+  uint32_t codepoints[CTUI_PUSH_UTF8_CHUNK_LENGTH];
+  CTUI_CodepointSpan span = {.fg = fg, .bg = bg};
   int x = pos_xy.x;
   int y = pos_xy.y;
   int start_x = pos_xy.x;
   size_t col = 0;
   size_t line = 0;
-  while (*text != '\0') {
-    if (max_height > 0 && line >= max_height) {
-      break;
-    }
-    uint32_t codepoint = CTUI_decodeUtf8Cstr(&text);
-    if (codepoint == 0) {
-      break;
-    }
-    if (codepoint == '\n') {
-      x = start_x;
-      y++;
-      col = 0;
-      line++;
-      continue;
-    }
-    if (codepoint == '\r') {
-      continue;
-    }
-    if (wrap_width > 0 && col >= wrap_width) {
-      x = start_x;
-      y++;
-      col = 0;
-      line++;
+  size_t in_i = 0;
+  while (in_i < length) {
+    const size_t chunk_end = CTUI_getUtf8ChunkEnd(s, in_i, length);
+    const size_t count =
+        CTUI_decodeUtf8Buffer(text + in_i, chunk_end - in_i, codepoints);
+    in_i = chunk_end;
+    // Consecutive codepoints on a line are pushed as one row span straight
+    // out of the decode buffer.
+    size_t run_begin = 0;
+    int run_x = x;
+    for (size_t cp_i = 0; cp_i < count; cp_i++) {
       if (max_height > 0 && line >= max_height) {
-        break;
+        return;
+      }
+      const uint32_t codepoint = codepoints[cp_i];
+      const int is_wrap = wrap_width > 0 && col >= wrap_width;
+      if (codepoint == 0 || codepoint == '\r' || codepoint == '\n' ||
+          is_wrap) {
+        CTUI_pushUtf8Run(layer, &span, &codepoints[run_begin],
+                         cp_i - run_begin, run_x, y);
+        if (codepoint == 0) {
+          return;
+        }
+        if (codepoint == '\r') {
+          run_begin = cp_i + 1;
+          run_x = x;
+          continue;
+        }
+        x = start_x;
+        y++;
+        col = 0;
+        line++;
+        run_x = x;
+        if (codepoint == '\n') {
+          run_begin = cp_i + 1;
+          continue;
+        }
+        run_begin = cp_i;
+        if (max_height > 0 && line >= max_height) {
+          return;
+        }
       }
+      x++;
+      col++;
     }
-    CTUI_pushCodepoint(layer, codepoint, (CTUI_IVector2){x, y}, fg, bg);
-    x++;
-    col++;
+    CTUI_pushUtf8Run(layer, &span, &codepoints[run_begin], count - run_begin,
+                     run_x, y);
   }
-  return;
+}
+
+void CTUI_pushCstr(CTUI_ConsoleLayer *layer, const char *text,
+                   CTUI_IVector2 pos_xy, size_t wrap_width, size_t max_height,
+                   CTUI_Color fg, CTUI_Color bg) {
+  if (text == NULL) {
+    return;
+  }
+  CTUI_pushUtf8(layer, text, strlen(text), pos_xy, wrap_width, max_height, fg,
+                bg);
 }
 
 void CTUI_fill(CTUI_ConsoleLayer *layer, uint32_t codepoint, CTUI_Color fg,
                CTUI_Color bg) {
-  if (layer->_console->_platform->fill) {
-    layer->_console->_platform->fill(layer, codepoint, fg, bg);
+  CTUI_Console *console = layer->_console;
+  console->_counters.cells_pushed += layer->_tiles_wh.x * layer->_tiles_wh.y;
+  if (console->_platform != NULL && console->_platform->fill != NULL) {
+    console->_platform->fill(layer, codepoint, fg, bg);
+    return;
+  }
+  const uint32_t glyph_i = CTUI_resolveGlyphIndex(layer->_font, codepoint);
+  int changed = 0;
+  for (size_t tile_y = 0; tile_y < layer->_tiles_wh.y; tile_y++) {
+    const size_t row_i = tile_y * layer->_tiles_wh.x;
+    size_t begin_x = layer->_tiles_wh.x;
+    size_t end_x = 0;
+    for (size_t tile_x = 0; tile_x < layer->_tiles_wh.x; tile_x++) {
+      const size_t tile_i = row_i + tile_x;
+      if (layer->_codepoints[tile_i] == codepoint &&
+          CTUI_colorEquals(layer->_fgs[tile_i], fg) &&
+          CTUI_colorEquals(layer->_bgs[tile_i], bg)) {
+        continue;
+      }
+      layer->_codepoints[tile_i] = codepoint;
+      layer->_fgs[tile_i] = fg;
+      layer->_bgs[tile_i] = bg;
+      if (layer->_glyph_indices != NULL) {
+        layer->_glyph_indices[tile_i] = glyph_i;
+      }
+      console->_counters.cells_overwritten++;
+      if (tile_x < begin_x)
+        begin_x = tile_x;
+      end_x = tile_x + 1;
+    }
+    if (begin_x < end_x) {
+      CTUI_markLayerRowDamage(layer, tile_y, begin_x, end_x);
+      changed = 1;
+    }
+  }
+  if (changed) {
+    layer->_generation++;
+  }
+}
+
+uint64_t CTUI_getMonotonicNs() {
+#ifdef _WIN32
+  LARGE_INTEGER frequency, counter;
+  QueryPerformanceFrequency(&frequency);
+  QueryPerformanceCounter(&counter);
+  const uint64_t seconds = (uint64_t)counter.QuadPart / frequency.QuadPart;
+  const uint64_t remainder = (uint64_t)counter.QuadPart % frequency.QuadPart;
+  return seconds * 1000000000ULL +
+         remainder * 1000000000ULL / (uint64_t)frequency.QuadPart;
+#else
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+#endif
+}
+
+static void CTUI_sleepUntilNs(uint64_t deadline_ns, uint64_t spin_ns) {
+  if (deadline_ns > spin_ns) {
+    const uint64_t wake_ns = deadline_ns - spin_ns;
+#ifdef _WIN32
+    const uint64_t now_ns = CTUI_getMonotonicNs();
+    if (wake_ns > now_ns) {
+      Sleep((DWORD)((wake_ns - now_ns) / 1000000ULL));
+    }
+#else
+    // Absolute deadline, so neither signals nor slack accumulate drift.
+    const struct timespec wake_time = {
+        .tv_sec = (time_t)(wake_ns / 1000000000ULL),
+        .tv_nsec = (long)(wake_ns % 1000000000ULL)};
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &wake_time,
+                           NULL) == EINTR)
+      ;
+#endif
+  }
+  while (CTUI_getMonotonicNs() < deadline_ns) {
+#if defined(CTUI_SIMD_SSE2)
+    _mm_pause();
+#endif
+  }
+}
+
+// Waits for the next frame deadline and schedules the one after it.
+static void CTUI_paceFrame(CTUI_Context *ctx) {
+  const uint64_t target_frame_ns = ctx->_target_frame_ns;
+  uint64_t now_ns = CTUI_getMonotonicNs();
+  if (ctx->_next_frame_ns == 0) {
+    ctx->_last_frame_ns = now_ns;
+    ctx->_next_frame_ns = now_ns + target_frame_ns;
+    return;
+  }
+  const uint64_t deadline_ns = ctx->_next_frame_ns;
+  if (now_ns <= deadline_ns) {
+    CTUI_sleepUntilNs(deadline_ns, ctx->_frame_spin_ns);
+    ctx->_last_frame_ns = CTUI_getMonotonicNs();
+    ctx->_next_frame_ns = deadline_ns + target_frame_ns;
+    return;
+  }
+  ctx->_missed_frame_count++;
+  ctx->_last_frame_ns = now_ns;
+  const uint64_t late_frames = (now_ns - deadline_ns) / target_frame_ns;
+  if (ctx->_frame_pacing == CTUI_FRAME_PACING_CATCH_UP &&
+      late_frames < CTUI_FRAME_PACING_MAX_CATCH_UP_FRAMES) {
+    ctx->_next_frame_ns = deadline_ns + target_frame_ns;
+    return;
+  }
+  // Skip to the first slot still ahead, keeping the original phase.
+  ctx->_skipped_frame_count += late_frames;
+  ctx->_next_frame_ns = deadline_ns + (late_frames + 1) * target_frame_ns;
+}
+
+void CTUI_addFrameStageNs(CTUI_Context *ctx, CTUI_FrameStage stage,
+                          uint64_t ns) {
+  if (stage < CTUI_FRAME_STAGE_COUNT) {
+    ctx->_frame_times.stage_ns[stage] += ns;
+  }
+}
+
+CTUI_FrameTimes CTUI_getLastFrameTimes(CTUI_Context *ctx) {
+  CTUI_FrameTimes times = {0};
+  if (ctx->_frame_history_count > 0) {
+    const size_t last_i =
+        (ctx->_frame_history_head + CTUI_FRAME_HISTORY_LENGTH - 1) %
+        CTUI_FRAME_HISTORY_LENGTH;
+    times = ctx->_frame_history[last_i];
+  }
+  return times;
+}
+
+size_t CTUI_getFrameHistoryCount(CTUI_Context *ctx) {
+  return ctx->_frame_history_count;
+}
+
+static int CTUI_compareU64(const void *a, const void *b) {
+  const uint64_t x = *(const uint64_t *)a;
+  const uint64_t y = *(const uint64_t *)b;
+  return (x > y) - (x < y);
+}
+
+uint64_t CTUI_getFrameStagePercentileNs(CTUI_Context *ctx,
+                                        CTUI_FrameStage stage,
+                                        double percentile) {
+  const size_t count = ctx->_frame_history_count;
+  if (stage >= CTUI_FRAME_STAGE_COUNT || count == 0) {
+    return 0;
+  }
+  uint64_t values[CTUI_FRAME_HISTORY_LENGTH];
+  for (size_t i = 0; i < count; i++) {
+    values[i] = ctx->_frame_history[i].stage_ns[stage];
   }
+  qsort(values, count, sizeof(uint64_t), CTUI_compareU64);
+  if (percentile <= 0.0) {
+    return values[0];
+  }
+  size_t rank = (size_t)ceil(percentile / 100.0 * (double)count);
+  if (rank > count) {
+    rank = count;
+  }
+  return values[rank - 1];
+}
+
+CTUI_ConsoleCounters CTUI_getConsoleCounters(const CTUI_Console *console) {
+  return console->_counters;
+}
+
+void CTUI_resetConsoleCounters(CTUI_Console *console) {
+  memset(&console->_counters, 0, sizeof(console->_counters));
+}
+
+static void CTUI_endFrameTimes(CTUI_Context *ctx, uint64_t end_ns) {
+  if (ctx->_refresh_end_ns != 0) {
+    ctx->_frame_times.stage_ns[CTUI_FRAME_STAGE_TOTAL] =
+        end_ns - ctx->_refresh_end_ns;
+    ctx->_frame_history[ctx->_frame_history_head] = ctx->_frame_times;
+    ctx->_frame_history_head =
+        (ctx->_frame_history_head + 1) % CTUI_FRAME_HISTORY_LENGTH;
+    if (ctx->_frame_history_count < CTUI_FRAME_HISTORY_LENGTH) {
+      ctx->_frame_history_count++;
+    }
+  }
+  memset(&ctx->_frame_times, 0, sizeof(ctx->_frame_times));
+  ctx->_refresh_end_ns = end_ns;
 }
 
 void CTUI_refresh(CTUI_Context* ctx) {
+  const uint64_t start_ns = CTUI_getMonotonicNs();
+  if (ctx->_refresh_end_ns != 0) {
+    ctx->_frame_times.stage_ns[CTUI_FRAME_STAGE_APP] +=
+        start_ns - ctx->_refresh_end_ns;
+  }
   if (ctx->_target_frame_ns > 0) {
-    uint64_t target_frame_ns = ctx->_target_frame_ns;
-    uint64_t last_frame_ns = ctx->_last_frame_ns;
-    struct timespec ts;
-    timespec_get(&ts, TIME_UTC);
-    uint64_t now_ns = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
-    if (last_frame_ns > 0) {
-      uint64_t elapsed_ns = now_ns - last_frame_ns;
-      if (elapsed_ns < target_frame_ns) {
-        uint64_t sleep_ns = target_frame_ns - elapsed_ns;
-        struct timespec sleep_time = {
-          .tv_sec = (time_t)(sleep_ns / 1000000000ULL),
-          .tv_nsec = (long)(sleep_ns % 1000000000ULL)
-        };
-        nanosleep(&sleep_time, NULL);
-      }
-    }
-    timespec_get(&ts, TIME_UTC);
-    ctx->_last_frame_ns = (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+    CTUI_paceFrame(ctx);
+    ctx->_frame_times.stage_ns[CTUI_FRAME_STAGE_SLEEP] +=
+        CTUI_getMonotonicNs() - start_ns;
   }
   for (CTUI_Console* console = ctx->_first_console; console != NULL; console = console->_next)
   {
     if (console->_platform != NULL && console->_platform->refresh != NULL) {
       console->_platform->refresh(console);
     }
+    for (size_t layer_i = 0; layer_i < console->_layer_count; layer_i++) {
+      CTUI_clearLayerDamage(CTUI_getConsoleLayer(console, layer_i));
+    }
+  }
+  CTUI_endFrameTimes(ctx, CTUI_getMonotonicNs());
+}
+
+CTUI_Context *CTUI_createContext() {
+  CTUI_Context *ctx = (CTUI_Context *)calloc(1, sizeof(CTUI_Context));
+  CTUI_initEventQueue(ctx);
+  ctx->_waiter = CTUI_createWaiter();
+  ctx->_target_frame_ns = CTUI_NS_FOR_FPS(60);
+  ctx->_last_frame_ns = 0;
+  ctx->_next_frame_ns = 0;
+  ctx->_frame_pacing = CTUI_FRAME_PACING_SKIP;
+  return ctx;
+}
+
+void CTUI_setTargetFrameNs(CTUI_Context *ctx, uint64_t target_frame_ns) {
+  if (ctx->_target_frame_ns != target_frame_ns) {
+    ctx->_next_frame_ns = 0;
+  }
+  ctx->_target_frame_ns = target_frame_ns;
+}
+
+uint64_t CTUI_getTargetFrameNs(CTUI_Context *ctx) {
+  return ctx->_target_frame_ns;
+}
+
+void CTUI_setFramePacing(CTUI_Context *ctx, CTUI_FramePacing pacing) {
+  ctx->_frame_pacing = pacing;
+}
+
+CTUI_FramePacing CTUI_getFramePacing(CTUI_Context *ctx) {
+  return ctx->_frame_pacing;
+}
+
+void CTUI_setFrameSpinNs(CTUI_Context *ctx, uint64_t spin_ns) {
+  ctx->_frame_spin_ns = spin_ns;
+}
+
+uint64_t CTUI_getFrameSpinNs(CTUI_Context *ctx) {
+  return ctx->_frame_spin_ns;
+}
+
+uint64_t CTUI_getMissedFrameCount(CTUI_Context *ctx) {
+  return ctx->_missed_frame_count;
+}
+
+uint64_t CTUI_getSkippedFrameCount(CTUI_Context *ctx) {
+  return ctx->_skipped_frame_count;
+}
+
+static inline size_t CTUI_hashGlyphCodepoint(uint32_t codepoint,
+                                             size_t mask) {
+  // Fibonacci hashing, the high bits are the best mixed.
+  return (size_t)(((uint64_t)codepoint * 0x9E3779B97F4A7C15ull) >> 32) & mask;
+}
+
+static inline size_t CTUI_getGlyphSlotProbeLength(const CTUI_Font *font,
+                                                  size_t slot_i) {
+  const size_t home_i = CTUI_hashGlyphCodepoint(
+      font->_sparse_slots[slot_i]._codepoint, font->_sparse_mask);
+  return (slot_i - home_i) & font->_sparse_mask;
+}
+
+static void CTUI_insertSparseGlyph(CTUI_Font *font, uint32_t glyph_i) {
+  CTUI_GlyphSlot incoming = {font->_glyphs[glyph_i]._codepoint, glyph_i};
+  size_t slot_i = CTUI_hashGlyphCodepoint(incoming._codepoint,
+                                          font->_sparse_mask);
+  size_t probe_length = 0;
+  for (;;) {
+    CTUI_GlyphSlot *slot = &font->_sparse_slots[slot_i];
+    if (slot->_glyph_i == CTUI_GLYPH_SLOT_EMPTY) {
+      *slot = incoming;
+      break;
+    }
+    if (slot->_codepoint == incoming._codepoint) {
+      // Duplicate codepoint, the first glyph in the file wins.
+      return;
+    }
+    const size_t resident_probe_length =
+        CTUI_getGlyphSlotProbeLength(font, slot_i);
+    if (resident_probe_length < probe_length) {
+      // Take from the rich, carry the displaced glyph onwards.
+      CTUI_GlyphSlot displaced = *slot;
+      *slot = incoming;
+      incoming = displaced;
+      if (probe_length > font->_max_probe_length) {
+        font->_max_probe_length = probe_length;
+      }
+      probe_length = resident_probe_length;
+    }
+    slot_i = (slot_i + 1) & font->_sparse_mask;
+    probe_length++;
+  }
+  if (probe_length > font->_max_probe_length) {
+    font->_max_probe_length = probe_length;
+  }
+}
+
+// Splits _glyphs into the dense array and the sparse hash.
+static int CTUI_buildGlyphTable(CTUI_Font *font) {
+  size_t dense_size = 0;
+  size_t sparse_count = 0;
+  for (size_t i = 0; i < font->_glyph_count; i++) {
+    const uint32_t codepoint = font->_glyphs[i]._codepoint;
+    if (codepoint < CTUI_GLYPH_DENSE_LIMIT) {
+      if (codepoint >= dense_size) {
+        dense_size = (size_t)codepoint + 1;
+      }
+    } else {
+      sparse_count++;
+    }
+  }
+  font->_dense_size = dense_size;
+  if (dense_size > 0) {
+    font->_dense_glyphs = calloc(dense_size, sizeof(CTUI_Glyph *));
+    if (font->_dense_glyphs == NULL) {
+      return -1;
+    }
+  }
+  // Load factor at most 1/2.
+  size_t sparse_capacity = 1;
+  while (sparse_capacity < sparse_count * 2) {
+    sparse_capacity *= 2;
+  }
+  font->_sparse_mask = sparse_capacity - 1;
+  font->_sparse_count = 0;
+  font->_max_probe_length = 0;
+  font->_sparse_slots = malloc(sparse_capacity * sizeof(CTUI_GlyphSlot));
+  if (font->_sparse_slots == NULL) {
+    return -1;
+  }
+  for (size_t slot_i = 0; slot_i < sparse_capacity; slot_i++) {
+    font->_sparse_slots[slot_i]._codepoint = 0;
+    font->_sparse_slots[slot_i]._glyph_i = CTUI_GLYPH_SLOT_EMPTY;
+  }
+  for (size_t i = 0; i < font->_glyph_count; i++) {
+    const uint32_t codepoint = font->_glyphs[i]._codepoint;
+    if (codepoint < CTUI_GLYPH_DENSE_LIMIT) {
+      if (font->_dense_glyphs[codepoint] == NULL) {
+        font->_dense_glyphs[codepoint] = &font->_glyphs[i];
+      }
+    } else if (CTUI_tryGetGlyph(font, codepoint) == NULL) {
+      CTUI_insertSparseGlyph(font, (uint32_t)i);
+      font->_sparse_count++;
+    }
+  }
+  return 0;
+}
+
+static const char CTUI_FONTBIN_MAGIC[8] = {'C', 'T', 'U', 'I',
+                                            'F', 'B', 'I', 'N'};
+
+// Sections follow at CTUI_FONTBIN_ALIGN aligned offsets: glyphs, dense glyph
+// indices (uint32_t, CTUI_GLYPH_SLOT_EMPTY if missing), sparse slots and
+// atlas pages. Files are only loaded by builds with the same byte order and
+// CTUI_Glyph layout.
+typedef struct CTUI_FontBinHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint32_t glyph_size;
+  uint32_t slot_size;
+  uint64_t file_size;
+  uint64_t image_width;
+  uint64_t image_height;
+  uint64_t image_pages;
+  uint64_t glyph_count;
+  uint64_t dense_size;
+  uint64_t sparse_capacity;
+  uint64_t sparse_count;
+  uint64_t max_probe_length;
+  uint64_t glyphs_offset;
+  uint64_t dense_offset;
+  uint64_t sparse_offset;
+  uint64_t pixels_offset;
+} CTUI_FontBinHeader;
+
+static inline uint64_t CTUI_alignFontBinOffset(uint64_t offset) {
+  return (offset + CTUI_FONTBIN_ALIGN - 1) &
+         ~(uint64_t)(CTUI_FONTBIN_ALIGN - 1);
+}
+
+static void CTUI_initFontBinHeader(const CTUI_Font *font,
+                                   CTUI_FontBinHeader *header) {
+  memset(header, 0, sizeof(*header));
+  memcpy(header->magic, CTUI_FONTBIN_MAGIC, sizeof(header->magic));
+  header->version = CTUI_FONTBIN_VERSION;
+  header->byte_order = 0x01020304;
+  header->glyph_size = sizeof(CTUI_Glyph);
+  header->slot_size = sizeof(CTUI_GlyphSlot);
+  header->image_width = font->_image._width;
+  header->image_height = font->_image._height;
+  header->image_pages = font->_image._pages;
+  header->glyph_count = font->_glyph_count;
+  header->dense_size = font->_dense_size;
+  header->sparse_capacity = font->_sparse_mask + 1;
+  header->sparse_count = font->_sparse_count;
+  header->max_probe_length = font->_max_probe_length;
+  uint64_t offset = CTUI_alignFontBinOffset(sizeof(CTUI_FontBinHeader));
+  header->glyphs_offset = offset;
+  offset = CTUI_alignFontBinOffset(offset +
+                                   header->glyph_count * sizeof(CTUI_Glyph));
+  header->dense_offset = offset;
+  offset = CTUI_alignFontBinOffset(offset +
+                                   header->dense_size * sizeof(uint32_t));
+  header->sparse_offset = offset;
+  offset = CTUI_alignFontBinOffset(
+      offset + header->sparse_capacity * sizeof(CTUI_GlyphSlot));
+  header->pixels_offset = offset;
+  header->file_size = offset + header->image_width * header->image_height *
+                                   header->image_pages * 4;
+}
+
+static int CTUI_writeFontBinSection(FILE *fp, const void *data, size_t size) {
+  static const unsigned char zeros[CTUI_FONTBIN_ALIGN] = {0};
+  if (size > 0 && fwrite(data, 1, size, fp) != size) {
+    return -1;
+  }
+  const long pos = ftell(fp);
+  if (pos < 0) {
+    return -1;
+  }
+  const size_t padding =
+      (size_t)(CTUI_alignFontBinOffset((uint64_t)pos) - (uint64_t)pos);
+  if (padding > 0 && fwrite(zeros, 1, padding, fp) != padding) {
+    return -1;
+  }
+  return 0;
+}
+
+int CTUI_writeFontBin(const CTUI_Font *font, const char *ctuifontbin_path) {
+  CTUI_FontBinHeader header;
+  CTUI_initFontBinHeader(font, &header);
+  uint32_t *dense_indices = NULL;
+  if (font->_dense_size > 0) {
+    dense_indices = malloc(font->_dense_size * sizeof(uint32_t));
+    if (dense_indices == NULL) {
+      return -1;
+    }
+    for (size_t i = 0; i < font->_dense_size; i++) {
+      dense_indices[i] =
+          font->_dense_glyphs[i] == NULL
+              ? CTUI_GLYPH_SLOT_EMPTY
+              : (uint32_t)(font->_dense_glyphs[i] - font->_glyphs);
+    }
+  }
+  FILE *fp = fopen(ctuifontbin_path, "wb");
+  if (fp == NULL) {
+    if (dense_indices != NULL) {
+      free(dense_indices);
+    }
+    return -1;
+  }
+  int result = 0;
+  if (CTUI_writeFontBinSection(fp, &header, sizeof(header)) != 0 ||
+      CTUI_writeFontBinSection(fp, font->_glyphs,
+                               font->_glyph_count * sizeof(CTUI_Glyph)) != 0 ||
+      CTUI_writeFontBinSection(fp, dense_indices,
+                               font->_dense_size * sizeof(uint32_t)) != 0 ||
+      CTUI_writeFontBinSection(fp, font->_sparse_slots,
+                               header.sparse_capacity *
+                                   sizeof(CTUI_GlyphSlot)) != 0) {
+    result = -1;
+  }
+  // The atlas pages end the file, so they are not padded.
+  const size_t pixels_size =
+      (size_t)(header.file_size - header.pixels_offset);
+  if (result == 0 && pixels_size > 0 &&
+      fwrite(font->_image._pixels, 1, pixels_size, fp) != pixels_size) {
+    result = -1;
+  }
+  if (fclose(fp) != 0) {
+    result = -1;
+  }
+  if (dense_indices != NULL) {
+    free(dense_indices);
+  }
+  return result;
+}
+
+static int CTUI_isFontBinFile(const char *path) {
+  FILE *fp = fopen(path, "rb");
+  if (fp == NULL) {
+    return 0;
+  }
+  char magic[sizeof(CTUI_FONTBIN_MAGIC)];
+  const int is_fontbin = fread(magic, 1, sizeof(magic), fp) == sizeof(magic) &&
+                         memcmp(magic, CTUI_FONTBIN_MAGIC, sizeof(magic)) == 0;
+  fclose(fp);
+  return is_fontbin;
+}
+
+static void *CTUI_mapFile(const char *path, size_t *out_size) {
+#ifdef _WIN32
+  // No mmap, read the whole file into one buffer instead.
+  FILE *fp = fopen(path, "rb");
+  if (fp == NULL) {
+    return NULL;
+  }
+  void *data = NULL;
+  if (fseek(fp, 0, SEEK_END) == 0) {
+    const long size = ftell(fp);
+    if (size > 0 && fseek(fp, 0, SEEK_SET) == 0) {
+      data = malloc((size_t)size);
+      if (data != NULL && fread(data, 1, (size_t)size, fp) != (size_t)size) {
+        free(data);
+        data = NULL;
+      }
+      *out_size = (size_t)size;
+    }
+  }
+  fclose(fp);
+  return data;
+#else
+  const int fd = open(path, O_RDONLY);
+  if (fd < 0) {
+    return NULL;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+    close(fd);
+    return NULL;
+  }
+  void *data =
+      mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (data == MAP_FAILED) {
+    return NULL;
+  }
+  *out_size = (size_t)st.st_size;
+  return data;
+#endif
+}
+
+static void CTUI_unmapFile(void *data, size_t size) {
+#ifdef _WIN32
+  (void)size;
+  free(data);
+#else
+  munmap(data, size);
+#endif
+}
+
+static int CTUI_isFontBinSectionValid(const CTUI_FontBinHeader *header,
+                                      uint64_t offset, uint64_t count,
+                                      uint64_t item_size) {
+  if (offset % CTUI_FONTBIN_ALIGN != 0 || offset > header->file_size) {
+    return 0;
+  }
+  return count <= (header->file_size - offset) / item_size;
+}
+
+static int CTUI_isFontBinImageValid(const CTUI_FontBinHeader *header) {
+  if (header->image_width == 0 || header->image_height == 0 ||
+      header->image_pages == 0 ||
+      !CTUI_isFontBinSectionValid(header, header->pixels_offset,
+                                  header->image_width, 4)) {
+    return 0;
+  }
+  // Divide instead of multiplying so a crafted header cannot wrap the size.
+  const uint64_t max_rows =
+      (header->file_size - header->pixels_offset) / 4 / header->image_width;
+  return header->image_height <= max_rows &&
+         header->image_pages <= max_rows / header->image_height;
+}
+
+static CTUI_Font *CTUI_loadFontBin(const char *ctuifontbin_path) {
+  size_t size = 0;
+  unsigned char *data = CTUI_mapFile(ctuifontbin_path, &size);
+  if (data == NULL) {
+    return NULL;
+  }
+  CTUI_FontBinHeader header;
+  if (size < sizeof(header)) {
+    CTUI_unmapFile(data, size);
+    return NULL;
+  }
+  memcpy(&header, data, sizeof(header));
+  if (memcmp(header.magic, CTUI_FONTBIN_MAGIC, sizeof(header.magic)) != 0 ||
+      header.version != CTUI_FONTBIN_VERSION ||
+      header.byte_order != 0x01020304 ||
+      header.glyph_size != sizeof(CTUI_Glyph) ||
+      header.slot_size != sizeof(CTUI_GlyphSlot) ||
+      header.file_size != size || header.glyph_count >= UINT32_MAX ||
+      header.dense_size > CTUI_GLYPH_DENSE_LIMIT ||
+      header.sparse_capacity == 0 ||
+      (header.sparse_capacity & (header.sparse_capacity - 1)) != 0 ||
+      !CTUI_isFontBinSectionValid(&header, header.glyphs_offset,
+                                  header.glyph_count, sizeof(CTUI_Glyph)) ||
+      !CTUI_isFontBinSectionValid(&header, header.dense_offset,
+                                  header.dense_size, sizeof(uint32_t)) ||
+      !CTUI_isFontBinSectionValid(&header, header.sparse_offset,
+                                  header.sparse_capacity,
+                                  sizeof(CTUI_GlyphSlot)) ||
+      !CTUI_isFontBinImageValid(&header)) {
+    CTUI_unmapFile(data, size);
+    return NULL;
+  }
+
+  CTUI_Font *font = calloc(1, sizeof(CTUI_Font));
+  if (font == NULL) {
+    CTUI_unmapFile(data, size);
+    return NULL;
+  }
+  font->_mapped_data = data;
+  font->_mapped_size = size;
+  font->_image._width = (size_t)header.image_width;
+  font->_image._height = (size_t)header.image_height;
+  font->_image._pages = (size_t)header.image_pages;
+  font->_image._pixels = data + header.pixels_offset;
+  font->_glyph_count = (size_t)header.glyph_count;
+  font->_glyphs = (CTUI_Glyph *)(data + header.glyphs_offset);
+  font->_sparse_mask = (size_t)header.sparse_capacity - 1;
+  font->_sparse_count = (size_t)header.sparse_count;
+  font->_max_probe_length = (size_t)header.max_probe_length;
+  font->_sparse_slots = (CTUI_GlyphSlot *)(data + header.sparse_offset);
+  for (size_t slot_i = 0; slot_i <= font->_sparse_mask; slot_i++) {
+    const uint32_t glyph_i = font->_sparse_slots[slot_i]._glyph_i;
+    if (glyph_i != CTUI_GLYPH_SLOT_EMPTY && glyph_i >= header.glyph_count) {
+      CTUI_destroyFont(font);
+      return NULL;
+    }
+  }
+  if (font->_max_probe_length > font->_sparse_mask) {
+    font->_max_probe_length = font->_sparse_mask;
+  }
+
+  // Glyph pointers cannot be stored, so only the dense array is rebuilt.
+  font->_dense_size = (size_t)header.dense_size;
+  if (font->_dense_size > 0) {
+    font->_dense_glyphs = calloc(font->_dense_size, sizeof(CTUI_Glyph *));
+    if (font->_dense_glyphs == NULL) {
+      CTUI_destroyFont(font);
+      return NULL;
+    }
+    const uint32_t *dense_indices =
+        (const uint32_t *)(data + header.dense_offset);
+    for (size_t i = 0; i < font->_dense_size; i++) {
+      if (dense_indices[i] == CTUI_GLYPH_SLOT_EMPTY) {
+        continue;
+      }
+      if (dense_indices[i] >= header.glyph_count) {
+        CTUI_destroyFont(font);
+        return NULL;
+      }
+      font->_dense_glyphs[i] = &font->_glyphs[dense_indices[i]];
+    }
   }
-}
-
-CTUI_Context *CTUI_createContext() {
-  CTUI_Context *ctx = (CTUI_Context *)calloc(1, sizeof(CTUI_Context));
-  CTUI_initEventQueue(ctx);
-  ctx->_target_frame_ns = CTUI_NS_FOR_FPS(60);
-  ctx->_last_frame_ns = 0;
-  return ctx;
-}
-
-void CTUI_setTargetFrameNs(CTUI_Context *ctx, uint64_t target_frame_ns) {
-  ctx->_target_frame_ns = target_frame_ns;
-}
-
-uint64_t CTUI_getTargetFrameNs(CTUI_Context *ctx) {
-  return ctx->_target_frame_ns;
+  return font;
 }
 
 CTUI_Font *CTUI_createFont(const char *ctuifont_path, const char **image_paths,
                            size_t image_count) {
+  if (CTUI_isFontBinFile(ctuifont_path)) {
+    return CTUI_loadFontBin(ctuifont_path);
+  }
   if (image_paths == NULL || image_count == 0) {
     return NULL;
   }
@@ -354,10 +1587,9 @@ CTUI_Font *CTUI_createFont(const char *ctuifont_path, const char **image_paths,
     glyph_count++;
   }
 
-  // Allocate glyph map.
-  font->_map_size = (size_t)(glyph_count * 1.5f) + 1;
-  font->_glyph_map = calloc(font->_map_size, sizeof(CTUI_Glyph));
-  if (font->_glyph_map == NULL) {
+  // Allocate glyphs.
+  font->_glyphs = calloc(glyph_count > 0 ? glyph_count : 1, sizeof(CTUI_Glyph));
+  if (font->_glyphs == NULL) {
     // TODO
     free(all_pixels);
     free(font);
@@ -367,68 +1599,457 @@ CTUI_Font *CTUI_createFont(const char *ctuifont_path, const char **image_paths,
 
   // Rewind and read glyphs.
   fseek(fp, glyph_start_pos, SEEK_SET);
-  font->_max_map_offset = 0;
 
-  while (fscanf(fp, "%d %d %d %d %d %u", &left, &right, &top, &bottom, &page,
+  while (font->_glyph_count < glyph_count &&
+         fscanf(fp, "%d %d %d %d %d %u", &left, &right, &top, &bottom, &page,
                 &codepoint) == 6) {
     // Skip rest of line. (comments)
     int c;
     while ((c = fgetc(fp)) != EOF && c != '\n')
       ;
 
-    CTUI_Glyph glyph = {0};
-    glyph._codepoint = codepoint;
-    glyph._tiles_wh.x = 1;
-    glyph._tiles_wh.y = 1;
-    glyph._tex_coords.s = (float)left / (float)img_w;
-    glyph._tex_coords.t = (float)right / (float)img_w;
-    glyph._tex_coords.p = (float)top / (float)img_h;
-    glyph._tex_coords.q = (float)bottom / (float)img_h;
-    glyph._tex_coords.page = (float)page;
-
-    // Insert into hash map.
-    const uint64_t hash = FNV_hashBuffer64_1a(&codepoint, sizeof(uint32_t));
-    const size_t initial_slot_i = hash % font->_map_size;
-    size_t offset;
-    for (offset = 0; offset < font->_map_size; offset++) {
-      size_t slot_i = (initial_slot_i + offset) % font->_map_size;
-      if (font->_glyph_map[slot_i]._tiles_wh.x == 0) {
-        font->_glyph_map[slot_i] = glyph;
-        break;
-      }
-    }
-    if (offset > font->_max_map_offset) {
-      font->_max_map_offset = offset;
-    }
+    CTUI_Glyph *glyph = &font->_glyphs[font->_glyph_count++];
+    glyph->_codepoint = codepoint;
+    glyph->_tiles_wh.x = 1;
+    glyph->_tiles_wh.y = 1;
+    glyph->_tex_coords.s = (float)left / (float)img_w;
+    glyph->_tex_coords.t = (float)right / (float)img_w;
+    glyph->_tex_coords.p = (float)top / (float)img_h;
+    glyph->_tex_coords.q = (float)bottom / (float)img_h;
+    glyph->_tex_coords.page = (float)page;
   }
-
   fclose(fp);
+
+  if (CTUI_buildGlyphTable(font) != 0) {
+    CTUI_destroyFont(font);
+    return NULL;
+  }
   return font;
 }
 
 void CTUI_destroyFont(CTUI_Font *font) {
+  if (font->_dense_glyphs != NULL) {
+    free(font->_dense_glyphs);
+  }
+  if (font->_mapped_data != NULL) {
+    CTUI_unmapFile(font->_mapped_data, font->_mapped_size);
+    free(font);
+    return;
+  }
   if (font->_image._pixels != NULL) {
     free(font->_image._pixels);
   }
-  if (font->_glyph_map != NULL) {
-    free(font->_glyph_map);
+  if (font->_glyphs != NULL) {
+    free(font->_glyphs);
+  }
+  if (font->_sparse_slots != NULL) {
+    free(font->_sparse_slots);
   }
   free(font);
 }
 
 CTUI_Glyph *CTUI_tryGetGlyph(CTUI_Font *font, uint32_t codepoint) {
-  const uint64_t hash = FNV_hashBuffer64_1a(&codepoint, sizeof(uint32_t));
-  const size_t initial_slot_i = hash % font->_map_size;
-  for (size_t offset = 0; offset <= font->_max_map_offset; offset++) {
-    size_t slot_i = (initial_slot_i + offset) % font->_map_size;
-    if (font->_glyph_map[slot_i]._codepoint == codepoint &&
-        font->_glyph_map[slot_i]._tiles_wh.x != 0) {
-      return &font->_glyph_map[slot_i];
+  if (codepoint < font->_dense_size) {
+    return font->_dense_glyphs[codepoint];
+  }
+  size_t slot_i = CTUI_hashGlyphCodepoint(codepoint, font->_sparse_mask);
+  for (size_t probe_length = 0; probe_length <= font->_max_probe_length;
+       probe_length++) {
+    const CTUI_GlyphSlot *slot = &font->_sparse_slots[slot_i];
+    if (slot->_glyph_i == CTUI_GLYPH_SLOT_EMPTY) {
+      return NULL;
+    }
+    if (slot->_codepoint == codepoint) {
+      return &font->_glyphs[slot->_glyph_i];
+    }
+    // Robin Hood order: a richer resident means the codepoint is absent.
+    if (CTUI_getGlyphSlotProbeLength(font, slot_i) < probe_length) {
+      return NULL;
+    }
+    slot_i = (slot_i + 1) & font->_sparse_mask;
+  }
+  return NULL;
+}
+
+CTUI_GlyphTableStats CTUI_getGlyphTableStats(const CTUI_Font *font) {
+  CTUI_GlyphTableStats stats = {0};
+  stats.glyph_count = font->_glyph_count;
+  stats.dense_size = font->_dense_size;
+  for (size_t i = 0; i < font->_dense_size; i++) {
+    if (font->_dense_glyphs[i] != NULL) {
+      stats.dense_count++;
+    }
+  }
+  stats.sparse_count = font->_sparse_count;
+  stats.sparse_capacity = font->_sparse_mask + 1;
+  stats.max_probe_length = font->_max_probe_length;
+  size_t probe_length_sum = 0;
+  for (size_t slot_i = 0; slot_i <= font->_sparse_mask; slot_i++) {
+    if (font->_sparse_slots[slot_i]._glyph_i != CTUI_GLYPH_SLOT_EMPTY) {
+      probe_length_sum += CTUI_getGlyphSlotProbeLength(font, slot_i);
+    }
+  }
+  if (font->_sparse_count > 0) {
+    stats.mean_probe_length =
+        (double)probe_length_sum / (double)font->_sparse_count;
+  }
+  return stats;
+}
+
+void CTUI_wakeEvents(CTUI_Context *ctx) {
+  CTUI_Waiter *waiter = ctx->_waiter;
+  if (waiter == NULL) {
+    return;
+  }
+  // Pairs with the fence in CTUI_waitEvents: either the waiter sees what was
+  // posted before this call, or this call sees the waiter.
+  atomic_thread_fence(memory_order_seq_cst);
+  if (!atomic_load_explicit(&waiter->is_waiting, memory_order_relaxed)) {
+    return;
+  }
+#ifndef _WIN32
+  const char byte = 0;
+  (void)!write(waiter->wake_fds[1], &byte, 1);
+#endif
+  CTUI_Console *console = atomic_load(&waiter->waiting_console);
+  if (console != NULL && console->_platform->wakeEvents != NULL) {
+    console->_platform->wakeEvents(console);
+  }
+}
+
+#ifndef _WIN32
+int CTUI_addWaitFd(CTUI_Context *ctx, int fd, uint64_t id) {
+  CTUI_Waiter *waiter = ctx->_waiter;
+  if (waiter == NULL || fd < 0) {
+    return -1;
+  }
+  for (size_t i = 0; i < waiter->fd_count; i++) {
+    if (waiter->fds[i].fd == fd) {
+      waiter->fds[i].id = id;
+      return 0;
+    }
+  }
+  if (waiter->fd_count == waiter->fd_capacity) {
+    size_t new_capacity =
+        waiter->fd_capacity == 0 ? 8 : waiter->fd_capacity * 2;
+    CTUI_WaitFd *new_fds =
+        realloc(waiter->fds, sizeof(CTUI_WaitFd) * new_capacity);
+    if (new_fds == NULL) {
+      return -1;
+    }
+    waiter->fds = new_fds;
+    waiter->fd_capacity = new_capacity;
+  }
+  waiter->fds[waiter->fd_count].fd = fd;
+  waiter->fds[waiter->fd_count].id = id;
+  waiter->fd_count++;
+  return 0;
+}
+
+void CTUI_removeWaitFd(CTUI_Context *ctx, int fd) {
+  CTUI_Waiter *waiter = ctx->_waiter;
+  if (waiter == NULL) {
+    return;
+  }
+  for (size_t i = 0; i < waiter->fd_count; i++) {
+    if (waiter->fds[i].fd == fd) {
+      waiter->fds[i] = waiter->fds[waiter->fd_count - 1];
+      waiter->fd_count--;
+      return;
+    }
+  }
+}
+
+static int CTUI_getPollTimeoutMs(uint64_t timeout_ns) {
+  if (timeout_ns == CTUI_WAIT_FOREVER) {
+    return -1;
+  }
+  const uint64_t timeout_ms = (timeout_ns + 999999ULL) / 1000000ULL;
+  return timeout_ms > INT_MAX ? INT_MAX : (int)timeout_ms;
+}
+
+static void CTUI_drainWakeFd(CTUI_Waiter *waiter) {
+  char bytes[64];
+  while (read(waiter->wake_fds[0], bytes, sizeof(bytes)) > 0)
+    ;
+}
+
+// Fills wake pipe, registered descriptors, then console descriptors.
+static size_t CTUI_fillPollFds(CTUI_Context *ctx, struct pollfd *poll_fds,
+                               int with_consoles) {
+  CTUI_Waiter *waiter = ctx->_waiter;
+  size_t count = 0;
+  poll_fds[count++] =
+      (struct pollfd){.fd = waiter->wake_fds[0], .events = POLLIN};
+  for (size_t i = 0; i < waiter->fd_count; i++) {
+    poll_fds[count++] =
+        (struct pollfd){.fd = waiter->fds[i].fd, .events = POLLIN};
+  }
+  if (!with_consoles) {
+    return count;
+  }
+  for (CTUI_Console *console = ctx->_first_console; console != NULL;
+       console = console->_next) {
+    if (console->_platform != NULL && console->_platform->getWaitFd != NULL) {
+      const int fd = console->_platform->getWaitFd(console);
+      if (fd >= 0) {
+        poll_fds[count++] = (struct pollfd){.fd = fd, .events = POLLIN};
+      }
+    }
+  }
+  return count;
+}
+
+static size_t CTUI_countWaitFdConsoles(CTUI_Context *ctx) {
+  size_t count = 0;
+  for (CTUI_Console *console = ctx->_first_console; console != NULL;
+       console = console->_next) {
+    if (console->_platform != NULL && console->_platform->getWaitFd != NULL) {
+      count++;
+    }
+  }
+  return count;
+}
+
+// Queues CTUI_EVENT_FD for readable registered descriptors.
+static void CTUI_pushFdEvents(CTUI_Context *ctx,
+                              const struct pollfd *poll_fds) {
+  CTUI_Waiter *waiter = ctx->_waiter;
+  for (size_t i = 0; i < waiter->fd_count; i++) {
+    if (poll_fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR)) {
+      CTUI_Event ev = {0};
+      ev.type = CTUI_EVENT_FD;
+      ev.data.fd.fd = waiter->fds[i].fd;
+      ev.data.fd.id = waiter->fds[i].id;
+      CTUI_pushEvent(ctx, &ev);
+    }
+  }
+}
+
+static void *CTUI_watchWaitFds(void *user_data) {
+  CTUI_Context *ctx = (CTUI_Context *)user_data;
+  CTUI_Waiter *waiter = ctx->_waiter;
+  struct pollfd *poll_fds = NULL;
+  size_t poll_fds_capacity = 0;
+  pthread_mutex_lock(&waiter->mutex);
+  for (;;) {
+    while (!waiter->is_watching && !waiter->is_stopping) {
+      pthread_cond_wait(&waiter->cond, &waiter->mutex);
+    }
+    if (waiter->is_stopping) {
+      break;
+    }
+    // is_watching is only set while the main thread blocks in the platform
+    // wait, and it waits for is_polling to clear before it returns, so the
+    // descriptor list is stable until poll() returns.
+    if (poll_fds_capacity < waiter->fd_count + 1) {
+      struct pollfd *new_poll_fds =
+          realloc(poll_fds, sizeof(struct pollfd) * (waiter->fd_count + 1));
+      if (new_poll_fds == NULL) {
+        waiter->is_watching = 0;
+        continue;
+      }
+      poll_fds = new_poll_fds;
+      poll_fds_capacity = waiter->fd_count + 1;
+    }
+    const size_t count = CTUI_fillPollFds(ctx, poll_fds, 0);
+    waiter->is_polling = 1;
+    pthread_mutex_unlock(&waiter->mutex);
+    poll(poll_fds, count, -1);
+    pthread_mutex_lock(&waiter->mutex);
+    waiter->is_polling = 0;
+    pthread_cond_broadcast(&waiter->cond);
+    if (waiter->is_watching) {
+      waiter->is_watching = 0;
+      CTUI_Console *console = atomic_load(&waiter->waiting_console);
+      if (console != NULL && console->_platform->wakeEvents != NULL) {
+        console->_platform->wakeEvents(console);
+      }
     }
   }
+  pthread_mutex_unlock(&waiter->mutex);
+  if (poll_fds != NULL) {
+    free(poll_fds);
+  }
   return NULL;
 }
 
+// Blocks in the platform wait while the watcher covers the descriptors.
+static void CTUI_waitPlatformEvents(CTUI_Context *ctx, CTUI_Console *console,
+                                    uint64_t timeout_ns) {
+  CTUI_Waiter *waiter = ctx->_waiter;
+  const int is_watching = waiter->fd_count > 0;
+  if (is_watching) {
+    if (!waiter->is_watcher_started) {
+      waiter->is_watcher_started =
+          pthread_create(&waiter->watcher, NULL, CTUI_watchWaitFds, ctx) == 0;
+    }
+    pthread_mutex_lock(&waiter->mutex);
+    waiter->is_watching = 1;
+    pthread_cond_broadcast(&waiter->cond);
+    pthread_mutex_unlock(&waiter->mutex);
+  }
+  console->_platform->waitEvents(console, timeout_ns);
+  if (!is_watching) {
+    return;
+  }
+  pthread_mutex_lock(&waiter->mutex);
+  waiter->is_watching = 0;
+  if (waiter->is_polling) {
+    // Kick the watcher out of poll() and wait for it, so the kick byte is not
+    // drained while it still polls an old descriptor list.
+    const char byte = 0;
+    (void)!write(waiter->wake_fds[1], &byte, 1);
+    while (waiter->is_polling) {
+      pthread_cond_wait(&waiter->cond, &waiter->mutex);
+    }
+  }
+  pthread_mutex_unlock(&waiter->mutex);
+  struct pollfd *poll_fds = malloc(sizeof(struct pollfd) *
+                                   (waiter->fd_count + 1));
+  if (poll_fds == NULL) {
+    return;
+  }
+  const size_t count = CTUI_fillPollFds(ctx, poll_fds, 0);
+  if (poll(poll_fds, count, 0) > 0) {
+    CTUI_pushFdEvents(ctx, poll_fds);
+  }
+  free(poll_fds);
+}
+
+static void CTUI_waitPollEvents(CTUI_Context *ctx, uint64_t timeout_ns) {
+  CTUI_Waiter *waiter = ctx->_waiter;
+  struct pollfd *poll_fds =
+      malloc(sizeof(struct pollfd) *
+             (1 + waiter->fd_count + CTUI_countWaitFdConsoles(ctx)));
+  if (poll_fds == NULL) {
+    return;
+  }
+  const size_t count = CTUI_fillPollFds(ctx, poll_fds, 1);
+  int ready;
+  do {
+    ready = poll(poll_fds, count, CTUI_getPollTimeoutMs(timeout_ns));
+  } while (ready < 0 && errno == EINTR);
+  if (ready > 0) {
+    CTUI_pushFdEvents(ctx, poll_fds);
+  }
+  free(poll_fds);
+}
+#else
+int CTUI_addWaitFd(CTUI_Context *ctx, int fd, uint64_t id) {
+  (void)ctx;
+  (void)fd;
+  (void)id;
+  return -1;
+}
+
+void CTUI_removeWaitFd(CTUI_Context *ctx, int fd) {
+  (void)ctx;
+  (void)fd;
+}
+#endif
+
+static uint64_t CTUI_getConsolesWaitTimeout(CTUI_Context *ctx) {
+  uint64_t timeout_ns = CTUI_WAIT_FOREVER;
+  for (CTUI_Console *console = ctx->_first_console; console != NULL;
+       console = console->_next) {
+    if (console->_platform != NULL &&
+        console->_platform->getWaitTimeout != NULL) {
+      const uint64_t console_timeout_ns =
+          console->_platform->getWaitTimeout(console);
+      if (console_timeout_ns < timeout_ns) {
+        timeout_ns = console_timeout_ns;
+      }
+    }
+  }
+  return timeout_ns;
+}
+
+// Blocks once after CTUI_pollEvents found nothing.
+static int CTUI_waitEventsOnce(CTUI_Context *ctx, uint64_t timeout_ns) {
+  CTUI_Console *blocking_console = NULL;
+  for (CTUI_Console *console = ctx->_first_console; console != NULL;
+       console = console->_next) {
+    if (console->_platform != NULL && console->_platform->waitEvents != NULL) {
+      blocking_console = console;
+      break;
+    }
+  }
+  CTUI_Waiter *waiter = ctx->_waiter;
+  if (waiter == NULL) {
+    if (blocking_console != NULL) {
+      blocking_console->_platform->waitEvents(blocking_console, timeout_ns);
+    }
+    CTUI_pollEvents(ctx);
+    return ctx->_event_queue_count > 0;
+  }
+#ifndef _WIN32
+  CTUI_drainWakeFd(waiter);
+#endif
+  atomic_store(&waiter->waiting_console, blocking_console);
+  atomic_store_explicit(&waiter->is_waiting, 1, memory_order_relaxed);
+  atomic_thread_fence(memory_order_seq_cst);
+  if (!CTUI_hasPostedEvents(ctx)) {
+#ifndef _WIN32
+    if (blocking_console != NULL) {
+      CTUI_waitPlatformEvents(ctx, blocking_console, timeout_ns);
+    } else {
+      CTUI_waitPollEvents(ctx, timeout_ns);
+    }
+#else
+    if (blocking_console != NULL) {
+      blocking_console->_platform->waitEvents(blocking_console, timeout_ns);
+    } else {
+      // No self pipe, so wait in short slices to notice posted events.
+      const uint64_t start_ns = CTUI_getMonotonicNs();
+      for (;;) {
+        const uint64_t elapsed_ns = CTUI_getMonotonicNs() - start_ns;
+        if (timeout_ns != CTUI_WAIT_FOREVER && elapsed_ns >= timeout_ns) {
+          break;
+        }
+        uint64_t slice_ms = 10;
+        if (timeout_ns != CTUI_WAIT_FOREVER &&
+            (timeout_ns - elapsed_ns) / 1000000ULL < slice_ms) {
+          slice_ms = (timeout_ns - elapsed_ns + 999999ULL) / 1000000ULL;
+        }
+        Sleep((DWORD)slice_ms);
+        if (CTUI_hasPostedEvents(ctx)) {
+          break;
+        }
+      }
+    }
+#endif
+  }
+  atomic_store(&waiter->is_waiting, 0);
+  atomic_store(&waiter->waiting_console, NULL);
+  CTUI_pollEvents(ctx);
+  return ctx->_event_queue_count > 0;
+}
+
+int CTUI_waitEvents(CTUI_Context *ctx, uint64_t timeout_ns) {
+  const uint64_t start_ns = CTUI_getMonotonicNs();
+  for (;;) {
+    CTUI_pollEvents(ctx);
+    if (ctx->_event_queue_count > 0) {
+      return 1;
+    }
+    uint64_t remaining_ns = CTUI_WAIT_FOREVER;
+    if (timeout_ns != CTUI_WAIT_FOREVER) {
+      const uint64_t elapsed_ns = CTUI_getMonotonicNs() - start_ns;
+      remaining_ns = elapsed_ns < timeout_ns ? timeout_ns - elapsed_ns : 0;
+    }
+    // Wake up when a console has to poll again, and keep waiting if that
+    // queued nothing.
+    const uint64_t console_timeout_ns = CTUI_getConsolesWaitTimeout(ctx);
+    if (console_timeout_ns >= remaining_ns) {
+      return CTUI_waitEventsOnce(ctx, remaining_ns);
+    }
+    if (CTUI_waitEventsOnce(ctx, console_timeout_ns)) {
+      return 1;
+    }
+  }
+}
+
 void CTUI_pollEvents(CTUI_Context *ctx) {
   CTUI_Console *console = ctx->_first_console;
   while (console != NULL) {
@@ -437,17 +2058,93 @@ void CTUI_pollEvents(CTUI_Context *ctx) {
     }
     console = console->_next;
   }
+  CTUI_drainPostedEvents(ctx);
+}
+
+void CTUI_setEventCoalescing(CTUI_Context *ctx, int coalescing) {
+  ctx->_event_coalescing = coalescing;
+}
+
+int CTUI_getEventCoalescing(CTUI_Context *ctx) {
+  return ctx->_event_coalescing;
+}
+
+// Folds event into the queue, returns 1 if nothing needs to be appended.
+static int CTUI_coalesceEvent(CTUI_Context *ctx, CTUI_Event *event) {
+  const int coalescing = ctx->_event_coalescing;
+  CTUI_Event *tail = NULL;
+  if (ctx->_event_queue_count > 0) {
+    tail = &ctx->_event_queue[(ctx->_event_queue_head +
+                               ctx->_event_queue_count - 1) %
+                              ctx->_event_queue_capacity];
+    if (tail->console != event->console) {
+      tail = NULL;
+    }
+  }
+  switch (event->type) {
+  case CTUI_EVENT_CURSOR_POS:
+    if ((coalescing & CTUI_COALESCE_CURSOR_TILE) && event->console != NULL) {
+      CTUI_Console *console = event->console;
+      const CTUI_IVector2 tile_xy = {
+          (int)floor(event->data.cursor_pos.tile_xy.x),
+          (int)floor(event->data.cursor_pos.tile_xy.y)};
+      if (console->_has_cursor_tile &&
+          console->_cursor_tile_xy.x == tile_xy.x &&
+          console->_cursor_tile_xy.y == tile_xy.y) {
+        return 1;
+      }
+      console->_has_cursor_tile = 1;
+      console->_cursor_tile_xy = tile_xy;
+    }
+    if ((coalescing & CTUI_COALESCE_CURSOR) && tail != NULL &&
+        tail->type == CTUI_EVENT_CURSOR_POS) {
+      tail->data.cursor_pos = event->data.cursor_pos;
+      return 1;
+    }
+    return 0;
+  case CTUI_EVENT_SCROLL:
+    if ((coalescing & CTUI_COALESCE_SCROLL) && tail != NULL &&
+        tail->type == CTUI_EVENT_SCROLL) {
+      tail->data.scroll.scroll_xy.x += event->data.scroll.scroll_xy.x;
+      tail->data.scroll.scroll_xy.y += event->data.scroll.scroll_xy.y;
+      return 1;
+    }
+    return 0;
+  case CTUI_EVENT_RESIZE:
+    if (coalescing & CTUI_COALESCE_RESIZE) {
+      for (size_t i = 0; i < ctx->_event_queue_count; i++) {
+        CTUI_Event *queued =
+            &ctx->_event_queue[(ctx->_event_queue_head + i) %
+                               ctx->_event_queue_capacity];
+        if (queued->type == CTUI_EVENT_RESIZE &&
+            queued->console == event->console) {
+          queued->type = CTUI_EVENT_NONE;
+        }
+      }
+    }
+    return 0;
+  default:
+    return 0;
+  }
 }
 
 void CTUI_pushEvent(CTUI_Context *ctx, CTUI_Event *event) {
+  if (ctx->_event_coalescing != CTUI_COALESCE_NONE &&
+      CTUI_coalesceEvent(ctx, event)) {
+    return;
+  }
   if (ctx->_event_queue_count == ctx->_event_queue_capacity) {
-    size_t new_capacity = ctx->_event_queue_capacity * 2;
+    size_t old_capacity = ctx->_event_queue_capacity;
+    size_t new_capacity = old_capacity * 2;
     CTUI_Event *new_queue =
         realloc(ctx->_event_queue, sizeof(CTUI_Event) * new_capacity);
     if (new_queue == NULL) {
       // TODO
       return;
     }
+    // Unwrap the events that wrapped around to the front of the ring.
+    memcpy(&new_queue[old_capacity], new_queue,
+           sizeof(CTUI_Event) * ctx->_event_queue_head);
     ctx->_event_queue = new_queue;
     ctx->_event_queue_capacity = new_capacity;
   }
@@ -482,6 +2179,9 @@ void CTUI_destroyContext(CTUI_Context *ctx) {
     console = next;
   }
   CTUI_freeEventQueue(ctx);
+  if (ctx->_waiter != NULL) {
+    CTUI_destroyWaiter(ctx->_waiter);
+  }
   free(ctx);
 }
 
@@ -694,6 +2394,23 @@ void CTUI_setWindowOpacity(CTUI_Console *console, float opacity) {
   }
 }
 
+uint64_t CTUI_getFrameFence(CTUI_Console *console) {
+  if (console->_platform != NULL &&
+      console->_platform->getFrameFence != NULL) {
+    return console->_platform->getFrameFence(console);
+  }
+  return 0;
+}
+
+int CTUI_waitFrameFence(CTUI_Console *console, uint64_t fence,
+                        uint64_t timeout_ns) {
+  if (console->_platform != NULL &&
+      console->_platform->waitFrameFence != NULL) {
+    return console->_platform->waitFrameFence(console, fence, timeout_ns);
+  }
+  return 1;
+}
+
 float CTUI_getWindowOpacity(CTUI_Console *console) {
   if (console->_platform != NULL &&
       console->_platform->getWindowOpacity != NULL) {
@@ -722,6 +2439,13 @@ void CTUI_setWindowedTileWh(CTUI_Console *console,
   }
 }
 
+void CTUI_resizeConsole(CTUI_Console *console,
+                        CTUI_SVector2 console_tile_wh) {
+  if (console->_platform != NULL && console->_platform->resize != NULL) {
+    console->_platform->resize(console, console_tile_wh);
+  }
+}
+
 void CTUI_setWindowedFullscreen(CTUI_Console *console) {
   if (console->_platform != NULL &&
       console->_platform->setWindowedFullscreen != NULL) {
@@ -768,8 +2492,11 @@ void CTUI_setLayerTileDivWh(CTUI_Console *console, size_t layer_i,
     tile_div_wh.x = 1;
   if (tile_div_wh.y == 0)
     tile_div_wh.y = 1;
-  // Clear layer data
   layer->_tile_div_wh = tile_div_wh;
+  // Grid dimensions depend on the divisor, so old tile positions are invalid.
+  CTUI_freeLayerGrid(layer);
+  CTUI_resizeLayerGrid(
+      layer, CTUI_calcLayerTilesWh(console->_console_tile_wh, tile_div_wh));
 }
 
 const CTUI_Font *CTUI_getFont(const CTUI_ConsoleLayer *layer) {
@@ -777,7 +2504,260 @@ const CTUI_Font *CTUI_getFont(const CTUI_ConsoleLayer *layer) {
 }
 
 void CTUI_setFont(CTUI_ConsoleLayer *layer, CTUI_Font *font) {
+  if (layer->_font == font) {
+    return;
+  }
   layer->_font = font;
+  // Every tile renders differently with a new font.
+  CTUI_resolveLayerGlyphs(layer);
+  CTUI_markLayerFullDamage(layer);
+}
+
+CTUI_SVector2 CTUI_getLayerTilesWh(const CTUI_ConsoleLayer *layer) {
+  return layer->_tiles_wh;
+}
+
+const uint32_t *CTUI_getLayerCodepoints(const CTUI_ConsoleLayer *layer) {
+  return layer->_codepoints;
+}
+
+const uint32_t *CTUI_getLayerGlyphIndices(const CTUI_ConsoleLayer *layer) {
+  return layer->_glyph_indices;
+}
+
+const CTUI_Color *CTUI_getLayerFgs(const CTUI_ConsoleLayer *layer) {
+  return layer->_fgs;
+}
+
+const CTUI_Color *CTUI_getLayerBgs(const CTUI_ConsoleLayer *layer) {
+  return layer->_bgs;
+}
+
+CTUI_ConsoleTile CTUI_getLayerTile(const CTUI_ConsoleLayer *layer,
+                                   CTUI_SVector2 tile_xy) {
+  CTUI_ConsoleTile tile = {0};
+  if (tile_xy.x >= layer->_tiles_wh.x || tile_xy.y >= layer->_tiles_wh.y) {
+    return tile;
+  }
+  const size_t tile_i = tile_xy.y * layer->_tiles_wh.x + tile_xy.x;
+  tile._codepoint = layer->_codepoints[tile_i];
+  tile._fg = layer->_fgs[tile_i];
+  tile._bg = layer->_bgs[tile_i];
+  return tile;
+}
+
+void CTUI_clearLayer(CTUI_ConsoleLayer *layer) {
+  const size_t tiles_count = layer->_tiles_wh.x * layer->_tiles_wh.y;
+  if (tiles_count == 0) {
+    return;
+  }
+  memset(layer->_codepoints, 0, tiles_count * sizeof(uint32_t));
+  memset(layer->_fgs, 0, tiles_count * sizeof(CTUI_Color));
+  memset(layer->_bgs, 0, tiles_count * sizeof(CTUI_Color));
+  if (layer->_glyph_indices != NULL) {
+    // all bits set is CTUI_GLYPH_INDEX_NONE
+    memset(layer->_glyph_indices, 0xFF, tiles_count * sizeof(uint32_t));
+  }
+  CTUI_markLayerFullDamage(layer);
+}
+
+uint64_t CTUI_getLayerGeneration(const CTUI_ConsoleLayer *layer) {
+  return layer->_generation;
+}
+
+uint64_t CTUI_getLayerCleanGeneration(const CTUI_ConsoleLayer *layer) {
+  return layer->_clean_generation;
+}
+
+int CTUI_getLayerDamage(const CTUI_ConsoleLayer *layer, CTUI_SRect *out_rect) {
+  if (layer->_damage_min_xy.x >= layer->_damage_max_xy.x) {
+    return 0;
+  }
+  out_rect->xy = layer->_damage_min_xy;
+  out_rect->wh.x = layer->_damage_max_xy.x - layer->_damage_min_xy.x;
+  out_rect->wh.y = layer->_damage_max_xy.y - layer->_damage_min_xy.y;
+  return 1;
+}
+
+int CTUI_getLayerRowDamage(const CTUI_ConsoleLayer *layer, size_t tile_y,
+                           CTUI_SRect *out_rect) {
+  if (tile_y >= layer->_tiles_wh.y) {
+    return 0;
+  }
+  const CTUI_SVector2 row_damage = layer->_row_damage[tile_y];
+  if (row_damage.x >= row_damage.y) {
+    return 0;
+  }
+  out_rect->xy = (CTUI_SVector2){row_damage.x, tile_y};
+  out_rect->wh = (CTUI_SVector2){row_damage.y - row_damage.x, 1};
+  return 1;
+}
+
+void CTUI_damageLayer(CTUI_ConsoleLayer *layer, CTUI_SRect rect) {
+  if (rect.xy.x >= layer->_tiles_wh.x || rect.xy.y >= layer->_tiles_wh.y) {
+    return;
+  }
+  size_t end_x = rect.xy.x + rect.wh.x;
+  size_t end_y = rect.xy.y + rect.wh.y;
+  if (end_x > layer->_tiles_wh.x)
+    end_x = layer->_tiles_wh.x;
+  if (end_y > layer->_tiles_wh.y)
+    end_y = layer->_tiles_wh.y;
+  if (end_x <= rect.xy.x) {
+    return;
+  }
+  for (size_t tile_y = rect.xy.y; tile_y < end_y; tile_y++) {
+    CTUI_markLayerRowDamage(layer, tile_y, rect.xy.x, end_x);
+  }
+  layer->_generation++;
+}
+
+void CTUI_clearLayerDamage(CTUI_ConsoleLayer *layer) {
+  if (layer->_damage_min_xy.x < layer->_damage_max_xy.x) {
+    for (size_t tile_y = layer->_damage_min_xy.y;
+         tile_y < layer->_damage_max_xy.y; tile_y++) {
+      layer->_row_damage[tile_y] = (CTUI_SVector2){0, 0};
+    }
+  }
+  layer->_damage_min_xy = (CTUI_SVector2){0, 0};
+  layer->_damage_max_xy = (CTUI_SVector2){0, 0};
+  layer->_clean_generation = layer->_generation;
+}
+
+int CTUI_initConsoleLayers(CTUI_Console *console, size_t layer_count,
+                           const CTUI_LayerInfo *layer_infos) {
+  size_t layer_size = sizeof(CTUI_ConsoleLayer);
+  if (console->_platform != NULL && console->_platform->layer_size != 0) {
+    layer_size = console->_platform->layer_size;
+  }
+  console->_layer_count = 0;
+  console->_layer_size = layer_size;
+  console->_layers = NULL;
+  if (layer_count == 0) {
+    return 0;
+  }
+  console->_layers = calloc(layer_count, layer_size);
+  if (console->_layers == NULL) {
+    return -1;
+  }
+  console->_layer_count = layer_count;
+  for (size_t layer_i = 0; layer_i < layer_count; layer_i++) {
+    CTUI_ConsoleLayer *layer = CTUI_getConsoleLayer(console, layer_i);
+    layer->_console = console;
+    layer->_font = layer_infos[layer_i].font;
+    layer->_tile_div_wh = layer_infos[layer_i].tile_div_wh;
+    layer->_is_glyph_indexed = layer_infos[layer_i].is_glyph_indexed;
+    // Ensure non-zero divisors
+    if (layer->_tile_div_wh.x == 0)
+      layer->_tile_div_wh.x = 1;
+    if (layer->_tile_div_wh.y == 0)
+      layer->_tile_div_wh.y = 1;
+    if (CTUI_resizeLayerGrid(layer,
+                             CTUI_calcLayerTilesWh(console->_console_tile_wh,
+                                                   layer->_tile_div_wh)) != 0) {
+      CTUI_freeConsoleLayers(console);
+      return -1;
+    }
+  }
+  return 0;
+}
+
+int CTUI_resizeConsoleLayers(CTUI_Console *console,
+                             CTUI_SVector2 console_tile_wh) {
+  console->_console_tile_wh = console_tile_wh;
+  int result = 0;
+  for (size_t layer_i = 0; layer_i < console->_layer_count; layer_i++) {
+    CTUI_ConsoleLayer *layer = CTUI_getConsoleLayer(console, layer_i);
+    if (CTUI_resizeLayerGrid(layer,
+                             CTUI_calcLayerTilesWh(console_tile_wh,
+                                                   layer->_tile_div_wh)) != 0) {
+      result = -1;
+    }
+  }
+  return result;
+}
+
+void CTUI_freeConsoleLayers(CTUI_Console *console) {
+  if (console->_layers == NULL) {
+    return;
+  }
+  for (size_t layer_i = 0; layer_i < console->_layer_count; layer_i++) {
+    CTUI_freeLayerGrid(CTUI_getConsoleLayer(console, layer_i));
+  }
+  free(console->_layers);
+  console->_layers = NULL;
+  console->_layer_count = 0;
+}
+
+// Copies the planes of the tiles in [begin_x, end_x) of row tile_y.
+static void CTUI_copyLayerSpan(CTUI_ConsoleLayer *dst,
+                               const CTUI_ConsoleLayer *src, size_t tile_y,
+                               size_t begin_x, size_t end_x) {
+  const size_t tile_i = tile_y * src->_tiles_wh.x + begin_x;
+  const size_t count = end_x - begin_x;
+  memcpy(&dst->_codepoints[tile_i], &src->_codepoints[tile_i],
+         count * sizeof(uint32_t));
+  memcpy(&dst->_fgs[tile_i], &src->_fgs[tile_i], count * sizeof(CTUI_Color));
+  memcpy(&dst->_bgs[tile_i], &src->_bgs[tile_i], count * sizeof(CTUI_Color));
+  if (dst->_glyph_indices != NULL && src->_glyph_indices != NULL) {
+    memcpy(&dst->_glyph_indices[tile_i], &src->_glyph_indices[tile_i],
+           count * sizeof(uint32_t));
+  }
+}
+
+int CTUI_snapshotConsoleLayers(CTUI_Console *snapshot, CTUI_Console *console) {
+  if (snapshot->_layer_count != console->_layer_count) {
+    CTUI_freeConsoleLayers(snapshot);
+    if (console->_layer_count > 0) {
+      snapshot->_layers =
+          calloc(console->_layer_count, sizeof(CTUI_ConsoleLayer));
+      if (snapshot->_layers == NULL) {
+        return -1;
+      }
+      snapshot->_layer_count = console->_layer_count;
+      snapshot->_layer_size = sizeof(CTUI_ConsoleLayer);
+    }
+  }
+  snapshot->_console_tile_wh = console->_console_tile_wh;
+  snapshot->_fill_bg_set = console->_fill_bg_set;
+  snapshot->_fill_bg_color = console->_fill_bg_color;
+  for (size_t layer_i = 0; layer_i < console->_layer_count; layer_i++) {
+    const CTUI_ConsoleLayer *src = CTUI_getConsoleLayer(console, layer_i);
+    CTUI_ConsoleLayer *dst = CTUI_getConsoleLayer(snapshot, layer_i);
+    dst->_console = snapshot;
+    dst->_tile_div_wh = src->_tile_div_wh;
+    dst->_font = src->_font;
+    dst->_is_glyph_indexed = src->_is_glyph_indexed;
+    // A snapshot taken at the last damage clear only lacks the damage.
+    const int is_synced = dst->_tiles_wh.x == src->_tiles_wh.x &&
+                          dst->_tiles_wh.y == src->_tiles_wh.y &&
+                          dst->_generation == src->_clean_generation;
+    if (!is_synced) {
+      if (CTUI_resizeLayerGrid(dst, src->_tiles_wh) != 0) {
+        return -1;
+      }
+      for (size_t tile_y = 0; tile_y < src->_tiles_wh.y; tile_y++) {
+        CTUI_copyLayerSpan(dst, src, tile_y, 0, src->_tiles_wh.x);
+      }
+    } else if (src->_damage_min_xy.x < src->_damage_max_xy.x) {
+      for (size_t tile_y = src->_damage_min_xy.y;
+           tile_y < src->_damage_max_xy.y; tile_y++) {
+        const CTUI_SVector2 row_damage = src->_row_damage[tile_y];
+        if (row_damage.x < row_damage.y) {
+          CTUI_copyLayerSpan(dst, src, tile_y, row_damage.x, row_damage.y);
+        }
+      }
+    }
+    if (src->_tiles_wh.y > 0) {
+      memcpy(dst->_row_damage, src->_row_damage,
+             src->_tiles_wh.y * sizeof(CTUI_SVector2));
+    }
+    dst->_damage_min_xy = src->_damage_min_xy;
+    dst->_damage_max_xy = src->_damage_max_xy;
+    dst->_generation = src->_generation;
+    dst->_clean_generation = src->_clean_generation;
+  }
+  return 0;
 }
 
 CTUI_SVector2 CTUI_getConsoleTileWh(const CTUI_Console *console) {
@@ -10,6 +10,11 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <time.h>
+
+#ifndef _WIN32
+#include <pthread.h>
+#endif
 
 // Identity matrix constant
 static const float CTUI_IDENTITY_MATRIX[16] = {
@@ -50,6 +55,27 @@ typedef struct CTUI_GlfwConsole {
   float viewport_translation[2];
   float viewport_scale[2];
   float base_transform[16];
+  // fence of the last refresh, and of the last frame swapped
+  uint64_t submitted_fence;
+  uint64_t presented_fence;
+  // render thread, see CTUI_setGlfwRenderThread
+  int is_render_threaded;
+  int is_render_stopping;
+#ifndef _WIN32
+  pthread_t render_thread;
+  pthread_mutex_t render_mutex;
+  pthread_cond_t render_cond;
+#endif
+  // the snapshot holds a frame the render thread has not drawn yet, the app
+  // thread only writes the snapshot while this is 0
+  int is_snapshot_pending;
+  CTUI_Console snapshot;
+  uint64_t snapshot_fence;
+  float snapshot_transform[16];
+  // receives the renderer stage times on the render thread
+  CTUI_Context snapshot_ctx;
+  int is_resize_pending;
+  CTUI_IVector2 pending_framebuffer_wh;
 } CTUI_GlfwConsole;
 
 static size_t CTUI_GLFW_CONSOLE_COUNT = 0;
@@ -57,26 +83,25 @@ static size_t CTUI_GLFW_CONSOLE_COUNT = 0;
 // Forward declarations
 static void CTUI_updateBaseTransform(CTUI_GlfwConsole *glfw_console);
 static void CTUI_getCombinedTransform(CTUI_GlfwConsole *glfw_console, float *out);
+#ifndef _WIN32
+static void CTUI_stopGlfwRenderThread(CTUI_GlfwConsole *glfw_console);
+#endif
 
 // Platform callbacks implementation
 
 static void CTUI_destroyGlfwConsole(CTUI_Console *console) {
   CTUI_GlfwConsole *glfw_console = (CTUI_GlfwConsole *)console;
   
+#ifndef _WIN32
+  CTUI_stopGlfwRenderThread(glfw_console);
+#endif
   if (glfw_console->renderer) {
     glfwMakeContextCurrent(glfw_console->window);
     CTUI_rendererDestroy(glfw_console->renderer);
     glfw_console->renderer = NULL;
   }
   
-  if (console->_layers) {
-    for (size_t i = 0; i < console->_layer_count; i++) {
-      if (console->_layers[i]._tiles)
-        free(console->_layers[i]._tiles);
-    }
-    free(console->_layers);
-    console->_layers = NULL;
-  }
+  CTUI_freeConsoleLayers(console);
   
   if (glfw_console->window) {
     glfwDestroyWindow(glfw_console->window);
@@ -91,6 +116,156 @@ static void CTUI_destroyGlfwConsole(CTUI_Console *console) {
   }
 }
 
+// Resizes the renderer now, or on the render thread before its next frame.
+static void CTUI_resizeGlfwRenderer(CTUI_GlfwConsole *glfw_console, int width,
+                                    int height) {
+#ifndef _WIN32
+  if (glfw_console->is_render_threaded) {
+    pthread_mutex_lock(&glfw_console->render_mutex);
+    glfw_console->pending_framebuffer_wh = (CTUI_IVector2){width, height};
+    glfw_console->is_resize_pending = 1;
+    pthread_mutex_unlock(&glfw_console->render_mutex);
+    return;
+  }
+#endif
+  glfwMakeContextCurrent(glfw_console->window);
+  if (glfw_console->renderer) {
+    glfw_console->renderer->vtable->resize(glfw_console->renderer, width,
+                                           height);
+  }
+}
+
+#ifndef _WIN32
+// Reports the renderer times and counters of the frames the render thread
+// presented since the last refresh. Called with render_mutex held and no
+// snapshot pending.
+static void CTUI_takeGlfwRenderStats(CTUI_GlfwConsole *glfw_console) {
+  CTUI_Console *console = &glfw_console->base;
+  CTUI_FrameTimes *times = &glfw_console->snapshot_ctx._frame_times;
+  for (size_t stage = CTUI_FRAME_STAGE_BUILD; stage <= CTUI_FRAME_STAGE_SWAP;
+       stage++) {
+    CTUI_addFrameStageNs(console->_ctx, (CTUI_FrameStage)stage,
+                         times->stage_ns[stage]);
+    times->stage_ns[stage] = 0;
+  }
+  CTUI_ConsoleCounters *counters = &glfw_console->snapshot._counters;
+  console->_counters.glyph_misses += counters->glyph_misses;
+  console->_counters.draw_calls += counters->draw_calls;
+  console->_counters.bytes_uploaded += counters->bytes_uploaded;
+  memset(counters, 0, sizeof(*counters));
+}
+
+// Hands the layers to the render thread, waiting only while it has not drawn
+// the previous snapshot.
+static void CTUI_submitGlfwSnapshot(CTUI_GlfwConsole *glfw_console) {
+  CTUI_Console *console = &glfw_console->base;
+  pthread_mutex_lock(&glfw_console->render_mutex);
+  if (glfw_console->is_snapshot_pending) {
+    const uint64_t wait_start_ns = CTUI_getMonotonicNs();
+    while (glfw_console->is_snapshot_pending) {
+      pthread_cond_wait(&glfw_console->render_cond,
+                        &glfw_console->render_mutex);
+    }
+    CTUI_addFrameStageNs(console->_ctx, CTUI_FRAME_STAGE_SWAP,
+                         CTUI_getMonotonicNs() - wait_start_ns);
+  }
+  CTUI_takeGlfwRenderStats(glfw_console);
+  pthread_mutex_unlock(&glfw_console->render_mutex);
+
+  if (CTUI_snapshotConsoleLayers(&glfw_console->snapshot, console) != 0) {
+    // Out of memory, a full copy is retried by the next refresh.
+    CTUI_freeConsoleLayers(&glfw_console->snapshot);
+    return;
+  }
+  float combined_transform[16];
+  CTUI_getCombinedTransform(glfw_console, combined_transform);
+
+  pthread_mutex_lock(&glfw_console->render_mutex);
+  memcpy(glfw_console->snapshot_transform, combined_transform,
+         sizeof(combined_transform));
+  glfw_console->submitted_fence++;
+  glfw_console->snapshot_fence = glfw_console->submitted_fence;
+  glfw_console->is_snapshot_pending = 1;
+  pthread_cond_broadcast(&glfw_console->render_cond);
+  pthread_mutex_unlock(&glfw_console->render_mutex);
+}
+
+static void *CTUI_runGlfwRenderThread(void *arg) {
+  CTUI_GlfwConsole *glfw_console = (CTUI_GlfwConsole *)arg;
+  CTUI_Renderer *renderer = glfw_console->renderer;
+  glfwMakeContextCurrent(glfw_console->window);
+  pthread_mutex_lock(&glfw_console->render_mutex);
+  while (1) {
+    while (!glfw_console->is_render_stopping &&
+           !glfw_console->is_snapshot_pending) {
+      pthread_cond_wait(&glfw_console->render_cond,
+                        &glfw_console->render_mutex);
+    }
+    if (glfw_console->is_render_stopping) {
+      break;
+    }
+    const int is_resize_pending = glfw_console->is_resize_pending;
+    const CTUI_IVector2 framebuffer_wh = glfw_console->pending_framebuffer_wh;
+    glfw_console->is_resize_pending = 0;
+    float transform[16];
+    memcpy(transform, glfw_console->snapshot_transform, sizeof(transform));
+    const uint64_t fence = glfw_console->snapshot_fence;
+    pthread_mutex_unlock(&glfw_console->render_mutex);
+
+    if (renderer) {
+      if (is_resize_pending) {
+        renderer->vtable->resize(renderer, framebuffer_wh.x, framebuffer_wh.y);
+      }
+      renderer->vtable->setTransform(renderer, transform);
+      renderer->vtable->render(renderer, &glfw_console->snapshot);
+    }
+    // The snapshot is free for the next frame while this one is swapped.
+    pthread_mutex_lock(&glfw_console->render_mutex);
+    glfw_console->is_snapshot_pending = 0;
+    pthread_cond_broadcast(&glfw_console->render_cond);
+    pthread_mutex_unlock(&glfw_console->render_mutex);
+
+    const uint64_t swap_start_ns = CTUI_getMonotonicNs();
+    glfwSwapBuffers(glfw_console->window);
+    const uint64_t swap_ns = CTUI_getMonotonicNs() - swap_start_ns;
+
+    pthread_mutex_lock(&glfw_console->render_mutex);
+    CTUI_addFrameStageNs(&glfw_console->snapshot_ctx, CTUI_FRAME_STAGE_SWAP,
+                         swap_ns);
+    glfw_console->presented_fence = fence;
+    pthread_cond_broadcast(&glfw_console->render_cond);
+  }
+  pthread_mutex_unlock(&glfw_console->render_mutex);
+  glfwMakeContextCurrent(NULL);
+  return NULL;
+}
+
+static void CTUI_stopGlfwRenderThread(CTUI_GlfwConsole *glfw_console) {
+  if (!glfw_console->is_render_threaded) {
+    return;
+  }
+  pthread_mutex_lock(&glfw_console->render_mutex);
+  glfw_console->is_render_stopping = 1;
+  pthread_cond_broadcast(&glfw_console->render_cond);
+  pthread_mutex_unlock(&glfw_console->render_mutex);
+  pthread_join(glfw_console->render_thread, NULL);
+  pthread_cond_destroy(&glfw_console->render_cond);
+  pthread_mutex_destroy(&glfw_console->render_mutex);
+  glfw_console->is_render_threaded = 0;
+  glfw_console->is_snapshot_pending = 0;
+  // A snapshot still pending is dropped rather than drawn.
+  glfw_console->presented_fence = glfw_console->submitted_fence;
+  CTUI_freeConsoleLayers(&glfw_console->snapshot);
+  glfwMakeContextCurrent(glfw_console->window);
+  if (glfw_console->is_resize_pending && glfw_console->renderer) {
+    glfw_console->renderer->vtable->resize(
+        glfw_console->renderer, glfw_console->pending_framebuffer_wh.x,
+        glfw_console->pending_framebuffer_wh.y);
+  }
+  glfw_console->is_resize_pending = 0;
+}
+#endif
+
 static void CTUI_refreshGlfwConsole(CTUI_Console *console) {
   CTUI_GlfwConsole *glfw_console = (CTUI_GlfwConsole *)console;
   
@@ -100,6 +275,12 @@ static void CTUI_refreshGlfwConsole(CTUI_Console *console) {
   if (console->_console_tile_wh.x == 0 || console->_console_tile_wh.y == 0) {
     return;
   }
+#ifndef _WIN32
+  if (glfw_console->is_render_threaded) {
+    CTUI_submitGlfwSnapshot(glfw_console);
+    return;
+  }
+#endif
   
   glfwMakeContextCurrent(glfw_console->window);
   
@@ -112,7 +293,55 @@ static void CTUI_refreshGlfwConsole(CTUI_Console *console) {
     glfw_console->renderer->vtable->render(glfw_console->renderer, console);
   }
   
+  const uint64_t swap_start_ns = CTUI_getMonotonicNs();
   glfwSwapBuffers(glfw_console->window);
+  CTUI_addFrameStageNs(console->_ctx, CTUI_FRAME_STAGE_SWAP,
+                       CTUI_getMonotonicNs() - swap_start_ns);
+  glfw_console->submitted_fence++;
+  glfw_console->presented_fence = glfw_console->submitted_fence;
+}
+
+static uint64_t CTUI_getFrameFenceGlfw(CTUI_Console *console) {
+  CTUI_GlfwConsole *glfw_console = (CTUI_GlfwConsole *)console;
+  return glfw_console->submitted_fence;
+}
+
+static int CTUI_waitFrameFenceGlfw(CTUI_Console *console, uint64_t fence,
+                                   uint64_t timeout_ns) {
+  CTUI_GlfwConsole *glfw_console = (CTUI_GlfwConsole *)console;
+#ifdef _WIN32
+  // Without a render thread frames are presented before refresh returns.
+  (void)timeout_ns;
+  return glfw_console->presented_fence >= fence;
+#else
+  if (!glfw_console->is_render_threaded) {
+    return glfw_console->presented_fence >= fence;
+  }
+  struct timespec deadline;
+  clock_gettime(CLOCK_REALTIME, &deadline);
+  if (timeout_ns != CTUI_WAIT_FOREVER) {
+    // Whole seconds are added apart, tv_nsec + timeout_ns could wrap.
+    const uint64_t deadline_ns =
+        (uint64_t)deadline.tv_nsec + timeout_ns % 1000000000ULL;
+    deadline.tv_sec += (time_t)(timeout_ns / 1000000000ULL +
+                                deadline_ns / 1000000000ULL);
+    deadline.tv_nsec = (long)(deadline_ns % 1000000000ULL);
+  }
+  pthread_mutex_lock(&glfw_console->render_mutex);
+  while (glfw_console->presented_fence < fence && timeout_ns > 0) {
+    if (timeout_ns == CTUI_WAIT_FOREVER) {
+      pthread_cond_wait(&glfw_console->render_cond,
+                        &glfw_console->render_mutex);
+    } else if (pthread_cond_timedwait(&glfw_console->render_cond,
+                                      &glfw_console->render_mutex,
+                                      &deadline) != 0) {
+      break;
+    }
+  }
+  const int is_presented = glfw_console->presented_fence >= fence;
+  pthread_mutex_unlock(&glfw_console->render_mutex);
+  return is_presented;
+#endif
 }
 
 static void CTUI_glfwKeyCallback(GLFWwindow *window, int key, int scancode,
@@ -184,10 +413,7 @@ static void CTUI_glfwScrollCallback(GLFWwindow *window, double xoffset, double y
 static void CTUI_glfwFramebufferSizeCallback(GLFWwindow *window, int width, int height) {
   CTUI_GlfwConsole *glfw_console = (CTUI_GlfwConsole *)glfwGetWindowUserPointer(window);
   if (glfw_console == NULL) return;
-  glfwMakeContextCurrent(window);
-  if (glfw_console->renderer) {
-    glfw_console->renderer->vtable->resize(glfw_console->renderer, width, height);
-  }
+  CTUI_resizeGlfwRenderer(glfw_console, width, height);
   CTUI_updateBaseTransform(glfw_console);
   CTUI_Console *console = &glfw_console->base;
   CTUI_Event ev = {0};
@@ -212,6 +438,22 @@ static void CTUI_pollEventsGlfwConsole(CTUI_Console *console) {
   }
 }
 
+static void CTUI_waitEventsGlfwConsole(CTUI_Console *console,
+                                       uint64_t timeout_ns) {
+  (void)console;
+  // CTUI_waitEvents polls afterwards, which also handles window close.
+  if (timeout_ns == CTUI_WAIT_FOREVER) {
+    glfwWaitEvents();
+  } else {
+    glfwWaitEventsTimeout((double)timeout_ns / 1e9);
+  }
+}
+
+static void CTUI_wakeEventsGlfwConsole(CTUI_Console *console) {
+  (void)console;
+  glfwPostEmptyEvent();
+}
+
 static void CTUI_updateBaseTransform(CTUI_GlfwConsole *glfw_console) {
   CTUI_Console *console = &glfw_console->base;
   int win_w, win_h;
@@ -315,7 +557,7 @@ static CTUI_IVector2 CTUI_getWindowPixelWhGlfw(CTUI_Console *console) {
 }
 
 static void CTUI_setViewportTileWhGlfw(CTUI_Console *console, CTUI_SVector2 tile_wh) {
-  console->_console_tile_wh = tile_wh;
+  CTUI_resizeConsoleLayers(console, tile_wh);
 }
 
 static void CTUI_fitWindowPixelWhToViewportTileWhGlfw(CTUI_Console *console) {
@@ -329,13 +571,9 @@ static void CTUI_fitWindowPixelWhToViewportTileWhGlfw(CTUI_Console *console) {
     glfw_console->is_visible = 1;
   }
   
-  glfwMakeContextCurrent(glfw_console->window);
   int fb_w, fb_h;
   glfwGetFramebufferSize(glfw_console->window, &fb_w, &fb_h);
-  
-  if (glfw_console->renderer) {
-    glfw_console->renderer->vtable->resize(glfw_console->renderer, fb_w, fb_h);
-  }
+  CTUI_resizeGlfwRenderer(glfw_console, fb_w, fb_h);
   
   CTUI_updateBaseTransform(glfw_console);
 }
@@ -352,8 +590,8 @@ static void CTUI_fitViewportTileWhToWindowPixelWhGlfw(CTUI_Console *console) {
   
   if (console->_console_tile_wh.x != new_tiles_x ||
       console->_console_tile_wh.y != new_tiles_y) {
-    console->_console_tile_wh.x = new_tiles_x;
-    console->_console_tile_wh.y = new_tiles_y;
+    CTUI_resizeConsoleLayers(console,
+                             (CTUI_SVector2){new_tiles_x, new_tiles_y});
     CTUI_updateBaseTransform(glfw_console);
   }
 }
@@ -459,6 +697,8 @@ static CTUI_PlatformVtable CTUI_PLATFORM_VTABLE_GLFW = {
     .resize = NULL,
     .refresh = CTUI_refreshGlfwConsole,
     .pollEvents = CTUI_pollEventsGlfwConsole,
+    .waitEvents = CTUI_waitEventsGlfwConsole,
+    .wakeEvents = CTUI_wakeEventsGlfwConsole,
     .getCursorViewportPos = CTUI_getCursorViewportPosGlfw,
     .getCursorTilePos = CTUI_getCursorTilePosGlfw,
     .getMouseButton = CTUI_getMouseButtonGlfw,
@@ -490,13 +730,15 @@ static CTUI_PlatformVtable CTUI_PLATFORM_VTABLE_GLFW = {
     .hideWindow = CTUI_hideWindowGlfw,
     .showWindow = CTUI_showWindowGlfw,
     .setWindowedTileWh = CTUI_setWindowedTileWhGlfw,
-    .setWindowedFullscreen = CTUI_setWindowedFullscreenGlfw
+    .setWindowedFullscreen = CTUI_setWindowedFullscreenGlfw,
+    .getFrameFence = CTUI_getFrameFenceGlfw,
+    .waitFrameFence = CTUI_waitFrameFenceGlfw
 };
 
 static CTUI_Console *CTUI_createGlfwConsoleFromWindow(
     CTUI_Context *ctx, void *glfw_window, CTUI_Renderer *renderer, 
     CTUI_DVector2 tile_pixel_wh, size_t layer_count, 
-    const CTUI_LayerInfo *layer_infos, CTUI_ColorMode color_mode) {
+    const CTUI_LayerInfo *layer_infos) {
   
   GLFWwindow *window = (GLFWwindow *)glfw_window;
   if (window == NULL) {
@@ -540,28 +782,13 @@ static CTUI_Console *CTUI_createGlfwConsoleFromWindow(
   console->_platform = &CTUI_PLATFORM_VTABLE_GLFW;
   console->_ctx = ctx;
   console->_is_real_terminal = 0;
-  console->_effective_color_mode = color_mode;
   console->_console_tile_wh = (CTUI_SVector2){.x = 0, .y = 0};
-  console->_layer_count = layer_count;
-  console->_layers = calloc(layer_count, sizeof(CTUI_ConsoleLayer));
   
-  if (console->_layers == NULL) {
+  if (CTUI_initConsoleLayers(console, layer_count, layer_infos) != 0) {
     CTUI_destroyGlfwConsole(console);
     return NULL;
   }
   
-  for (size_t i = 0; i < layer_count; ++i) {
-    console->_layers[i]._tile_div_wh = layer_infos[i].tile_div_wh;
-    if (console->_layers[i]._tile_div_wh.x == 0)
-      console->_layers[i]._tile_div_wh.x = 1.0;
-    if (console->_layers[i]._tile_div_wh.y == 0)
-      console->_layers[i]._tile_div_wh.y = 1.0;
-    console->_layers[i]._font = layer_infos[i].font;
-    console->_layers[i]._tiles = NULL;
-    console->_layers[i]._tiles_count = 0;
-    console->_layers[i]._tiles_capacity = 0;
-  }
-  
   // Link to context
   if (ctx->_first_console != NULL) {
     ctx->_first_console->_prev = console;
@@ -596,7 +823,7 @@ static void CTUI_showWindowGlfw(CTUI_Console *console) {
 
 static void CTUI_setWindowedTileWhGlfw(CTUI_Console *console, CTUI_SVector2 console_tile_wh) {
   CTUI_GlfwConsole *glfw_console = (CTUI_GlfwConsole *)console;
-  console->_console_tile_wh = console_tile_wh;
+  CTUI_resizeConsoleLayers(console, console_tile_wh);
   if (glfw_console->is_fullscreen) {
     glfwSetWindowMonitor(
         glfw_console->window, NULL, 100, 100,
@@ -612,12 +839,9 @@ static void CTUI_setWindowedTileWhGlfw(CTUI_Console *console, CTUI_SVector2 cons
     glfwShowWindow(glfw_console->window);
     glfw_console->is_visible = 1;
   }
-  glfwMakeContextCurrent(glfw_console->window);
   int fb_w, fb_h;
   glfwGetFramebufferSize(glfw_console->window, &fb_w, &fb_h);
-  if (glfw_console->renderer) {
-    glfw_console->renderer->vtable->resize(glfw_console->renderer, fb_w, fb_h);
-  }
+  CTUI_resizeGlfwRenderer(glfw_console, fb_w, fb_h);
   CTUI_updateBaseTransform(glfw_console);
 }
 
@@ -633,8 +857,7 @@ static void CTUI_setWindowedFullscreenGlfw(CTUI_Console *console) {
   size_t tiles_x = (size_t)((double)mode->width / glfw_console->tile_pixel_wh.x);
   size_t tiles_y = (size_t)((double)mode->height / glfw_console->tile_pixel_wh.y);
   
-  console->_console_tile_wh.x = tiles_x;
-  console->_console_tile_wh.y = tiles_y;
+  CTUI_resizeConsoleLayers(console, (CTUI_SVector2){tiles_x, tiles_y});
   
   glfwSetWindowMonitor(glfw_console->window, monitor, 0, 0, mode->width,
                        mode->height, mode->refreshRate);
@@ -645,13 +868,9 @@ static void CTUI_setWindowedFullscreenGlfw(CTUI_Console *console) {
     glfw_console->is_visible = 1;
   }
   
-  glfwMakeContextCurrent(glfw_console->window);
   int fb_w, fb_h;
   glfwGetFramebufferSize(glfw_console->window, &fb_w, &fb_h);
-  
-  if (glfw_console->renderer) {
-    glfw_console->renderer->vtable->resize(glfw_console->renderer, fb_w, fb_h);
-  }
+  CTUI_resizeGlfwRenderer(glfw_console, fb_w, fb_h);
   
   CTUI_updateBaseTransform(glfw_console);
 }
@@ -659,7 +878,7 @@ static void CTUI_setWindowedFullscreenGlfw(CTUI_Console *console) {
 CTUI_Console *CTUI_createGlfwOpengl33FakeTerminal(
     CTUI_Context *context, CTUI_DVector2 tile_pixel_wh,
     size_t layer_count, const CTUI_LayerInfo *layer_infos,
-    CTUI_ColorMode color_mode, const char *title) {
+    const char *title) {
   if (glfwInit() == GLFW_FALSE) {
     return NULL;
   }
@@ -682,8 +901,7 @@ CTUI_Console *CTUI_createGlfwOpengl33FakeTerminal(
     return NULL;
   }
   CTUI_Console *console = CTUI_createGlfwConsoleFromWindow(
-      context, window, renderer, tile_pixel_wh, layer_count, layer_infos,
-      color_mode);
+      context, window, renderer, tile_pixel_wh, layer_count, layer_infos);
   if (console == NULL) {
     CTUI_destroyOpenGL33Renderer(renderer);
     glfwDestroyWindow(window);
@@ -691,4 +909,53 @@ CTUI_Console *CTUI_createGlfwOpengl33FakeTerminal(
   }
   
   return console;
-}
\ No newline at end of file
+}
+
+int CTUI_setGlfwRenderThread(CTUI_Console *console, int is_enabled) {
+  if (console->_platform != &CTUI_PLATFORM_VTABLE_GLFW) {
+    return -1;
+  }
+#ifdef _WIN32
+  // No pthreads, frames are always drawn by CTUI_refresh.
+  return is_enabled ? -1 : 0;
+#else
+  CTUI_GlfwConsole *glfw_console = (CTUI_GlfwConsole *)console;
+  if (!is_enabled) {
+    CTUI_stopGlfwRenderThread(glfw_console);
+    return 0;
+  }
+  if (glfw_console->is_render_threaded) {
+    return 0;
+  }
+  if (pthread_mutex_init(&glfw_console->render_mutex, NULL) != 0) {
+    return -1;
+  }
+  if (pthread_cond_init(&glfw_console->render_cond, NULL) != 0) {
+    pthread_mutex_destroy(&glfw_console->render_mutex);
+    return -1;
+  }
+  glfw_console->is_render_stopping = 0;
+  glfw_console->is_snapshot_pending = 0;
+  glfw_console->is_resize_pending = 0;
+  glfw_console->snapshot._ctx = &glfw_console->snapshot_ctx;
+  // A context can only be current on one thread.
+  glfwMakeContextCurrent(NULL);
+  if (pthread_create(&glfw_console->render_thread, NULL,
+                     CTUI_runGlfwRenderThread, glfw_console) != 0) {
+    pthread_cond_destroy(&glfw_console->render_cond);
+    pthread_mutex_destroy(&glfw_console->render_mutex);
+    glfwMakeContextCurrent(glfw_console->window);
+    return -1;
+  }
+  glfw_console->is_render_threaded = 1;
+  return 0;
+#endif
+}
+
+int CTUI_getGlfwRenderThread(const CTUI_Console *console) {
+  if (console->_platform != &CTUI_PLATFORM_VTABLE_GLFW) {
+    return 0;
+  }
+  const CTUI_GlfwConsole *glfw_console = (const CTUI_GlfwConsole *)console;
+  return glfw_console->is_render_threaded;
+}
@@ -0,0 +1,189 @@
+// Headless Backend for CTUI
+// Keeps every layer in RAM with no window, for tests, benchmarks and render
+// hosts. Tiles are written through the default layer grid; refresh presents
+// the changed rows into a per-layer frame that can be read back.
+
+#include <ctui/ctui.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct CTUI_HeadlessLayer {
+  CTUI_ConsoleLayer base;
+  // tiles as of the last refresh, base._tiles_wh row major
+  CTUI_SVector2 frame_tiles_wh;
+  CTUI_ConsoleTile *frame_tiles;
+} CTUI_HeadlessLayer;
+
+typedef struct CTUI_HeadlessConsole {
+  CTUI_Console base;
+  size_t frame_count;
+  CTUI_DVector2 cursor_tile_pos;
+} CTUI_HeadlessConsole;
+
+static void CTUI_destroyHeadlessConsole(CTUI_Console *console) {
+  for (size_t i = 0; i < console->_layer_count; i++) {
+    CTUI_HeadlessLayer *layer =
+        (CTUI_HeadlessLayer *)CTUI_getConsoleLayer(console, i);
+    if (layer->frame_tiles != NULL) {
+      free(layer->frame_tiles);
+    }
+  }
+  CTUI_freeConsoleLayers(console);
+  free(console);
+}
+
+static void CTUI_presentHeadlessLayer(CTUI_HeadlessLayer *layer) {
+  CTUI_ConsoleLayer *base = &layer->base;
+  const CTUI_SVector2 tiles_wh = CTUI_getLayerTilesWh(base);
+  if (layer->frame_tiles_wh.x != tiles_wh.x ||
+      layer->frame_tiles_wh.y != tiles_wh.y) {
+    // Resizing damages the whole grid, so the copy below fills every tile.
+    if (layer->frame_tiles != NULL) {
+      free(layer->frame_tiles);
+    }
+    layer->frame_tiles = calloc(tiles_wh.x * tiles_wh.y,
+                                sizeof(CTUI_ConsoleTile));
+    if (layer->frame_tiles == NULL) {
+      layer->frame_tiles_wh = (CTUI_SVector2){0, 0};
+      return;
+    }
+    layer->frame_tiles_wh = tiles_wh;
+  }
+  CTUI_SRect damage;
+  if (!CTUI_getLayerDamage(base, &damage)) {
+    return;
+  }
+  const uint32_t *codepoints = CTUI_getLayerCodepoints(base);
+  const CTUI_Color *fgs = CTUI_getLayerFgs(base);
+  const CTUI_Color *bgs = CTUI_getLayerBgs(base);
+  for (size_t tile_y = damage.xy.y; tile_y < damage.xy.y + damage.wh.y;
+       tile_y++) {
+    CTUI_SRect row_damage;
+    if (!CTUI_getLayerRowDamage(base, tile_y, &row_damage)) {
+      continue;
+    }
+    const size_t begin_i = tile_y * tiles_wh.x + row_damage.xy.x;
+    const size_t end_i = begin_i + row_damage.wh.x;
+    for (size_t tile_i = begin_i; tile_i < end_i; tile_i++) {
+      layer->frame_tiles[tile_i]._codepoint = codepoints[tile_i];
+      layer->frame_tiles[tile_i]._fg = fgs[tile_i];
+      layer->frame_tiles[tile_i]._bg = bgs[tile_i];
+    }
+  }
+}
+
+static void CTUI_refreshHeadlessConsole(CTUI_Console *console) {
+  CTUI_HeadlessConsole *headless = (CTUI_HeadlessConsole *)console;
+  for (size_t i = 0; i < console->_layer_count; i++) {
+    CTUI_presentHeadlessLayer(
+        (CTUI_HeadlessLayer *)CTUI_getConsoleLayer(console, i));
+  }
+  headless->frame_count++;
+}
+
+static void CTUI_resizeHeadlessConsole(CTUI_Console *console,
+                                       CTUI_SVector2 console_tile_wh) {
+  if (console->_console_tile_wh.x == console_tile_wh.x &&
+      console->_console_tile_wh.y == console_tile_wh.y) {
+    return;
+  }
+  CTUI_resizeConsoleLayers(console, console_tile_wh);
+  CTUI_Event ev = {0};
+  ev.type = CTUI_EVENT_RESIZE;
+  ev.console = console;
+  ev.data.resize.console_tile_wh = console->_console_tile_wh;
+  CTUI_pushEvent(console->_ctx, &ev);
+}
+
+static CTUI_DVector2 CTUI_getCursorTilePosHeadless(CTUI_Console *console) {
+  CTUI_HeadlessConsole *headless = (CTUI_HeadlessConsole *)console;
+  return headless->cursor_tile_pos;
+}
+
+static void CTUI_setViewportTileWhHeadless(CTUI_Console *console,
+                                           CTUI_SVector2 tile_wh) {
+  CTUI_resizeHeadlessConsole(console, tile_wh);
+}
+
+static void CTUI_setWindowedTileWhHeadless(CTUI_Console *console,
+                                           CTUI_SVector2 tile_wh) {
+  CTUI_resizeHeadlessConsole(console, tile_wh);
+}
+
+// Platform vtable
+static CTUI_PlatformVtable CTUI_PLATFORM_VTABLE_HEADLESS = {
+    .is_resizable = 1,
+    .destroy = CTUI_destroyHeadlessConsole,
+    .resize = CTUI_resizeHeadlessConsole,
+    .refresh = CTUI_refreshHeadlessConsole,
+    .pollEvents = NULL,
+    .getCursorTilePos = CTUI_getCursorTilePosHeadless,
+    .setViewportTileWh = CTUI_setViewportTileWhHeadless,
+    .setWindowedTileWh = CTUI_setWindowedTileWhHeadless,
+    .layer_size = sizeof(CTUI_HeadlessLayer),
+    // Tiles go to the default dense layer grid.
+    .pushCodepoint = NULL,
+    .fill = NULL,
+    .pushCodepoints = NULL,
+};
+
+CTUI_Console *CTUI_createHeadlessConsole(CTUI_Context *context,
+                                         CTUI_SVector2 console_tile_wh,
+                                         size_t layer_count,
+                                         const CTUI_LayerInfo *layer_infos) {
+  CTUI_HeadlessConsole *headless = calloc(1, sizeof(CTUI_HeadlessConsole));
+  if (headless == NULL) {
+    return NULL;
+  }
+
+  // Initialize console base
+  CTUI_Console *console = &headless->base;
+  console->_platform = &CTUI_PLATFORM_VTABLE_HEADLESS;
+  console->_ctx = context;
+  console->_is_real_terminal = 0;
+  console->_console_tile_wh = console_tile_wh;
+  if (CTUI_initConsoleLayers(console, layer_count, layer_infos) != 0) {
+    free(headless);
+    return NULL;
+  }
+
+  // Link to context
+  if (context->_first_console != NULL) {
+    context->_first_console->_prev = console;
+  }
+  console->_next = context->_first_console;
+  context->_first_console = console;
+
+  return console;
+}
+
+size_t CTUI_getHeadlessFrameCount(const CTUI_Console *console) {
+  const CTUI_HeadlessConsole *headless = (const CTUI_HeadlessConsole *)console;
+  return headless->frame_count;
+}
+
+CTUI_ConsoleTile CTUI_getHeadlessTile(CTUI_Console *console, size_t layer_i,
+                                      CTUI_SVector2 tile_xy) {
+  CTUI_ConsoleTile tile = {0};
+  CTUI_HeadlessLayer *layer =
+      (CTUI_HeadlessLayer *)CTUI_getConsoleLayer(console, layer_i);
+  if (layer == NULL || tile_xy.x >= layer->frame_tiles_wh.x ||
+      tile_xy.y >= layer->frame_tiles_wh.y) {
+    return tile;
+  }
+  return layer->frame_tiles[tile_xy.y * layer->frame_tiles_wh.x + tile_xy.x];
+}
+
+void CTUI_setHeadlessCursorTilePos(CTUI_Console *console,
+                                   CTUI_DVector2 tile_pos) {
+  CTUI_HeadlessConsole *headless = (CTUI_HeadlessConsole *)console;
+  headless->cursor_tile_pos = tile_pos;
+  CTUI_Event ev = {0};
+  ev.type = CTUI_EVENT_CURSOR_POS;
+  ev.console = console;
+  ev.data.cursor_pos.viewport_xy = tile_pos;
+  ev.data.cursor_pos.tile_xy = tile_pos;
+  CTUI_pushEvent(console->_ctx, &ev);
+}
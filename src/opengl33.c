@@ -9,20 +9,60 @@
 typedef struct CTUI_GL33Vertex {
   float x, y;
   float u, v, page;
-  float fg[4];
-  float bg[4];
+  // normalized unsigned byte attributes
+  CTUI_Color fg;
+  CTUI_Color bg;
 } CTUI_GL33Vertex;
 
+// One per non-empty cell in CTUI_GL33_MODE_INSTANCED.
+typedef struct CTUI_GL33Instance {
+  // row major index into the layer grid
+  uint32_t tile_i;
+  // index into CTUI_Font::_glyphs
+  uint32_t glyph_i;
+  CTUI_Color fg;
+  CTUI_Color bg;
+} CTUI_GL33Instance;
+
 typedef struct CTUI_GL33Buffer {
   GLuint vbo;
   size_t vertex_count;
   size_t vertex_capacity;
   CTUI_GL33Vertex *vertex_data;
+  size_t instance_count;
+  size_t instance_capacity;
+  CTUI_GL33Instance *instance_data;
+  // layer state the data was built from, rebuilt only when it changes
+  int is_built;
+  const CTUI_ConsoleLayer *built_layer;
+  uint64_t built_generation;
+  const CTUI_Font *built_font;
+  CTUI_SVector2 built_console_tile_wh;
+  CTUI_DVector2 built_tile_div_wh;
+  CTUI_GL33Mode built_mode;
+  // glyph misses of the build, counted again on every frame that reuses it
+  uint64_t built_glyph_misses;
+  // the vbo holds the built data
+  int is_uploaded;
+  // CTUI_GL33_MODE_GRID textures, one texel per tile
+  GLuint glyph_index_texture;
+  GLuint fg_texture;
+  GLuint bg_texture;
+  CTUI_SVector2 grid_tiles_wh;
+  // glyph indices of a layer that is not glyph indexed
+  size_t glyph_index_capacity;
+  uint32_t *glyph_index_data;
+  // tiles changed since the textures were last uploaded
+  int is_grid_upload_pending;
+  CTUI_SRect grid_upload_rect;
 } CTUI_GL33Buffer;
 
 typedef struct CTUI_GL33FontTexture {
   CTUI_Font *font;
   GLuint texture;
+  // glyph tex coords as two RGBA32F texels per glyph: stpq, then page
+  GLuint glyph_buffer;
+  GLuint glyph_texture;
 } CTUI_GL33FontTexture;
 
 typedef struct CTUI_OpenGL33Renderer {
@@ -30,12 +70,25 @@ typedef struct CTUI_OpenGL33Renderer {
   GLuint shader;
   GLint transform_uniform_loc;
   GLuint vao;
+  CTUI_GL33Mode mode;
+  GLuint instanced_shader;
+  GLint instanced_transform_uniform_loc;
+  GLint instanced_tiles_w_uniform_loc;
+  GLint instanced_tile_wh_uniform_loc;
+  GLuint instanced_vao;
+  GLuint grid_shader;
+  GLint grid_transform_uniform_loc;
+  GLint grid_wh_uniform_loc;
+  // no attributes, the quad corners come from gl_VertexID
+  GLuint grid_vao;
   size_t buffer_count;
   CTUI_GL33Buffer *buffers;
   size_t font_texture_count;
   CTUI_GL33FontTexture *font_textures;
   float transform[16];
   int is_gl_loaded;
+  // upload time of the render in progress, split out of the draw stage
+  uint64_t upload_ns;
 } CTUI_OpenGL33Renderer;
 
 static const char *GL33_VERTEX_SHADER_SRC =
@@ -55,6 +108,80 @@ static const char *GL33_VERTEX_SHADER_SRC =
     "    bg = in_bg;\n"
     "}\n";
 
+// Corners come from gl_VertexID, the cell from the instance record and the
+// glyph rect from the glyph table.
+static const char *GL33_INSTANCED_VERTEX_SHADER_SRC =
+    "#version 330 core\n"
+    "layout(location = 0) in uvec2 in_tile_glyph;\n"
+    "layout(location = 1) in vec4 in_fg;\n"
+    "layout(location = 2) in vec4 in_bg;\n"
+    "uniform mat4 u_transform;\n"
+    "uniform uint u_tiles_w;\n"
+    "uniform vec2 u_tile_wh;\n"
+    "uniform samplerBuffer u_glyphs;\n"
+    "out vec3 uvp;\n"
+    "out vec4 fg;\n"
+    "out vec4 bg;\n"
+    "const vec2 CORNERS[6] = vec2[6](vec2(0.0, 0.0), vec2(1.0, 0.0),\n"
+    "    vec2(0.0, 1.0), vec2(1.0, 0.0), vec2(1.0, 1.0), vec2(0.0, 1.0));\n"
+    "void main() {\n"
+    "    vec2 corner = CORNERS[gl_VertexID];\n"
+    "    vec2 tile_xy = vec2(float(in_tile_glyph.x % u_tiles_w),\n"
+    "                        float(in_tile_glyph.x / u_tiles_w));\n"
+    "    vec2 pos = vec2(-1.0, 1.0) +\n"
+    "               vec2(1.0, -1.0) * (tile_xy + corner) * u_tile_wh;\n"
+    "    gl_Position = u_transform * vec4(pos, 0.0, 1.0);\n"
+    "    int glyph_texel = int(in_tile_glyph.y) * 2;\n"
+    "    vec4 stpq = texelFetch(u_glyphs, glyph_texel);\n"
+    "    float page = texelFetch(u_glyphs, glyph_texel + 1).x;\n"
+    "    uvp = vec3(mix(stpq.x, stpq.y, corner.x),\n"
+    "               mix(stpq.z, stpq.w, corner.y), page);\n"
+    "    fg = in_fg;\n"
+    "    bg = in_bg;\n"
+    "}\n";
+
+// One quad over the whole layer, positioned in tiles.
+static const char *GL33_GRID_VERTEX_SHADER_SRC =
+    "#version 330 core\n"
+    "uniform mat4 u_transform;\n"
+    "uniform vec2 u_grid_wh;\n"
+    "out vec2 grid_pos;\n"
+    "const vec2 CORNERS[6] = vec2[6](vec2(0.0, 0.0), vec2(1.0, 0.0),\n"
+    "    vec2(0.0, 1.0), vec2(1.0, 0.0), vec2(1.0, 1.0), vec2(0.0, 1.0));\n"
+    "void main() {\n"
+    "    vec2 corner = CORNERS[gl_VertexID];\n"
+    "    vec2 pos = vec2(-1.0, 1.0) + vec2(2.0, -2.0) * corner;\n"
+    "    gl_Position = u_transform * vec4(pos, 0.0, 1.0);\n"
+    "    grid_pos = corner * u_grid_wh;\n"
+    "}\n";
+
+// Looks up the tile under the fragment, then its glyph rect and the texel.
+static const char *GL33_GRID_FRAGMENT_SHADER_SRC =
+    "#version 330 core\n"
+    "uniform sampler2DArray tex;\n"
+    "uniform samplerBuffer u_glyphs;\n"
+    "uniform usampler2D u_glyph_indices;\n"
+    "uniform sampler2D u_fgs;\n"
+    "uniform sampler2D u_bgs;\n"
+    "in vec2 grid_pos;\n"
+    "out vec4 out_color;\n"
+    "void main() {\n"
+    "    ivec2 tile_xy = ivec2(grid_pos);\n"
+    "    uint glyph_i = texelFetch(u_glyph_indices, tile_xy, 0).r;\n"
+    "    if (glyph_i == 0xFFFFFFFFu) {\n"
+    "        discard;\n"
+    "    }\n"
+    "    int glyph_texel = int(glyph_i) * 2;\n"
+    "    vec4 stpq = texelFetch(u_glyphs, glyph_texel);\n"
+    "    float page = texelFetch(u_glyphs, glyph_texel + 1).x;\n"
+    "    vec2 corner = fract(grid_pos);\n"
+    "    vec3 uvp = vec3(mix(stpq.x, stpq.y, corner.x),\n"
+    "                    mix(stpq.z, stpq.w, corner.y), page);\n"
+    "    vec4 texel = texture(tex, uvp);\n"
+    "    out_color = mix(texelFetch(u_bgs, tile_xy, 0),\n"
+    "                    texelFetch(u_fgs, tile_xy, 0), texel.a);\n"
+    "}\n";
+
 static const char *GL33_FRAGMENT_SHADER_SRC =
     "#version 330 core\n"
     "uniform sampler2DArray tex;\n"
@@ -74,10 +201,11 @@ static GLuint CTUI_gl33CompileShader(GLenum type, const char *src) {
   return shader;
 }
 
-static GLuint CTUI_gl33CreateProgram(GLint *out_transform_loc) {
-  GLuint vs = CTUI_gl33CompileShader(GL_VERTEX_SHADER, GL33_VERTEX_SHADER_SRC);
-  GLuint fs =
-      CTUI_gl33CompileShader(GL_FRAGMENT_SHADER, GL33_FRAGMENT_SHADER_SRC);
+static GLuint CTUI_gl33CreateProgram(const char *vertex_src,
+                                     const char *fragment_src,
+                                     GLint *out_transform_loc) {
+  GLuint vs = CTUI_gl33CompileShader(GL_VERTEX_SHADER, vertex_src);
+  GLuint fs = CTUI_gl33CompileShader(GL_FRAGMENT_SHADER, fragment_src);
   GLuint prog = glCreateProgram();
   glAttachShader(prog, vs);
   glAttachShader(prog, fs);
@@ -104,12 +232,63 @@ static GLuint CTUI_gl33CreateFontTexture(CTUI_Font *font) {
   return texture;
 }
 
+static void CTUI_gl33CreateGlyphTable(CTUI_Font *font, GLuint *out_buffer,
+                                      GLuint *out_texture) {
+  const size_t glyph_count = font->_glyph_count > 0 ? font->_glyph_count : 1;
+  float *texels = calloc(glyph_count * 8, sizeof(float));
+  if (texels == NULL) {
+    *out_buffer = 0;
+    *out_texture = 0;
+    return;
+  }
+  for (size_t i = 0; i < font->_glyph_count; i++) {
+    CTUI_Stpqp tex_coords = CTUI_getGlyphTexCoords(&font->_glyphs[i]);
+    texels[i * 8 + 0] = tex_coords.s;
+    texels[i * 8 + 1] = tex_coords.t;
+    texels[i * 8 + 2] = tex_coords.p;
+    texels[i * 8 + 3] = tex_coords.q;
+    texels[i * 8 + 4] = tex_coords.page;
+  }
+  glGenBuffers(1, out_buffer);
+  glBindBuffer(GL_TEXTURE_BUFFER, *out_buffer);
+  glBufferData(GL_TEXTURE_BUFFER, glyph_count * 8 * sizeof(float), texels,
+               GL_STATIC_DRAW);
+  free(texels);
+  glGenTextures(1, out_texture);
+  glBindTexture(GL_TEXTURE_BUFFER, *out_texture);
+  glTexBuffer(GL_TEXTURE_BUFFER, GL_RGBA32F, *out_buffer);
+}
+
 static int CTUI_gl33Init(CTUI_Renderer *renderer) {
   CTUI_OpenGL33Renderer *gl = (CTUI_OpenGL33Renderer *)renderer;
   if (!gl->is_gl_loaded) {
     return -1;
   }
-  gl->shader = CTUI_gl33CreateProgram(&gl->transform_uniform_loc);
+  gl->shader =
+      CTUI_gl33CreateProgram(GL33_VERTEX_SHADER_SRC, GL33_FRAGMENT_SHADER_SRC,
+                             &gl->transform_uniform_loc);
+  gl->instanced_shader = CTUI_gl33CreateProgram(
+      GL33_INSTANCED_VERTEX_SHADER_SRC, GL33_FRAGMENT_SHADER_SRC,
+      &gl->instanced_transform_uniform_loc);
+  gl->instanced_tiles_w_uniform_loc =
+      glGetUniformLocation(gl->instanced_shader, "u_tiles_w");
+  gl->instanced_tile_wh_uniform_loc =
+      glGetUniformLocation(gl->instanced_shader, "u_tile_wh");
+  glUseProgram(gl->instanced_shader);
+  glUniform1i(glGetUniformLocation(gl->instanced_shader, "tex"), 0);
+  glUniform1i(glGetUniformLocation(gl->instanced_shader, "u_glyphs"), 1);
+  glGenVertexArrays(1, &gl->instanced_vao);
+  gl->grid_shader = CTUI_gl33CreateProgram(GL33_GRID_VERTEX_SHADER_SRC,
+                                           GL33_GRID_FRAGMENT_SHADER_SRC,
+                                           &gl->grid_transform_uniform_loc);
+  gl->grid_wh_uniform_loc = glGetUniformLocation(gl->grid_shader, "u_grid_wh");
+  glUseProgram(gl->grid_shader);
+  glUniform1i(glGetUniformLocation(gl->grid_shader, "tex"), 0);
+  glUniform1i(glGetUniformLocation(gl->grid_shader, "u_glyphs"), 1);
+  glUniform1i(glGetUniformLocation(gl->grid_shader, "u_glyph_indices"), 2);
+  glUniform1i(glGetUniformLocation(gl->grid_shader, "u_fgs"), 3);
+  glUniform1i(glGetUniformLocation(gl->grid_shader, "u_bgs"), 4);
+  glGenVertexArrays(1, &gl->grid_vao);
   glGenVertexArrays(1, &gl->vao);
   glBindVertexArray(gl->vao);
   memset(gl->transform, 0, sizeof(gl->transform));
@@ -142,12 +321,36 @@ static void *CTUI_gl33GetOrCreateFontTexture(CTUI_Renderer *renderer,
     return NULL;
   }
   gl->font_textures = new_textures;
-  gl->font_textures[gl->font_texture_count].font = font;
-  gl->font_textures[gl->font_texture_count].texture = texture;
+  CTUI_GL33FontTexture *font_texture =
+      &gl->font_textures[gl->font_texture_count];
+  font_texture->font = font;
+  font_texture->texture = texture;
+  CTUI_gl33CreateGlyphTable(font, &font_texture->glyph_buffer,
+                            &font_texture->glyph_texture);
   gl->font_texture_count = new_count;
   return (void *)(uintptr_t)texture;
 }
 
+static void CTUI_gl33DeleteGlyphTable(CTUI_GL33FontTexture *font_texture) {
+  if (font_texture->glyph_texture) {
+    glDeleteTextures(1, &font_texture->glyph_texture);
+  }
+  if (font_texture->glyph_buffer) {
+    glDeleteBuffers(1, &font_texture->glyph_buffer);
+  }
+}
+
+static GLuint CTUI_gl33GetGlyphTable(CTUI_OpenGL33Renderer *gl,
+                                     CTUI_Font *font) {
+  CTUI_gl33GetOrCreateFontTexture(&gl->base, font);
+  for (size_t i = 0; i < gl->font_texture_count; i++) {
+    if (gl->font_textures[i].font == font) {
+      return gl->font_textures[i].glyph_texture;
+    }
+  }
+  return 0;
+}
+
 static void CTUI_gl33FreeFontTexture(CTUI_Renderer *renderer,
                                      void *texture_handle) {
   CTUI_OpenGL33Renderer *gl = (CTUI_OpenGL33Renderer *)renderer;
@@ -155,6 +358,7 @@ static void CTUI_gl33FreeFontTexture(CTUI_Renderer *renderer,
   for (size_t i = 0; i < gl->font_texture_count; i++) {
     if (gl->font_textures[i].texture == texture) {
       glDeleteTextures(1, &texture);
+      CTUI_gl33DeleteGlyphTable(&gl->font_textures[i]);
       for (size_t j = i; j < gl->font_texture_count - 1; j++) {
         gl->font_textures[j] = gl->font_textures[j + 1];
       }
@@ -188,11 +392,384 @@ static void CTUI_gl33EnsureBuffers(CTUI_OpenGL33Renderer *gl,
     gl->buffers[i].vertex_count = 0;
     gl->buffers[i].vertex_capacity = 0;
     gl->buffers[i].vertex_data = NULL;
+    gl->buffers[i].instance_count = 0;
+    gl->buffers[i].instance_capacity = 0;
+    gl->buffers[i].instance_data = NULL;
+    gl->buffers[i].is_built = 0;
+    gl->buffers[i].is_uploaded = 0;
+    gl->buffers[i].glyph_index_texture = 0;
+    gl->buffers[i].fg_texture = 0;
+    gl->buffers[i].bg_texture = 0;
+    gl->buffers[i].grid_tiles_wh = (CTUI_SVector2){0, 0};
+    gl->buffers[i].glyph_index_capacity = 0;
+    gl->buffers[i].glyph_index_data = NULL;
+    gl->buffers[i].is_grid_upload_pending = 0;
     glGenBuffers(1, &gl->buffers[i].vbo);
   }
   gl->buffer_count = layer_count;
 }
 
+// Streams data into the bound GL_ARRAY_BUFFER.
+static void CTUI_gl33Upload(CTUI_OpenGL33Renderer *gl, CTUI_Console *console,
+                            const void *data, size_t size) {
+  const uint64_t start_ns = CTUI_getMonotonicNs();
+  glBufferData(GL_ARRAY_BUFFER, size, data, GL_STREAM_DRAW);
+  const uint64_t upload_ns = CTUI_getMonotonicNs() - start_ns;
+  gl->upload_ns += upload_ns;
+  CTUI_addFrameStageNs(console->_ctx, CTUI_FRAME_STAGE_UPLOAD, upload_ns);
+  console->_counters.bytes_uploaded += size;
+}
+
+// Returns 1 if the buffer was built from the layer as it is now.
+static int CTUI_gl33IsBufferCurrent(const CTUI_OpenGL33Renderer *gl,
+                                    const CTUI_GL33Buffer *buffer,
+                                    const CTUI_ConsoleLayer *layer,
+                                    CTUI_SVector2 console_tile_wh) {
+  const CTUI_DVector2 tile_div_wh = CTUI_getLayerTileDivWh(layer);
+  return buffer->is_built && buffer->built_layer == layer &&
+         buffer->built_generation == CTUI_getLayerGeneration(layer) &&
+         buffer->built_font == CTUI_getFont(layer) &&
+         buffer->built_console_tile_wh.x == console_tile_wh.x &&
+         buffer->built_console_tile_wh.y == console_tile_wh.y &&
+         buffer->built_tile_div_wh.x == tile_div_wh.x &&
+         buffer->built_tile_div_wh.y == tile_div_wh.y &&
+         buffer->built_mode == gl->mode;
+}
+
+static void CTUI_gl33MarkBufferBuilt(const CTUI_OpenGL33Renderer *gl,
+                                     CTUI_GL33Buffer *buffer,
+                                     const CTUI_ConsoleLayer *layer,
+                                     CTUI_SVector2 console_tile_wh,
+                                     uint64_t glyph_misses) {
+  buffer->is_built = 1;
+  buffer->built_layer = layer;
+  buffer->built_generation = CTUI_getLayerGeneration(layer);
+  buffer->built_font = CTUI_getFont(layer);
+  buffer->built_console_tile_wh = console_tile_wh;
+  buffer->built_tile_div_wh = CTUI_getLayerTileDivWh(layer);
+  buffer->built_mode = gl->mode;
+  buffer->built_glyph_misses = glyph_misses;
+}
+
+// Returns 0 on success.
+static int CTUI_gl33BuildInstances(CTUI_GL33Buffer *buffer,
+                                   CTUI_ConsoleLayer *layer,
+                                   const CTUI_Font *font) {
+  CTUI_SVector2 tiles_wh = CTUI_getLayerTilesWh(layer);
+  size_t tiles_count = tiles_wh.x * tiles_wh.y;
+  if (buffer->instance_capacity < tiles_count) {
+    CTUI_GL33Instance *new_data = realloc(
+        buffer->instance_data, tiles_count * sizeof(CTUI_GL33Instance));
+    if (new_data == NULL)
+      return -1;
+    buffer->instance_data = new_data;
+    buffer->instance_capacity = tiles_count;
+  }
+  const uint32_t *codepoints = CTUI_getLayerCodepoints(layer);
+  const uint32_t *glyph_indices = CTUI_getLayerGlyphIndices(layer);
+  const CTUI_Color *fgs = CTUI_getLayerFgs(layer);
+  const CTUI_Color *bgs = CTUI_getLayerBgs(layer);
+  for (size_t tile_i = 0; tile_i < tiles_count; tile_i++) {
+    if (codepoints[tile_i] == 0)
+      continue;
+    uint32_t glyph_i;
+    if (glyph_indices != NULL) {
+      glyph_i = glyph_indices[tile_i];
+    } else {
+      CTUI_Glyph *glyph =
+          CTUI_tryGetGlyph((CTUI_Font *)font, codepoints[tile_i]);
+      glyph_i = glyph != NULL ? (uint32_t)(glyph - font->_glyphs)
+                              : CTUI_GLYPH_INDEX_NONE;
+    }
+    if (glyph_i == CTUI_GLYPH_INDEX_NONE) {
+      // TODO error glyph
+      layer->_console->_counters.glyph_misses++;
+      continue;
+    }
+    CTUI_GL33Instance *instance =
+        &buffer->instance_data[buffer->instance_count++];
+    instance->tile_i = (uint32_t)tile_i;
+    instance->glyph_i = glyph_i;
+    instance->fg = fgs[tile_i];
+    instance->bg = bgs[tile_i];
+  }
+  return 0;
+}
+
+static void CTUI_gl33DrawInstances(CTUI_OpenGL33Renderer *gl,
+                                   CTUI_Console *console,
+                                   size_t layer_count) {
+  CTUI_SVector2 console_tile_wh = CTUI_getConsoleTileWh(console);
+  glUseProgram(gl->instanced_shader);
+  glUniformMatrix4fv(gl->instanced_transform_uniform_loc, 1, GL_FALSE,
+                     gl->transform);
+  glBindVertexArray(gl->instanced_vao);
+  for (size_t buffer_i = 0; buffer_i < layer_count; buffer_i++) {
+    CTUI_GL33Buffer *buffer = &gl->buffers[buffer_i];
+    if (buffer->instance_count == 0)
+      continue;
+    CTUI_ConsoleLayer *layer = CTUI_getConsoleLayer(console, buffer_i);
+    if (layer == NULL)
+      continue;
+    CTUI_Font *font = (CTUI_Font *)CTUI_getFont(layer);
+    if (font == NULL)
+      continue;
+    CTUI_DVector2 tile_div_wh = CTUI_getLayerTileDivWh(layer);
+    GLuint texture = (GLuint)(uintptr_t)CTUI_gl33GetOrCreateFontTexture(
+        &gl->base, font);
+    GLuint glyph_texture = CTUI_gl33GetGlyphTable(gl, font);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_BUFFER, glyph_texture);
+    glUniform1ui(gl->instanced_tiles_w_uniform_loc,
+                 (GLuint)CTUI_getLayerTilesWh(layer).x);
+    glUniform2f(gl->instanced_tile_wh_uniform_loc,
+                2.0f / (float)((double)console_tile_wh.x * tile_div_wh.x),
+                2.0f / (float)((double)console_tile_wh.y * tile_div_wh.y));
+    glBindBuffer(GL_ARRAY_BUFFER, buffer->vbo);
+    if (!buffer->is_uploaded) {
+      CTUI_gl33Upload(gl, console, buffer->instance_data,
+                      sizeof(CTUI_GL33Instance) * buffer->instance_count);
+      buffer->is_uploaded = 1;
+    }
+    glEnableVertexAttribArray(0);
+    glVertexAttribIPointer(0, 2, GL_UNSIGNED_INT, sizeof(CTUI_GL33Instance),
+                           (void *)offsetof(CTUI_GL33Instance, tile_i));
+    glVertexAttribDivisor(0, 1);
+    glEnableVertexAttribArray(1);
+    glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE,
+                          sizeof(CTUI_GL33Instance),
+                          (void *)offsetof(CTUI_GL33Instance, fg));
+    glVertexAttribDivisor(1, 1);
+    glEnableVertexAttribArray(2);
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE,
+                          sizeof(CTUI_GL33Instance),
+                          (void *)offsetof(CTUI_GL33Instance, bg));
+    glVertexAttribDivisor(2, 1);
+    glDrawArraysInstanced(GL_TRIANGLES, 0, 6, (GLsizei)buffer->instance_count);
+    console->_counters.draw_calls++;
+  }
+  glActiveTexture(GL_TEXTURE0);
+}
+
+// Returns 1 if the grid textures hold the layer as of its last damage clear,
+// so only the damage needs uploading.
+static int CTUI_gl33IsGridRetained(const CTUI_OpenGL33Renderer *gl,
+                                   const CTUI_GL33Buffer *buffer,
+                                   const CTUI_ConsoleLayer *layer,
+                                   CTUI_SVector2 console_tile_wh) {
+  const CTUI_DVector2 tile_div_wh = CTUI_getLayerTileDivWh(layer);
+  return gl->mode == CTUI_GL33_MODE_GRID && buffer->is_built &&
+         buffer->built_mode == CTUI_GL33_MODE_GRID &&
+         buffer->built_layer == layer &&
+         buffer->built_generation == CTUI_getLayerCleanGeneration(layer) &&
+         buffer->built_font == CTUI_getFont(layer) &&
+         buffer->built_console_tile_wh.x == console_tile_wh.x &&
+         buffer->built_console_tile_wh.y == console_tile_wh.y &&
+         buffer->built_tile_div_wh.x == tile_div_wh.x &&
+         buffer->built_tile_div_wh.y == tile_div_wh.y;
+}
+
+// Queues the tiles to upload, resolving their glyphs if the layer is not
+// glyph indexed. Returns 0 on success.
+static int CTUI_gl33BuildGrid(CTUI_GL33Buffer *buffer, CTUI_ConsoleLayer *layer,
+                              const CTUI_Font *font, int is_retained) {
+  const CTUI_SVector2 tiles_wh = CTUI_getLayerTilesWh(layer);
+  CTUI_SRect rect = {{0, 0}, tiles_wh};
+  if (is_retained && !CTUI_getLayerDamage(layer, &rect)) {
+    return 0;
+  }
+  if (rect.wh.x == 0 || rect.wh.y == 0) {
+    return 0;
+  }
+  if (CTUI_getLayerGlyphIndices(layer) == NULL) {
+    const size_t tiles_count = tiles_wh.x * tiles_wh.y;
+    if (buffer->glyph_index_capacity < tiles_count) {
+      uint32_t *new_data =
+          realloc(buffer->glyph_index_data, tiles_count * sizeof(uint32_t));
+      if (new_data == NULL)
+        return -1;
+      buffer->glyph_index_data = new_data;
+      buffer->glyph_index_capacity = tiles_count;
+    }
+    const uint32_t *codepoints = CTUI_getLayerCodepoints(layer);
+    for (size_t tile_y = rect.xy.y; tile_y < rect.xy.y + rect.wh.y; tile_y++) {
+      for (size_t tile_x = rect.xy.x; tile_x < rect.xy.x + rect.wh.x;
+           tile_x++) {
+        const size_t tile_i = tile_y * tiles_wh.x + tile_x;
+        const CTUI_Glyph *glyph =
+            codepoints[tile_i] != 0
+                ? CTUI_tryGetGlyph((CTUI_Font *)font, codepoints[tile_i])
+                : NULL;
+        buffer->glyph_index_data[tile_i] =
+            glyph != NULL ? (uint32_t)(glyph - font->_glyphs)
+                          : CTUI_GLYPH_INDEX_NONE;
+      }
+    }
+  }
+  if (buffer->is_grid_upload_pending) {
+    // merge with tiles a skipped draw did not upload
+    CTUI_SRect *pending = &buffer->grid_upload_rect;
+    const size_t end_x = rect.xy.x + rect.wh.x > pending->xy.x + pending->wh.x
+                             ? rect.xy.x + rect.wh.x
+                             : pending->xy.x + pending->wh.x;
+    const size_t end_y = rect.xy.y + rect.wh.y > pending->xy.y + pending->wh.y
+                             ? rect.xy.y + rect.wh.y
+                             : pending->xy.y + pending->wh.y;
+    if (rect.xy.x > pending->xy.x)
+      rect.xy.x = pending->xy.x;
+    if (rect.xy.y > pending->xy.y)
+      rect.xy.y = pending->xy.y;
+    rect.wh = (CTUI_SVector2){end_x - rect.xy.x, end_y - rect.xy.y};
+  }
+  buffer->grid_upload_rect = rect;
+  buffer->is_grid_upload_pending = 1;
+  return 0;
+}
+
+static GLuint CTUI_gl33CreateGridTexture(GLint internal_format, GLenum format,
+                                         GLenum type, CTUI_SVector2 wh) {
+  GLuint texture;
+  glGenTextures(1, &texture);
+  glBindTexture(GL_TEXTURE_2D, texture);
+  glTexImage2D(GL_TEXTURE_2D, 0, internal_format, (GLsizei)wh.x, (GLsizei)wh.y,
+               0, format, type, NULL);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+  glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+  return texture;
+}
+
+static void CTUI_gl33DeleteGridTextures(CTUI_GL33Buffer *buffer) {
+  if (buffer->glyph_index_texture) {
+    glDeleteTextures(1, &buffer->glyph_index_texture);
+  }
+  if (buffer->fg_texture) {
+    glDeleteTextures(1, &buffer->fg_texture);
+  }
+  if (buffer->bg_texture) {
+    glDeleteTextures(1, &buffer->bg_texture);
+  }
+  buffer->glyph_index_texture = 0;
+  buffer->fg_texture = 0;
+  buffer->bg_texture = 0;
+  buffer->grid_tiles_wh = (CTUI_SVector2){0, 0};
+}
+
+// Uploads rect of a row major tile plane into the bound texture, the unpack
+// row length must be the plane width.
+static void CTUI_gl33UploadGridRect(GLenum format, GLenum type,
+                                    const void *plane, size_t texel_size,
+                                    size_t plane_w, CTUI_SRect rect) {
+  const uint8_t *src =
+      (const uint8_t *)plane + (rect.xy.y * plane_w + rect.xy.x) * texel_size;
+  glTexSubImage2D(GL_TEXTURE_2D, 0, (GLint)rect.xy.x, (GLint)rect.xy.y,
+                  (GLsizei)rect.wh.x, (GLsizei)rect.wh.y, format, type, src);
+}
+
+// Uploads the pending tiles straight from the layer planes, reallocating the
+// textures when the grid size changed.
+static void CTUI_gl33UploadGrid(CTUI_OpenGL33Renderer *gl,
+                                CTUI_Console *console, CTUI_GL33Buffer *buffer,
+                                CTUI_ConsoleLayer *layer) {
+  const CTUI_SVector2 tiles_wh = CTUI_getLayerTilesWh(layer);
+  if (buffer->glyph_index_texture == 0 ||
+      buffer->grid_tiles_wh.x != tiles_wh.x ||
+      buffer->grid_tiles_wh.y != tiles_wh.y) {
+    CTUI_gl33DeleteGridTextures(buffer);
+    buffer->glyph_index_texture = CTUI_gl33CreateGridTexture(
+        GL_R32UI, GL_RED_INTEGER, GL_UNSIGNED_INT, tiles_wh);
+    buffer->fg_texture = CTUI_gl33CreateGridTexture(GL_RGBA8, GL_RGBA,
+                                                    GL_UNSIGNED_BYTE, tiles_wh);
+    buffer->bg_texture = CTUI_gl33CreateGridTexture(GL_RGBA8, GL_RGBA,
+                                                    GL_UNSIGNED_BYTE, tiles_wh);
+    buffer->grid_tiles_wh = tiles_wh;
+    buffer->grid_upload_rect = (CTUI_SRect){{0, 0}, tiles_wh};
+    buffer->is_grid_upload_pending = 1;
+  }
+  if (!buffer->is_grid_upload_pending) {
+    return;
+  }
+  const uint64_t start_ns = CTUI_getMonotonicNs();
+  const CTUI_SRect rect = buffer->grid_upload_rect;
+  const uint32_t *glyph_indices = CTUI_getLayerGlyphIndices(layer);
+  if (glyph_indices == NULL) {
+    glyph_indices = buffer->glyph_index_data;
+  }
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, (GLint)tiles_wh.x);
+  glBindTexture(GL_TEXTURE_2D, buffer->glyph_index_texture);
+  CTUI_gl33UploadGridRect(GL_RED_INTEGER, GL_UNSIGNED_INT, glyph_indices,
+                          sizeof(uint32_t), tiles_wh.x, rect);
+  glBindTexture(GL_TEXTURE_2D, buffer->fg_texture);
+  CTUI_gl33UploadGridRect(GL_RGBA, GL_UNSIGNED_BYTE, CTUI_getLayerFgs(layer),
+                          sizeof(CTUI_Color), tiles_wh.x, rect);
+  glBindTexture(GL_TEXTURE_2D, buffer->bg_texture);
+  CTUI_gl33UploadGridRect(GL_RGBA, GL_UNSIGNED_BYTE, CTUI_getLayerBgs(layer),
+                          sizeof(CTUI_Color), tiles_wh.x, rect);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  buffer->is_grid_upload_pending = 0;
+  const uint64_t upload_ns = CTUI_getMonotonicNs() - start_ns;
+  gl->upload_ns += upload_ns;
+  CTUI_addFrameStageNs(console->_ctx, CTUI_FRAME_STAGE_UPLOAD, upload_ns);
+  console->_counters.bytes_uploaded +=
+      rect.wh.x * rect.wh.y * (sizeof(uint32_t) + 2 * sizeof(CTUI_Color));
+}
+
+static void CTUI_gl33DrawGrid(CTUI_OpenGL33Renderer *gl, CTUI_Console *console,
+                              size_t layer_count) {
+  CTUI_SVector2 console_tile_wh = CTUI_getConsoleTileWh(console);
+  glUseProgram(gl->grid_shader);
+  glUniformMatrix4fv(gl->grid_transform_uniform_loc, 1, GL_FALSE,
+                     gl->transform);
+  glBindVertexArray(gl->grid_vao);
+  for (size_t buffer_i = 0; buffer_i < layer_count; buffer_i++) {
+    CTUI_GL33Buffer *buffer = &gl->buffers[buffer_i];
+    if (!buffer->is_built)
+      continue;
+    CTUI_ConsoleLayer *layer = CTUI_getConsoleLayer(console, buffer_i);
+    if (layer == NULL)
+      continue;
+    CTUI_Font *font = (CTUI_Font *)CTUI_getFont(layer);
+    if (font == NULL)
+      continue;
+    CTUI_SVector2 tiles_wh = CTUI_getLayerTilesWh(layer);
+    if (tiles_wh.x == 0 || tiles_wh.y == 0)
+      continue;
+    CTUI_gl33UploadGrid(gl, console, buffer, layer);
+    CTUI_DVector2 tile_div_wh = CTUI_getLayerTileDivWh(layer);
+    GLuint texture = (GLuint)(uintptr_t)CTUI_gl33GetOrCreateFontTexture(
+        &gl->base, font);
+    GLuint glyph_texture = CTUI_gl33GetGlyphTable(gl, font);
+    glActiveTexture(GL_TEXTURE0);
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
+    glActiveTexture(GL_TEXTURE1);
+    glBindTexture(GL_TEXTURE_BUFFER, glyph_texture);
+    glActiveTexture(GL_TEXTURE2);
+    glBindTexture(GL_TEXTURE_2D, buffer->glyph_index_texture);
+    glActiveTexture(GL_TEXTURE3);
+    glBindTexture(GL_TEXTURE_2D, buffer->fg_texture);
+    glActiveTexture(GL_TEXTURE4);
+    glBindTexture(GL_TEXTURE_2D, buffer->bg_texture);
+    glUniform2f(gl->grid_wh_uniform_loc,
+                (float)((double)console_tile_wh.x * tile_div_wh.x),
+                (float)((double)console_tile_wh.y * tile_div_wh.y));
+    glDrawArrays(GL_TRIANGLES, 0, 6);
+    console->_counters.draw_calls++;
+  }
+  glActiveTexture(GL_TEXTURE0);
+}
+
+static void CTUI_gl33EndDrawStage(CTUI_OpenGL33Renderer *gl,
+                                  CTUI_Console *console,
+                                  uint64_t draw_start_ns) {
+  const uint64_t draw_ns = CTUI_getMonotonicNs() - draw_start_ns;
+  CTUI_addFrameStageNs(console->_ctx, CTUI_FRAME_STAGE_DRAW,
+                       draw_ns > gl->upload_ns ? draw_ns - gl->upload_ns : 0);
+}
+
 static void CTUI_gl33Render(CTUI_Renderer *renderer, CTUI_Console *console) {
   CTUI_OpenGL33Renderer *gl = (CTUI_OpenGL33Renderer *)renderer;
   CTUI_SVector2 console_tile_wh = CTUI_getConsoleTileWh(console);
@@ -201,15 +778,45 @@ static void CTUI_gl33Render(CTUI_Renderer *renderer, CTUI_Console *console) {
   }
   size_t layer_count = CTUI_getConsoleLayerCount(console);
   CTUI_gl33EnsureBuffers(gl, layer_count);
+  const uint64_t build_start_ns = CTUI_getMonotonicNs();
   for (size_t buffer_i = 0; buffer_i < layer_count; buffer_i++) {
     CTUI_GL33Buffer *buffer = &gl->buffers[buffer_i];
-    buffer->vertex_count = 0;
     CTUI_ConsoleLayer *layer = CTUI_getConsoleLayer(console, buffer_i);
+    if (layer != NULL &&
+        CTUI_gl33IsBufferCurrent(gl, buffer, layer, console_tile_wh)) {
+      // Unchanged since the last build, so the vbo is drawn as is.
+      console->_counters.glyph_misses += buffer->built_glyph_misses;
+      continue;
+    }
+    const int is_grid_retained =
+        layer != NULL &&
+        CTUI_gl33IsGridRetained(gl, buffer, layer, console_tile_wh);
+    buffer->is_built = 0;
+    buffer->is_uploaded = 0;
+    buffer->vertex_count = 0;
+    buffer->instance_count = 0;
     if (layer == NULL)
       continue;
-    const CTUI_Font *font = CTUI_getLayerFont(layer);
+    const CTUI_Font *font = CTUI_getFont(layer);
     if (font == NULL)
       continue;
+    const uint64_t glyph_misses = console->_counters.glyph_misses;
+    if (gl->mode == CTUI_GL33_MODE_INSTANCED) {
+      if (CTUI_gl33BuildInstances(buffer, layer, font) == 0) {
+        CTUI_gl33MarkBufferBuilt(
+            gl, buffer, layer, console_tile_wh,
+            console->_counters.glyph_misses - glyph_misses);
+      }
+      continue;
+    }
+    if (gl->mode == CTUI_GL33_MODE_GRID) {
+      // Missing glyphs are drawn as empty tiles but not counted, only the
+      // damaged tiles are looked up.
+      if (CTUI_gl33BuildGrid(buffer, layer, font, is_grid_retained) == 0) {
+        CTUI_gl33MarkBufferBuilt(gl, buffer, layer, console_tile_wh, 0);
+      }
+      continue;
+    }
     CTUI_DVector2 tile_div_wh = CTUI_getLayerTileDivWh(layer);
     if (tile_div_wh.x == 0 || tile_div_wh.y == 0)
       continue;
@@ -217,7 +824,12 @@ static void CTUI_gl33Render(CTUI_Renderer *renderer, CTUI_Console *console) {
         2.0f / (float)((double)console_tile_wh.x * tile_div_wh.x);
     float tile_screen_h =
         2.0f / (float)((double)console_tile_wh.y * tile_div_wh.y);
-    size_t tiles_count = CTUI_getLayerTilesCount(layer);
+    CTUI_SVector2 tiles_wh = CTUI_getLayerTilesWh(layer);
+    size_t tiles_count = tiles_wh.x * tiles_wh.y;
+    const uint32_t *codepoints = CTUI_getLayerCodepoints(layer);
+    const uint32_t *glyph_indices = CTUI_getLayerGlyphIndices(layer);
+    const CTUI_Color *fgs = CTUI_getLayerFgs(layer);
+    const CTUI_Color *bgs = CTUI_getLayerBgs(layer);
     if (buffer->vertex_capacity < tiles_count * 6) {
       CTUI_GL33Vertex *new_data = realloc(
           buffer->vertex_data, tiles_count * 6 * sizeof(CTUI_GL33Vertex));
@@ -226,117 +838,90 @@ static void CTUI_gl33Render(CTUI_Renderer *renderer, CTUI_Console *console) {
       buffer->vertex_data = new_data;
       buffer->vertex_capacity = tiles_count * 6;
     }
-    for (size_t tile_i = 0; tile_i < tiles_count; tile_i++) {
-      CTUI_ConsoleTile *tile = &layer->_tiles[tile_i];
-
-      float left_x = ((float)tile->_pos_xy.x * tile_screen_w) - 1.0f;
-      float right_x = left_x + tile_screen_w;
-      float top_y = 1.0f - ((float)tile->_pos_xy.y * tile_screen_h);
-      float bottom_y = top_y - tile_screen_h;
-      CTUI_Glyph *glyph = CTUI_tryGetGlyph((CTUI_Font *)font, tile->_codepoint);
-      if (glyph == NULL) {
-        // TODO error glyph
-        continue;
+    for (size_t tile_y = 0; tile_y < tiles_wh.y; tile_y++) {
+      for (size_t tile_x = 0; tile_x < tiles_wh.x; tile_x++) {
+        size_t tile_i = tile_y * tiles_wh.x + tile_x;
+        if (codepoints[tile_i] == 0)
+          continue;
+        float left_x = ((float)tile_x * tile_screen_w) - 1.0f;
+        float right_x = left_x + tile_screen_w;
+        float top_y = 1.0f - ((float)tile_y * tile_screen_h);
+        float bottom_y = top_y - tile_screen_h;
+        const CTUI_Glyph *glyph;
+        if (glyph_indices != NULL) {
+          glyph = glyph_indices[tile_i] != CTUI_GLYPH_INDEX_NONE
+                      ? &font->_glyphs[glyph_indices[tile_i]]
+                      : NULL;
+        } else {
+          glyph = CTUI_tryGetGlyph((CTUI_Font *)font, codepoints[tile_i]);
+        }
+        if (glyph == NULL) {
+          // TODO error glyph
+          console->_counters.glyph_misses++;
+          continue;
+        }
+        CTUI_Stpqp tex_coords = CTUI_getGlyphTexCoords(glyph);
+        const CTUI_Color fg = fgs[tile_i];
+        const CTUI_Color bg = bgs[tile_i];
+        CTUI_GL33Vertex *v0 = &buffer->vertex_data[buffer->vertex_count++];
+        v0->x = left_x;
+        v0->y = top_y;
+        v0->u = tex_coords.s;
+        v0->v = tex_coords.p;
+        v0->page = tex_coords.page;
+        v0->fg = fg;
+        v0->bg = bg;
+        CTUI_GL33Vertex *v1 = &buffer->vertex_data[buffer->vertex_count++];
+        v1->x = right_x;
+        v1->y = top_y;
+        v1->u = tex_coords.t;
+        v1->v = tex_coords.p;
+        v1->page = tex_coords.page;
+        v1->fg = fg;
+        v1->bg = bg;
+        CTUI_GL33Vertex *v2 = &buffer->vertex_data[buffer->vertex_count++];
+        v2->x = left_x;
+        v2->y = bottom_y;
+        v2->u = tex_coords.s;
+        v2->v = tex_coords.q;
+        v2->page = tex_coords.page;
+        v2->fg = fg;
+        v2->bg = bg;
+        CTUI_GL33Vertex *v3 = &buffer->vertex_data[buffer->vertex_count++];
+        v3->x = right_x;
+        v3->y = top_y;
+        v3->u = tex_coords.t;
+        v3->v = tex_coords.p;
+        v3->page = tex_coords.page;
+        v3->fg = fg;
+        v3->bg = bg;
+        CTUI_GL33Vertex *v4 = &buffer->vertex_data[buffer->vertex_count++];
+        v4->x = right_x;
+        v4->y = bottom_y;
+        v4->u = tex_coords.t;
+        v4->v = tex_coords.q;
+        v4->page = tex_coords.page;
+        v4->fg = fg;
+        v4->bg = bg;
+        CTUI_GL33Vertex *v5 = &buffer->vertex_data[buffer->vertex_count++];
+        v5->x = left_x;
+        v5->y = bottom_y;
+        v5->u = tex_coords.s;
+        v5->v = tex_coords.q;
+        v5->page = tex_coords.page;
+        v5->fg = fg;
+        v5->bg = bg;
       }
-      CTUI_Stpqp tex_coords = CTUI_getGlyphTexCoords(glyph);
-      CTUI_ColorRgba32 fg_rgba = CTUI_convertToRgba32(tile->_fg);
-      CTUI_ColorRgba32 bg_rgba = CTUI_convertToRgba32(tile->_bg);
-      float fg_r = (float)fg_rgba.r / 255.0f;
-      float fg_g = (float)fg_rgba.g / 255.0f;
-      float fg_b = (float)fg_rgba.b / 255.0f;
-      float fg_a = (float)fg_rgba.a / 255.0f;
-      float bg_r = (float)bg_rgba.r / 255.0f;
-      float bg_g = (float)bg_rgba.g / 255.0f;
-      float bg_b = (float)bg_rgba.b / 255.0f;
-      float bg_a = (float)bg_rgba.a / 255.0f;
-      CTUI_GL33Vertex *v0 = &buffer->vertex_data[buffer->vertex_count++];
-      v0->x = left_x;
-      v0->y = top_y;
-      v0->u = tex_coords.s;
-      v0->v = tex_coords.p;
-      v0->page = tex_coords.page;
-      v0->fg[0] = fg_r;
-      v0->fg[1] = fg_g;
-      v0->fg[2] = fg_b;
-      v0->fg[3] = fg_a;
-      v0->bg[0] = bg_r;
-      v0->bg[1] = bg_g;
-      v0->bg[2] = bg_b;
-      v0->bg[3] = bg_a;
-      CTUI_GL33Vertex *v1 = &buffer->vertex_data[buffer->vertex_count++];
-      v1->x = right_x;
-      v1->y = top_y;
-      v1->u = tex_coords.t;
-      v1->v = tex_coords.p;
-      v1->page = tex_coords.page;
-      v1->fg[0] = fg_r;
-      v1->fg[1] = fg_g;
-      v1->fg[2] = fg_b;
-      v1->fg[3] = fg_a;
-      v1->bg[0] = bg_r;
-      v1->bg[1] = bg_g;
-      v1->bg[2] = bg_b;
-      v1->bg[3] = bg_a;
-      CTUI_GL33Vertex *v2 = &buffer->vertex_data[buffer->vertex_count++];
-      v2->x = left_x;
-      v2->y = bottom_y;
-      v2->u = tex_coords.s;
-      v2->v = tex_coords.q;
-      v2->page = tex_coords.page;
-      v2->fg[0] = fg_r;
-      v2->fg[1] = fg_g;
-      v2->fg[2] = fg_b;
-      v2->fg[3] = fg_a;
-      v2->bg[0] = bg_r;
-      v2->bg[1] = bg_g;
-      v2->bg[2] = bg_b;
-      v2->bg[3] = bg_a;
-      CTUI_GL33Vertex *v3 = &buffer->vertex_data[buffer->vertex_count++];
-      v3->x = right_x;
-      v3->y = top_y;
-      v3->u = tex_coords.t;
-      v3->v = tex_coords.p;
-      v3->page = tex_coords.page;
-      v3->fg[0] = fg_r;
-      v3->fg[1] = fg_g;
-      v3->fg[2] = fg_b;
-      v3->fg[3] = fg_a;
-      v3->bg[0] = bg_r;
-      v3->bg[1] = bg_g;
-      v3->bg[2] = bg_b;
-      v3->bg[3] = bg_a;
-      CTUI_GL33Vertex *v4 = &buffer->vertex_data[buffer->vertex_count++];
-      v4->x = right_x;
-      v4->y = bottom_y;
-      v4->u = tex_coords.t;
-      v4->v = tex_coords.q;
-      v4->page = tex_coords.page;
-      v4->fg[0] = fg_r;
-      v4->fg[1] = fg_g;
-      v4->fg[2] = fg_b;
-      v4->fg[3] = fg_a;
-      v4->bg[0] = bg_r;
-      v4->bg[1] = bg_g;
-      v4->bg[2] = bg_b;
-      v4->bg[3] = bg_a;
-      CTUI_GL33Vertex *v5 = &buffer->vertex_data[buffer->vertex_count++];
-      v5->x = left_x;
-      v5->y = bottom_y;
-      v5->u = tex_coords.s;
-      v5->v = tex_coords.q;
-      v5->page = tex_coords.page;
-      v5->fg[0] = fg_r;
-      v5->fg[1] = fg_g;
-      v5->fg[2] = fg_b;
-      v5->fg[3] = fg_a;
-      v5->bg[0] = bg_r;
-      v5->bg[1] = bg_g;
-      v5->bg[2] = bg_b;
-      v5->bg[3] = bg_a;
     }
+    CTUI_gl33MarkBufferBuilt(gl, buffer, layer, console_tile_wh,
+                             console->_counters.glyph_misses - glyph_misses);
   }
+  const uint64_t draw_start_ns = CTUI_getMonotonicNs();
+  CTUI_addFrameStageNs(console->_ctx, CTUI_FRAME_STAGE_BUILD,
+                       draw_start_ns - build_start_ns);
+  gl->upload_ns = 0;
   if (console->_fill_bg_set) {
-    CTUI_ColorRgba32 fill_rgba = CTUI_convertToRgba32(console->_fill_bg_color);
+    CTUI_Color fill_rgba = console->_fill_bg_color;
     float r = (float)fill_rgba.r / 255.0f;
     float g = (float)fill_rgba.g / 255.0f;
     float b = (float)fill_rgba.b / 255.0f;
@@ -350,6 +935,16 @@ static void CTUI_gl33Render(CTUI_Renderer *renderer, CTUI_Console *console) {
   glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
   glUseProgram(gl->shader);
   glUniformMatrix4fv(gl->transform_uniform_loc, 1, GL_FALSE, gl->transform);
+  if (gl->mode == CTUI_GL33_MODE_INSTANCED) {
+    CTUI_gl33DrawInstances(gl, console, layer_count);
+    CTUI_gl33EndDrawStage(gl, console, draw_start_ns);
+    return;
+  }
+  if (gl->mode == CTUI_GL33_MODE_GRID) {
+    CTUI_gl33DrawGrid(gl, console, layer_count);
+    CTUI_gl33EndDrawStage(gl, console, draw_start_ns);
+    return;
+  }
   glBindVertexArray(gl->vao);
   for (size_t buffer_i = 0; buffer_i < layer_count; buffer_i++) {
     CTUI_GL33Buffer *buffer = &gl->buffers[buffer_i];
@@ -358,7 +953,7 @@ static void CTUI_gl33Render(CTUI_Renderer *renderer, CTUI_Console *console) {
     CTUI_ConsoleLayer *layer = CTUI_getConsoleLayer(console, buffer_i);
     if (layer == NULL)
       continue;
-    const CTUI_Font *font = CTUI_getLayerFont(layer);
+    const CTUI_Font *font = CTUI_getFont(layer);
     if (font == NULL)
       continue;
     GLuint texture = (GLuint)(uintptr_t)CTUI_gl33GetOrCreateFontTexture(
@@ -366,9 +961,11 @@ static void CTUI_gl33Render(CTUI_Renderer *renderer, CTUI_Console *console) {
     glActiveTexture(GL_TEXTURE0);
     glBindTexture(GL_TEXTURE_2D_ARRAY, texture);
     glBindBuffer(GL_ARRAY_BUFFER, buffer->vbo);
-    glBufferData(GL_ARRAY_BUFFER,
-                 sizeof(CTUI_GL33Vertex) * buffer->vertex_count,
-                 buffer->vertex_data, GL_STREAM_DRAW);
+    if (!buffer->is_uploaded) {
+      CTUI_gl33Upload(gl, console, buffer->vertex_data,
+                      sizeof(CTUI_GL33Vertex) * buffer->vertex_count);
+      buffer->is_uploaded = 1;
+    }
     glEnableVertexAttribArray(0);
     glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, sizeof(CTUI_GL33Vertex),
                           (void *)offsetof(CTUI_GL33Vertex, x));
@@ -376,13 +973,17 @@ static void CTUI_gl33Render(CTUI_Renderer *renderer, CTUI_Console *console) {
     glVertexAttribPointer(1, 3, GL_FLOAT, GL_FALSE, sizeof(CTUI_GL33Vertex),
                           (void *)offsetof(CTUI_GL33Vertex, u));
     glEnableVertexAttribArray(2);
-    glVertexAttribPointer(2, 4, GL_FLOAT, GL_FALSE, sizeof(CTUI_GL33Vertex),
+    glVertexAttribPointer(2, 4, GL_UNSIGNED_BYTE, GL_TRUE,
+                          sizeof(CTUI_GL33Vertex),
                           (void *)offsetof(CTUI_GL33Vertex, fg));
     glEnableVertexAttribArray(3);
-    glVertexAttribPointer(3, 4, GL_FLOAT, GL_FALSE, sizeof(CTUI_GL33Vertex),
+    glVertexAttribPointer(3, 4, GL_UNSIGNED_BYTE, GL_TRUE,
+                          sizeof(CTUI_GL33Vertex),
                           (void *)offsetof(CTUI_GL33Vertex, bg));
     glDrawArrays(GL_TRIANGLES, 0, buffer->vertex_count);
+    console->_counters.draw_calls++;
   }
+  CTUI_gl33EndDrawStage(gl, console, draw_start_ns);
 }
 
 static const CTUI_RendererVtable CTUI_GL33_VTABLE = {
@@ -416,6 +1017,7 @@ void CTUI_destroyOpenGL33Renderer(CTUI_Renderer *renderer) {
     if (gl->font_textures[i].texture) {
       glDeleteTextures(1, &gl->font_textures[i].texture);
     }
+    CTUI_gl33DeleteGlyphTable(&gl->font_textures[i]);
   }
   if (gl->font_textures) {
     free(gl->font_textures);
@@ -425,17 +1027,46 @@ void CTUI_destroyOpenGL33Renderer(CTUI_Renderer *renderer) {
       if (gl->buffers[i].vertex_data) {
         free(gl->buffers[i].vertex_data);
       }
+      if (gl->buffers[i].instance_data) {
+        free(gl->buffers[i].instance_data);
+      }
       if (gl->buffers[i].vbo) {
         glDeleteBuffers(1, &gl->buffers[i].vbo);
       }
+      if (gl->buffers[i].glyph_index_data) {
+        free(gl->buffers[i].glyph_index_data);
+      }
+      CTUI_gl33DeleteGridTextures(&gl->buffers[i]);
     }
     free(gl->buffers);
   }
   if (gl->vao) {
     glDeleteVertexArrays(1, &gl->vao);
   }
+  if (gl->instanced_vao) {
+    glDeleteVertexArrays(1, &gl->instanced_vao);
+  }
+  if (gl->grid_vao) {
+    glDeleteVertexArrays(1, &gl->grid_vao);
+  }
   if (gl->shader) {
     glDeleteProgram(gl->shader);
   }
+  if (gl->instanced_shader) {
+    glDeleteProgram(gl->instanced_shader);
+  }
+  if (gl->grid_shader) {
+    glDeleteProgram(gl->grid_shader);
+  }
   free(renderer);
 }
+
+void CTUI_setOpenGL33RendererMode(CTUI_Renderer *renderer, CTUI_GL33Mode mode) {
+  CTUI_OpenGL33Renderer *gl = (CTUI_OpenGL33Renderer *)renderer;
+  gl->mode = mode;
+}
+
+CTUI_GL33Mode CTUI_getOpenGL33RendererMode(const CTUI_Renderer *renderer) {
+  const CTUI_OpenGL33Renderer *gl = (const CTUI_OpenGL33Renderer *)renderer;
+  return gl->mode;
+}
@@ -0,0 +1,148 @@
+// Color Quantization for CTUI
+// Maps RGBA8 colors to the 256 and 16 color terminal palettes through a
+// 32x32x32 lookup table, so quantizing a color is a shift, a mask and a load.
+// The table is built once per palette and metric with a full nearest color
+// search.
+
+#include <ctui/ctui.h>
+#include <float.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                   \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CTUI_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+// xterm defaults, terminals may theme these differently
+static const uint8_t CTUI_ANSI16_PALETTE[16][3] = {
+    {0, 0, 0},       {205, 0, 0},     {0, 205, 0},     {205, 205, 0},
+    {0, 0, 238},     {205, 0, 205},   {0, 205, 205},   {229, 229, 229},
+    {127, 127, 127}, {255, 0, 0},     {0, 255, 0},     {255, 255, 0},
+    {92, 92, 255},   {255, 0, 255},   {0, 255, 255},   {255, 255, 255},
+};
+
+static const uint8_t CTUI_CUBE_LEVELS[6] = {0, 95, 135, 175, 215, 255};
+
+void CTUI_getPaletteColor(size_t index, uint8_t *out_rgb) {
+  if (index < 16) {
+    out_rgb[0] = CTUI_ANSI16_PALETTE[index][0];
+    out_rgb[1] = CTUI_ANSI16_PALETTE[index][1];
+    out_rgb[2] = CTUI_ANSI16_PALETTE[index][2];
+  } else if (index < 232) {
+    const size_t cube_i = index - 16;
+    out_rgb[0] = CTUI_CUBE_LEVELS[cube_i / 36];
+    out_rgb[1] = CTUI_CUBE_LEVELS[(cube_i / 6) % 6];
+    out_rgb[2] = CTUI_CUBE_LEVELS[cube_i % 6];
+  } else {
+    const uint8_t gray = (uint8_t)(8 + 10 * (index - 232));
+    out_rgb[0] = gray;
+    out_rgb[1] = gray;
+    out_rgb[2] = gray;
+  }
+}
+
+static float CTUI_linearizeSrgb(float c) {
+  return c <= 0.04045f ? c / 12.92f : powf((c + 0.055f) / 1.055f, 2.4f);
+}
+
+// Coordinates in which euclidean distance is the color difference: OKLab for
+// the perceptual metric, plain RGB otherwise.
+static void CTUI_getMetricCoords(const uint8_t *rgb, CTUI_ColorMetric metric,
+                                 float *out_coords) {
+  if (metric != CTUI_COLOR_METRIC_PERCEPTUAL) {
+    out_coords[0] = rgb[0];
+    out_coords[1] = rgb[1];
+    out_coords[2] = rgb[2];
+    return;
+  }
+  const float r = CTUI_linearizeSrgb(rgb[0] / 255.0f);
+  const float g = CTUI_linearizeSrgb(rgb[1] / 255.0f);
+  const float b = CTUI_linearizeSrgb(rgb[2] / 255.0f);
+  const float l = cbrtf(0.4122214708f * r + 0.5363325363f * g +
+                        0.0514459929f * b);
+  const float m = cbrtf(0.2119034982f * r + 0.6806995451f * g +
+                        0.1073969566f * b);
+  const float s = cbrtf(0.0883024619f * r + 0.2817188376f * g +
+                        0.6299787005f * b);
+  out_coords[0] = 0.2104542553f * l + 0.7936177850f * m - 0.0040720468f * s;
+  out_coords[1] = 1.9779984951f * l - 2.4285922050f * m + 0.4505937099f * s;
+  out_coords[2] = 0.0259040371f * l + 0.7827717662f * m - 0.8086757660f * s;
+}
+
+void CTUI_buildColorLut(uint8_t *lut, CTUI_ColorPalette palette,
+                        CTUI_ColorMetric metric) {
+  // The 16 system colors are themed by most 256 color terminals, so only the
+  // fixed cube and gray ramp are matched.
+  const size_t first_i = palette == CTUI_COLOR_PALETTE_256 ? 16 : 0;
+  const size_t end_i = palette == CTUI_COLOR_PALETTE_256 ? 256 : 16;
+  float palette_coords[256][3];
+  for (size_t i = first_i; i < end_i; i++) {
+    uint8_t rgb[3];
+    CTUI_getPaletteColor(i, rgb);
+    CTUI_getMetricCoords(rgb, metric, palette_coords[i]);
+  }
+  for (size_t lut_i = 0; lut_i < CTUI_COLOR_LUT_SIZE; lut_i++) {
+    // 5 bit channels widened so that 0 and 31 hit black and white exactly
+    const size_t r5 = (lut_i >> 10) & 0x1F;
+    const size_t g5 = (lut_i >> 5) & 0x1F;
+    const size_t b5 = lut_i & 0x1F;
+    const uint8_t rgb[3] = {
+        (uint8_t)(r5 << 3 | r5 >> 2),
+        (uint8_t)(g5 << 3 | g5 >> 2),
+        (uint8_t)(b5 << 3 | b5 >> 2),
+    };
+    float coords[3];
+    CTUI_getMetricCoords(rgb, metric, coords);
+    float best_distance = FLT_MAX;
+    size_t best_i = first_i;
+    for (size_t i = first_i; i < end_i; i++) {
+      const float d0 = coords[0] - palette_coords[i][0];
+      const float d1 = coords[1] - palette_coords[i][1];
+      const float d2 = coords[2] - palette_coords[i][2];
+      const float distance = d0 * d0 + d1 * d1 + d2 * d2;
+      if (distance < best_distance) {
+        best_distance = distance;
+        best_i = i;
+      }
+    }
+    lut[lut_i] = (uint8_t)best_i;
+  }
+}
+
+void CTUI_quantizeColors(const uint8_t *lut, const CTUI_Color *colors,
+                         uint8_t *out_indices, size_t count) {
+  size_t i = 0;
+#ifdef CTUI_SIMD_SSE2
+  // r, g and b are bytes 0, 1 and 2 of each 32 bit lane, the key is
+  // r >> 3 << 10 | g >> 3 << 5 | b >> 3.
+  const __m128i r_mask = _mm_set1_epi32(0xF8);
+  const __m128i g_mask = _mm_set1_epi32(0xF800);
+  const __m128i b_mask = _mm_set1_epi32(0xF80000);
+  for (; i + 8 <= count; i += 8) {
+    __m128i keys[2];
+    for (size_t half = 0; half < 2; half++) {
+      const __m128i px =
+          _mm_loadu_si128((const __m128i *)(colors + i + half * 4));
+      keys[half] = _mm_or_si128(
+          _mm_or_si128(_mm_slli_epi32(_mm_and_si128(px, r_mask), 7),
+                       _mm_srli_epi32(_mm_and_si128(px, g_mask), 6)),
+          _mm_srli_epi32(_mm_and_si128(px, b_mask), 19));
+    }
+    // Keys fit 16 bits, so both halves pack into one register.
+    uint16_t key_lanes[8];
+    _mm_storeu_si128((__m128i *)key_lanes, _mm_packs_epi32(keys[0], keys[1]));
+    for (size_t lane = 0; lane < 8; lane++) {
+      out_indices[i + lane] = lut[key_lanes[lane]];
+    }
+  }
+#endif
+  for (; i < count; i++) {
+    const CTUI_Color color = colors[i];
+    out_indices[i] =
+        lut[(size_t)(color.r >> 3) << 10 | (size_t)(color.g >> 3) << 5 |
+            (size_t)(color.b >> 3)];
+  }
+}
@@ -0,0 +1,518 @@
+// Software Renderer for CTUI
+// Rasterizes consoles into an RGBA8 framebuffer on the CPU with the same
+// mix(bg, fg, texel.a) rule and blending as the OpenGL 3.3 renderer. The
+// framebuffer is split into row bands that are drawn by a thread pool, or on
+// the calling thread on Windows.
+
+#include <ctui/ctui.h>
+#include <math.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+#if defined(__SSE2__) || defined(_M_X64) ||                                   \
+    (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CTUI_SIMD_SSE2
+#include <emmintrin.h>
+#endif
+
+// widest cell in pixels that is sampled per column, wider cells are clipped
+#define CTUI_SW_MAX_CELL_PIXEL_W 512
+
+typedef struct CTUI_SoftwareRenderer CTUI_SoftwareRenderer;
+
+typedef struct CTUI_SoftwareWorker {
+  CTUI_SoftwareRenderer *sw;
+#ifndef _WIN32
+  pthread_t thread;
+#endif
+  size_t band_i;
+  uint64_t glyph_misses;
+} CTUI_SoftwareWorker;
+
+typedef struct CTUI_SoftwareRenderer {
+  CTUI_Renderer base;
+  float transform[16];
+  int width;
+  int height;
+  uint8_t *pixels;
+  // thread pool, band 0 is drawn by the calling thread
+  size_t band_count;
+  CTUI_SoftwareWorker *workers;
+#ifndef _WIN32
+  pthread_mutex_t mutex;
+  pthread_cond_t start_cond;
+  pthread_cond_t done_cond;
+#endif
+  uint64_t job_generation;
+  size_t jobs_pending;
+  int is_stopping;
+  int is_pool_started;
+  CTUI_Console *job_console;
+} CTUI_SoftwareRenderer;
+
+static inline uint32_t CTUI_swDiv255(uint32_t x) {
+  return (x + 128 + ((x + 128) >> 8)) >> 8;
+}
+
+// Blends count pixels of mix(bg, fg, alpha) over dst.
+static void CTUI_swBlendSpan(uint8_t *dst, const uint8_t *alphas, size_t count,
+                             CTUI_Color fg, CTUI_Color bg) {
+  const int is_opaque = fg.a == 255 && bg.a == 255;
+  size_t i = 0;
+#if defined(CTUI_SIMD_SSE2)
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i v255 = _mm_set1_epi16(255);
+  const __m128i v128 = _mm_set1_epi16(128);
+  const __m128i fg16 = _mm_setr_epi16(fg.r, fg.g, fg.b, fg.a, fg.r, fg.g,
+                                      fg.b, fg.a);
+  const __m128i bg16 = _mm_setr_epi16(bg.r, bg.g, bg.b, bg.a, bg.r, bg.g,
+                                      bg.b, bg.a);
+  for (; i + 4 <= count; i += 4) {
+    uint32_t alpha4;
+    memcpy(&alpha4, &alphas[i], sizeof(alpha4));
+    // [a0 a1 a2 a3] -> [a0 x4, a1 x4] and [a2 x4, a3 x4] as u16 lanes
+    const __m128i a8 = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)alpha4), zero);
+    const __m128i a16 = _mm_unpacklo_epi16(a8, a8);
+    const __m128i alpha_halves[2] = {_mm_unpacklo_epi32(a16, a16),
+                                     _mm_unpackhi_epi32(a16, a16)};
+    const __m128i dst8 = _mm_loadu_si128((const __m128i *)&dst[i * 4]);
+    const __m128i dst_halves[2] = {_mm_unpacklo_epi8(dst8, zero),
+                                   _mm_unpackhi_epi8(dst8, zero)};
+    __m128i out_halves[2];
+    for (int half = 0; half < 2; half++) {
+      const __m128i a = alpha_halves[half];
+      // c = (bg * (255 - a) + fg * a) / 255, rounded
+      __m128i c = _mm_add_epi16(_mm_mullo_epi16(bg16, _mm_sub_epi16(v255, a)),
+                                _mm_mullo_epi16(fg16, a));
+      c = _mm_add_epi16(c, v128);
+      c = _mm_srli_epi16(_mm_add_epi16(c, _mm_srli_epi16(c, 8)), 8);
+      if (is_opaque) {
+        out_halves[half] = c;
+        continue;
+      }
+      // out = (c * c.a + dst * (255 - c.a)) / 255, rounded
+      __m128i ca = _mm_shufflelo_epi16(c, _MM_SHUFFLE(3, 3, 3, 3));
+      ca = _mm_shufflehi_epi16(ca, _MM_SHUFFLE(3, 3, 3, 3));
+      __m128i o = _mm_add_epi16(
+          _mm_mullo_epi16(c, ca),
+          _mm_mullo_epi16(dst_halves[half], _mm_sub_epi16(v255, ca)));
+      o = _mm_add_epi16(o, v128);
+      out_halves[half] =
+          _mm_srli_epi16(_mm_add_epi16(o, _mm_srli_epi16(o, 8)), 8);
+    }
+    _mm_storeu_si128((__m128i *)&dst[i * 4],
+                     _mm_packus_epi16(out_halves[0], out_halves[1]));
+  }
+#endif
+  for (; i < count; i++) {
+    const uint32_t a = alphas[i];
+    const uint8_t c[4] = {
+        (uint8_t)CTUI_swDiv255(bg.r * (255 - a) + fg.r * a),
+        (uint8_t)CTUI_swDiv255(bg.g * (255 - a) + fg.g * a),
+        (uint8_t)CTUI_swDiv255(bg.b * (255 - a) + fg.b * a),
+        (uint8_t)CTUI_swDiv255(bg.a * (255 - a) + fg.a * a)};
+    uint8_t *d = &dst[i * 4];
+    if (is_opaque) {
+      memcpy(d, c, 4);
+      continue;
+    }
+    for (int channel = 0; channel < 4; channel++) {
+      d[channel] = (uint8_t)CTUI_swDiv255(c[channel] * c[3] +
+                                          d[channel] * (255u - c[3]));
+    }
+  }
+}
+
+// First pixel whose center is at or past edge.
+static inline int CTUI_swPixelEdge(double edge) {
+  return (int)ceil(edge - 0.5);
+}
+
+static void CTUI_swRenderLayerBand(CTUI_SoftwareRenderer *sw,
+                                   CTUI_SoftwareWorker *worker,
+                                   CTUI_Console *console,
+                                   CTUI_ConsoleLayer *layer, int band_y0,
+                                   int band_y1) {
+  const CTUI_Font *font = CTUI_getFont(layer);
+  if (font == NULL || font->_image._pixels == NULL) {
+    return;
+  }
+  const CTUI_SVector2 console_tile_wh = CTUI_getConsoleTileWh(console);
+  const CTUI_DVector2 tile_div_wh = CTUI_getLayerTileDivWh(layer);
+  const CTUI_SVector2 tiles_wh = CTUI_getLayerTilesWh(layer);
+  if (tiles_wh.x == 0 || tiles_wh.y == 0) {
+    return;
+  }
+  // Tile edges in NDC like the GL renderer, then through the 2D scale and
+  // translation of the transform into pixels (row 0 at the top).
+  const double tile_ndc_w = 2.0 / ((double)console_tile_wh.x * tile_div_wh.x);
+  const double tile_ndc_h = 2.0 / ((double)console_tile_wh.y * tile_div_wh.y);
+  const double half_w = (double)sw->width * 0.5;
+  const double half_h = (double)sw->height * 0.5;
+  const double scale_x = sw->transform[0] * tile_ndc_w * half_w;
+  const double offset_x =
+      (1.0 - sw->transform[0] + sw->transform[12]) * half_w;
+  const double scale_y = sw->transform[5] * tile_ndc_h * half_h;
+  const double offset_y = (1.0 - sw->transform[5] - sw->transform[13]) * half_h;
+  if (scale_x <= 0.0 || scale_y <= 0.0) {
+    return;
+  }
+  // Tile rows overlapping the band.
+  double first_row = floor(((double)band_y0 + 0.5 - offset_y) / scale_y);
+  double last_row = floor(((double)band_y1 - 0.5 - offset_y) / scale_y);
+  if (last_row < 0.0 || first_row >= (double)tiles_wh.y) {
+    return;
+  }
+  const size_t tile_y0 = first_row < 0.0 ? 0 : (size_t)first_row;
+  const size_t tile_y1 = last_row >= (double)tiles_wh.y - 1.0
+                             ? tiles_wh.y
+                             : (size_t)last_row + 1;
+
+  const size_t img_w = font->_image._width;
+  const size_t img_h = font->_image._height;
+  const size_t page_size = img_w * img_h * 4;
+  const uint32_t *codepoints = CTUI_getLayerCodepoints(layer);
+  const uint32_t *glyph_indices = CTUI_getLayerGlyphIndices(layer);
+  const CTUI_Color *fgs = CTUI_getLayerFgs(layer);
+  const CTUI_Color *bgs = CTUI_getLayerBgs(layer);
+  size_t texel_xs[CTUI_SW_MAX_CELL_PIXEL_W];
+  uint8_t alphas[CTUI_SW_MAX_CELL_PIXEL_W];
+
+  for (size_t tile_y = tile_y0; tile_y < tile_y1; tile_y++) {
+    const double top = scale_y * (double)tile_y + offset_y;
+    int py0 = CTUI_swPixelEdge(top);
+    int py1 = CTUI_swPixelEdge(top + scale_y);
+    if (py0 < band_y0)
+      py0 = band_y0;
+    if (py1 > band_y1)
+      py1 = band_y1;
+    if (py0 >= py1)
+      continue;
+    for (size_t tile_x = 0; tile_x < tiles_wh.x; tile_x++) {
+      const size_t tile_i = tile_y * tiles_wh.x + tile_x;
+      if (codepoints[tile_i] == 0)
+        continue;
+      const double left = scale_x * (double)tile_x + offset_x;
+      int px0 = CTUI_swPixelEdge(left);
+      int px1 = CTUI_swPixelEdge(left + scale_x);
+      if (px0 < 0)
+        px0 = 0;
+      if (px1 > sw->width)
+        px1 = sw->width;
+      if (px1 - px0 > CTUI_SW_MAX_CELL_PIXEL_W)
+        px1 = px0 + CTUI_SW_MAX_CELL_PIXEL_W;
+      if (px0 >= px1)
+        continue;
+      CTUI_Glyph *glyph;
+      if (glyph_indices != NULL) {
+        glyph = glyph_indices[tile_i] != CTUI_GLYPH_INDEX_NONE
+                    ? &font->_glyphs[glyph_indices[tile_i]]
+                    : NULL;
+      } else {
+        glyph = CTUI_tryGetGlyph((CTUI_Font *)font, codepoints[tile_i]);
+      }
+      if (glyph == NULL) {
+        // TODO error glyph
+        worker->glyph_misses++;
+        continue;
+      }
+      const CTUI_Stpqp tex = CTUI_getGlyphTexCoords(glyph);
+      size_t page = (size_t)tex.page;
+      if (page >= font->_image._pages)
+        page = 0;
+      const uint8_t *page_pixels = font->_image._pixels + page * page_size;
+      // Nearest texel for every pixel center, as GL_NEAREST samples it.
+      for (int px = px0; px < px1; px++) {
+        const double fx = ((double)px + 0.5 - left) / scale_x;
+        const double u = tex.s + fx * (tex.t - tex.s);
+        double texel_x = floor(u * (double)img_w);
+        if (texel_x < 0.0)
+          texel_x = 0.0;
+        if (texel_x > (double)img_w - 1.0)
+          texel_x = (double)img_w - 1.0;
+        texel_xs[px - px0] = (size_t)texel_x * 4 + 3;
+      }
+      const size_t span_w = (size_t)(px1 - px0);
+      for (int py = py0; py < py1; py++) {
+        const double fy = ((double)py + 0.5 - top) / scale_y;
+        const double v = tex.p + fy * (tex.q - tex.p);
+        double texel_y = floor(v * (double)img_h);
+        if (texel_y < 0.0)
+          texel_y = 0.0;
+        if (texel_y > (double)img_h - 1.0)
+          texel_y = (double)img_h - 1.0;
+        const uint8_t *texel_row = page_pixels + (size_t)texel_y * img_w * 4;
+        for (size_t k = 0; k < span_w; k++) {
+          alphas[k] = texel_row[texel_xs[k]];
+        }
+        uint8_t *dst = sw->pixels + ((size_t)py * (size_t)sw->width +
+                                     (size_t)px0) * 4;
+        CTUI_swBlendSpan(dst, alphas, span_w, fgs[tile_i], bgs[tile_i]);
+      }
+    }
+  }
+}
+
+static void CTUI_swRenderBand(CTUI_SoftwareRenderer *sw, CTUI_Console *console,
+                              size_t band_i) {
+  CTUI_SoftwareWorker *worker = &sw->workers[band_i];
+  const int band_h = (sw->height + (int)sw->band_count - 1) /
+                     (int)sw->band_count;
+  const int band_y0 = band_h * (int)band_i;
+  int band_y1 = band_y0 + band_h;
+  if (band_y1 > sw->height)
+    band_y1 = sw->height;
+  if (band_y0 >= band_y1)
+    return;
+  CTUI_Color clear = {0, 0, 0, 255};
+  if (console->_fill_bg_set) {
+    clear = console->_fill_bg_color;
+  }
+  uint8_t *row = sw->pixels + (size_t)band_y0 * (size_t)sw->width * 4;
+  const size_t band_pixels = (size_t)(band_y1 - band_y0) * (size_t)sw->width;
+  for (size_t i = 0; i < band_pixels; i++) {
+    memcpy(&row[i * 4], &clear, 4);
+  }
+  const size_t layer_count = CTUI_getConsoleLayerCount(console);
+  for (size_t layer_i = 0; layer_i < layer_count; layer_i++) {
+    CTUI_ConsoleLayer *layer = CTUI_getConsoleLayer(console, layer_i);
+    if (layer == NULL)
+      continue;
+    CTUI_swRenderLayerBand(sw, worker, console, layer, band_y0, band_y1);
+  }
+}
+
+#ifndef _WIN32
+static void *CTUI_swWorkerMain(void *user_data) {
+  CTUI_SoftwareWorker *worker = (CTUI_SoftwareWorker *)user_data;
+  CTUI_SoftwareRenderer *sw = worker->sw;
+  uint64_t seen_generation = 0;
+  pthread_mutex_lock(&sw->mutex);
+  for (;;) {
+    while (!sw->is_stopping && sw->job_generation == seen_generation) {
+      pthread_cond_wait(&sw->start_cond, &sw->mutex);
+    }
+    if (sw->is_stopping) {
+      break;
+    }
+    seen_generation = sw->job_generation;
+    CTUI_Console *console = sw->job_console;
+    pthread_mutex_unlock(&sw->mutex);
+    CTUI_swRenderBand(sw, console, worker->band_i);
+    pthread_mutex_lock(&sw->mutex);
+    sw->jobs_pending--;
+    if (sw->jobs_pending == 0) {
+      pthread_cond_signal(&sw->done_cond);
+    }
+  }
+  pthread_mutex_unlock(&sw->mutex);
+  return NULL;
+}
+
+static void CTUI_swStopPool(CTUI_SoftwareRenderer *sw) {
+  if (!sw->is_pool_started) {
+    return;
+  }
+  pthread_mutex_lock(&sw->mutex);
+  sw->is_stopping = 1;
+  pthread_cond_broadcast(&sw->start_cond);
+  pthread_mutex_unlock(&sw->mutex);
+  for (size_t i = 1; i < sw->band_count; i++) {
+    pthread_join(sw->workers[i].thread, NULL);
+  }
+  pthread_mutex_destroy(&sw->mutex);
+  pthread_cond_destroy(&sw->start_cond);
+  pthread_cond_destroy(&sw->done_cond);
+  sw->is_pool_started = 0;
+}
+#endif
+
+static int CTUI_swInit(CTUI_Renderer *renderer) {
+  CTUI_SoftwareRenderer *sw = (CTUI_SoftwareRenderer *)renderer;
+  if (sw->is_pool_started) {
+    return 0;
+  }
+  memset(sw->transform, 0, sizeof(sw->transform));
+  sw->transform[0] = 1.0f;
+  sw->transform[5] = 1.0f;
+  sw->transform[10] = 1.0f;
+  sw->transform[15] = 1.0f;
+#ifndef _WIN32
+  pthread_mutex_init(&sw->mutex, NULL);
+  pthread_cond_init(&sw->start_cond, NULL);
+  pthread_cond_init(&sw->done_cond, NULL);
+  sw->is_pool_started = 1;
+  for (size_t i = 0; i < sw->band_count; i++) {
+    sw->workers[i].sw = sw;
+    sw->workers[i].band_i = i;
+    if (i == 0) {
+      continue;
+    }
+    if (pthread_create(&sw->workers[i].thread, NULL, CTUI_swWorkerMain,
+                       &sw->workers[i]) != 0) {
+      // Run with the workers that did start.
+      sw->band_count = i;
+      break;
+    }
+  }
+#endif
+  return 0;
+}
+
+static void CTUI_swResize(CTUI_Renderer *renderer, int width, int height) {
+  CTUI_SoftwareRenderer *sw = (CTUI_SoftwareRenderer *)renderer;
+  if (width < 0)
+    width = 0;
+  if (height < 0)
+    height = 0;
+  if (sw->width == width && sw->height == height) {
+    return;
+  }
+  uint8_t *pixels = NULL;
+  if (width > 0 && height > 0) {
+    pixels = calloc((size_t)width * (size_t)height, 4);
+    if (pixels == NULL) {
+      return;
+    }
+  }
+  if (sw->pixels != NULL) {
+    free(sw->pixels);
+  }
+  sw->pixels = pixels;
+  sw->width = width;
+  sw->height = height;
+}
+
+#ifndef _WIN32
+// Draws band 0 here and the rest on the pool.
+static void CTUI_swRenderBands(CTUI_SoftwareRenderer *sw,
+                               CTUI_Console *console) {
+  pthread_mutex_lock(&sw->mutex);
+  sw->job_console = console;
+  sw->jobs_pending = sw->band_count - 1;
+  sw->job_generation++;
+  pthread_cond_broadcast(&sw->start_cond);
+  pthread_mutex_unlock(&sw->mutex);
+  CTUI_swRenderBand(sw, console, 0);
+  pthread_mutex_lock(&sw->mutex);
+  while (sw->jobs_pending > 0) {
+    pthread_cond_wait(&sw->done_cond, &sw->mutex);
+  }
+  pthread_mutex_unlock(&sw->mutex);
+}
+#endif
+
+static void CTUI_swRender(CTUI_Renderer *renderer, CTUI_Console *console) {
+  CTUI_SoftwareRenderer *sw = (CTUI_SoftwareRenderer *)renderer;
+  if (sw->pixels == NULL) {
+    return;
+  }
+  CTUI_SVector2 console_tile_wh = CTUI_getConsoleTileWh(console);
+  if (console_tile_wh.x == 0 || console_tile_wh.y == 0) {
+    return;
+  }
+  const uint64_t start_ns = CTUI_getMonotonicNs();
+  for (size_t band_i = 0; band_i < sw->band_count; band_i++) {
+    sw->workers[band_i].glyph_misses = 0;
+  }
+#ifndef _WIN32
+  if (sw->is_pool_started && sw->band_count > 1) {
+    CTUI_swRenderBands(sw, console);
+  } else
+#endif
+  {
+    for (size_t band_i = 0; band_i < sw->band_count; band_i++) {
+      CTUI_swRenderBand(sw, console, band_i);
+    }
+  }
+  for (size_t band_i = 0; band_i < sw->band_count; band_i++) {
+    console->_counters.glyph_misses += sw->workers[band_i].glyph_misses;
+  }
+  CTUI_addFrameStageNs(console->_ctx, CTUI_FRAME_STAGE_DRAW,
+                       CTUI_getMonotonicNs() - start_ns);
+}
+
+static void *CTUI_swGetOrCreateFontTexture(CTUI_Renderer *renderer,
+                                           CTUI_Font *font) {
+  (void)renderer;
+  // The atlas is sampled in place.
+  return font->_image._pixels;
+}
+
+static void CTUI_swFreeFontTexture(CTUI_Renderer *renderer,
+                                   void *texture_handle) {
+  (void)renderer;
+  (void)texture_handle;
+}
+
+static void CTUI_swSetTransform(CTUI_Renderer *renderer,
+                                const float *matrix4x4) {
+  CTUI_SoftwareRenderer *sw = (CTUI_SoftwareRenderer *)renderer;
+  memcpy(sw->transform, matrix4x4, sizeof(sw->transform));
+}
+
+static void CTUI_swMakeCurrent(CTUI_Renderer *renderer) { (void)renderer; }
+
+static const CTUI_RendererVtable CTUI_SOFTWARE_VTABLE = {
+    .init = CTUI_swInit,
+    .resize = CTUI_swResize,
+    .render = CTUI_swRender,
+    .getOrCreateFontTexture = CTUI_swGetOrCreateFontTexture,
+    .freeFontTexture = CTUI_swFreeFontTexture,
+    .setTransform = CTUI_swSetTransform,
+    .makeCurrent = CTUI_swMakeCurrent,
+};
+
+CTUI_Renderer *CTUI_createSoftwareRenderer(size_t thread_count) {
+#ifdef _WIN32
+  thread_count = 1;
+#else
+  if (thread_count == 0) {
+    long cpu_count = sysconf(_SC_NPROCESSORS_ONLN);
+    thread_count = cpu_count > 0 ? (size_t)cpu_count : 1;
+  }
+#endif
+  CTUI_SoftwareRenderer *sw = calloc(1, sizeof(CTUI_SoftwareRenderer));
+  if (sw == NULL) {
+    return NULL;
+  }
+  sw->workers = calloc(thread_count, sizeof(CTUI_SoftwareWorker));
+  if (sw->workers == NULL) {
+    free(sw);
+    return NULL;
+  }
+  sw->base.vtable = &CTUI_SOFTWARE_VTABLE;
+  sw->band_count = thread_count;
+  return &sw->base;
+}
+
+void CTUI_destroySoftwareRenderer(CTUI_Renderer *renderer) {
+  CTUI_SoftwareRenderer *sw = (CTUI_SoftwareRenderer *)renderer;
+#ifndef _WIN32
+  CTUI_swStopPool(sw);
+#endif
+  if (sw->pixels) {
+    free(sw->pixels);
+  }
+  if (sw->workers) {
+    free(sw->workers);
+  }
+  free(renderer);
+}
+
+const uint8_t *CTUI_getSoftwareRendererPixels(const CTUI_Renderer *renderer,
+                                              CTUI_IVector2 *out_pixel_wh) {
+  const CTUI_SoftwareRenderer *sw = (const CTUI_SoftwareRenderer *)renderer;
+  if (out_pixel_wh != NULL) {
+    out_pixel_wh->x = sw->width;
+    out_pixel_wh->y = sw->height;
+  }
+  return sw->pixels;
+}
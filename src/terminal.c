@@ -0,0 +1,1556 @@
+// Terminal Backend for CTUI
+// Draws the console on an ANSI/VT terminal. Layers are composed into a back
+// cell buffer, which is diffed against a front buffer holding what the
+// terminal shows; only the changed cells are written, with the cursor and SGR
+// state tracked so no move or color change is sent twice.
+
+#include <ctui/ctui.h>
+#include <fnv/fnv.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifndef _WIN32
+#include <errno.h>
+#include <signal.h>
+#include <sys/ioctl.h>
+#include <termios.h>
+#include <unistd.h>
+
+// codepoint of front cells whose terminal contents are unknown
+#define CTUI_TERMINAL_UNKNOWN_CODEPOINT UINT32_MAX
+// skipping this many unchanged cells by rewriting them is cheaper than CUF
+#define CTUI_TERMINAL_MAX_REWRITE_GAP 4
+#define CTUI_TERMINAL_MAX_INPUT_PARAMS 16
+// fewest rows a scroll has to save before it replaces redrawing them
+#define CTUI_TERMINAL_MIN_SCROLL_ROWS 3
+// a lone ESC with nothing after it for this long was the Escape key
+#define CTUI_TERMINAL_ESCAPE_TIMEOUT_NS 25000000ULL
+
+// input parser state kept between reads
+typedef struct CTUI_TerminalInput {
+  uint8_t state;
+  // first parameter byte when it is one of < = > ?, else 0
+  uint8_t private_marker;
+  uint8_t intermediate;
+  size_t param_count;
+  uint32_t params[CTUI_TERMINAL_MAX_INPUT_PARAMS];
+} CTUI_TerminalInput;
+
+typedef struct CTUI_TerminalCell {
+  uint32_t codepoint;
+  CTUI_Color fg;
+  CTUI_Color bg;
+} CTUI_TerminalCell;
+
+typedef struct CTUI_TerminalConsole {
+  CTUI_Console base;
+  int in_fd;
+  int out_fd;
+  struct termios saved_termios;
+  int is_termios_saved;
+  struct sigaction saved_sigwinch;
+  // what the terminal shows, and the frame being built, cells_wh row major
+  CTUI_SVector2 cells_wh;
+  CTUI_TerminalCell *front_cells;
+  CTUI_TerminalCell *back_cells;
+  // FNV-1a row hashes for scroll detection, front ones cached until written
+  uint64_t *front_hashes;
+  uint8_t *is_front_hash_valid;
+  uint64_t *back_hashes;
+  // terminal cursor after the last output, x < 0 when unknown, x == width
+  // when a wrap is pending
+  CTUI_IVector2 cursor_xy;
+  // terminal SGR colors after the last output
+  int is_sgr_known;
+  CTUI_Color sgr_fg;
+  CTUI_Color sgr_bg;
+  char *out;
+  size_t out_size;
+  size_t out_capacity;
+  // set when a reserve failed, the frame is dropped and redrawn in full
+  int is_out_failed;
+  int is_redraw_pending;
+  CTUI_TerminalSyncUpdate sync_update;
+  // the terminal answered the mode 2026 DECRQM query as recognized
+  int is_sync_update_supported;
+  CTUI_TerminalStats stats;
+  // Indexed palettes store the palette index in r of the cell colors.
+  CTUI_ColorPalette palette;
+  uint8_t *color_lut;
+  // one row of fgs then bgs, and their palette indices
+  CTUI_Color *row_colors;
+  uint8_t *row_indices;
+  CTUI_TerminalInput input;
+  // when the ESC that left input in the escape state was read
+  uint64_t escape_ns;
+  // from SGR 1006 mouse reports, in tiles
+  CTUI_DVector2 cursor_tile_pos;
+  uint32_t mouse_buttons;
+} CTUI_TerminalConsole;
+
+static const CTUI_TerminalCell CTUI_TERMINAL_BLANK_CELL = {
+    .codepoint = ' ',
+    .fg = {.r = 255, .g = 255, .b = 255, .a = 255},
+    .bg = {.r = 0, .g = 0, .b = 0, .a = 255},
+};
+
+// East Asian Wide and Fullwidth codepoints, which take two columns
+static const uint32_t CTUI_TERMINAL_WIDE_RANGES[][2] = {
+    {0x1100, 0x115F}, {0x231A, 0x231B}, {0x2329, 0x232A}, {0x23E9, 0x23EC},
+    {0x23F0, 0x23F0}, {0x23F3, 0x23F3}, {0x25FD, 0x25FE}, {0x2614, 0x2615},
+    {0x2648, 0x2653}, {0x267F, 0x267F}, {0x2693, 0x2693}, {0x26A1, 0x26A1},
+    {0x26AA, 0x26AB}, {0x26BD, 0x26BE}, {0x26C4, 0x26C5}, {0x26CE, 0x26CE},
+    {0x26D4, 0x26D4}, {0x26EA, 0x26EA}, {0x26F2, 0x26F3}, {0x26F5, 0x26F5},
+    {0x26FA, 0x26FA}, {0x26FD, 0x26FD}, {0x2705, 0x2705}, {0x270A, 0x270B},
+    {0x2728, 0x2728}, {0x274C, 0x274C}, {0x274E, 0x274E}, {0x2753, 0x2755},
+    {0x2757, 0x2757}, {0x2795, 0x2797}, {0x27B0, 0x27B0}, {0x27BF, 0x27BF},
+    {0x2B1B, 0x2B1C}, {0x2B50, 0x2B50}, {0x2B55, 0x2B55}, {0x2E80, 0x303E},
+    {0x3041, 0x3247}, {0x3250, 0x4DBF}, {0x4E00, 0xA4C6}, {0xA960, 0xA97C},
+    {0xAC00, 0xD7A3}, {0xF900, 0xFAD9}, {0xFE10, 0xFE19}, {0xFE30, 0xFE6B},
+    {0xFF01, 0xFF60}, {0xFFE0, 0xFFE6}, {0x16FE0, 0x1B2FB}, {0x1F004, 0x1F004},
+    {0x1F0CF, 0x1F0CF}, {0x1F18E, 0x1F18E}, {0x1F191, 0x1F19A},
+    {0x1F200, 0x1F320}, {0x1F32D, 0x1F335}, {0x1F337, 0x1F37C},
+    {0x1F37E, 0x1F393}, {0x1F3A0, 0x1F3CA}, {0x1F3CF, 0x1F3D3},
+    {0x1F3E0, 0x1F3F0}, {0x1F3F4, 0x1F3F4}, {0x1F3F8, 0x1F43E},
+    {0x1F440, 0x1F440}, {0x1F442, 0x1F4FC}, {0x1F4FF, 0x1F53D},
+    {0x1F54B, 0x1F54E}, {0x1F550, 0x1F567}, {0x1F57A, 0x1F57A},
+    {0x1F595, 0x1F596}, {0x1F5A4, 0x1F5A4}, {0x1F5FB, 0x1F64F},
+    {0x1F680, 0x1F6C5}, {0x1F6CC, 0x1F6CC}, {0x1F6D0, 0x1F6D2},
+    {0x1F6D5, 0x1F6DF}, {0x1F6EB, 0x1F6EC}, {0x1F6F4, 0x1F6FC},
+    {0x1F7E0, 0x1F7F0}, {0x1F90C, 0x1F93A}, {0x1F93C, 0x1F945},
+    {0x1F947, 0x1F9FF}, {0x1FA70, 0x1FAF6}, {0x20000, 0x3FFFD},
+};
+
+static int CTUI_getTerminalCodepointWide(uint32_t codepoint) {
+  if (codepoint < CTUI_TERMINAL_WIDE_RANGES[0][0]) {
+    return 0;
+  }
+  size_t lo = 0;
+  size_t hi = sizeof(CTUI_TERMINAL_WIDE_RANGES) /
+              sizeof(CTUI_TERMINAL_WIDE_RANGES[0]);
+  while (lo < hi) {
+    const size_t mid = lo + (hi - lo) / 2;
+    if (codepoint < CTUI_TERMINAL_WIDE_RANGES[mid][0]) {
+      hi = mid;
+    } else if (codepoint > CTUI_TERMINAL_WIDE_RANGES[mid][1]) {
+      lo = mid + 1;
+    } else {
+      return 1;
+    }
+  }
+  return 0;
+}
+
+static int CTUI_reserveTerminalOut(CTUI_TerminalConsole *terminal,
+                                   size_t size) {
+  if (terminal->out_size + size <= terminal->out_capacity) {
+    return 0;
+  }
+  size_t new_capacity =
+      terminal->out_capacity == 0 ? 4096 : terminal->out_capacity * 2;
+  while (new_capacity < terminal->out_size + size) {
+    new_capacity *= 2;
+  }
+  char *new_out = realloc(terminal->out, new_capacity);
+  if (new_out == NULL) {
+    terminal->is_out_failed = 1;
+    return -1;
+  }
+  terminal->out = new_out;
+  terminal->out_capacity = new_capacity;
+  return 0;
+}
+
+static void CTUI_appendTerminalBytes(CTUI_TerminalConsole *terminal,
+                                     const char *bytes, size_t size) {
+  if (CTUI_reserveTerminalOut(terminal, size) != 0) {
+    return;
+  }
+  memcpy(terminal->out + terminal->out_size, bytes, size);
+  terminal->out_size += size;
+}
+
+static void CTUI_appendTerminalCstr(CTUI_TerminalConsole *terminal,
+                                    const char *cstr) {
+  CTUI_appendTerminalBytes(terminal, cstr, strlen(cstr));
+}
+
+// Appends the decimal digits of value, the only number formatting escape
+// sequences need.
+static void CTUI_appendTerminalUint(CTUI_TerminalConsole *terminal,
+                                    uint32_t value) {
+  char digits[10];
+  size_t digit_count = 0;
+  do {
+    digits[sizeof(digits) - 1 - digit_count++] = (char)('0' + value % 10);
+    value /= 10;
+  } while (value != 0);
+  CTUI_appendTerminalBytes(terminal, digits + sizeof(digits) - digit_count,
+                           digit_count);
+}
+
+static void CTUI_appendTerminalCodepoint(CTUI_TerminalConsole *terminal,
+                                         uint32_t codepoint) {
+  if (CTUI_reserveTerminalOut(terminal, 4) != 0) {
+    return;
+  }
+  char *out = terminal->out + terminal->out_size;
+  if (codepoint < 0x20 || codepoint == 0x7F ||
+      (codepoint >= 0xD800 && codepoint <= 0xDFFF) || codepoint > 0x10FFFF) {
+    // control characters would move the cursor
+    codepoint = codepoint < 0x80 ? ' ' : UTF32_REPLACEMENT_CHARACTER;
+  }
+  if (codepoint < 0x80) {
+    out[0] = (char)codepoint;
+    terminal->out_size += 1;
+  } else if (codepoint < 0x800) {
+    out[0] = (char)(0xC0 | (codepoint >> 6));
+    out[1] = (char)(0x80 | (codepoint & 0x3F));
+    terminal->out_size += 2;
+  } else if (codepoint < 0x10000) {
+    out[0] = (char)(0xE0 | (codepoint >> 12));
+    out[1] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+    out[2] = (char)(0x80 | (codepoint & 0x3F));
+    terminal->out_size += 3;
+  } else {
+    out[0] = (char)(0xF0 | (codepoint >> 18));
+    out[1] = (char)(0x80 | ((codepoint >> 12) & 0x3F));
+    out[2] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+    out[3] = (char)(0x80 | (codepoint & 0x3F));
+    terminal->out_size += 4;
+  }
+}
+
+static int CTUI_getTerminalColorsEqual(CTUI_Color a, CTUI_Color b) {
+  return a.r == b.r && a.g == b.g && a.b == b.b;
+}
+
+static int CTUI_getTerminalCellsEqual(const CTUI_TerminalCell *a,
+                                      const CTUI_TerminalCell *b) {
+  return a->codepoint == b->codepoint &&
+         CTUI_getTerminalColorsEqual(a->fg, b->fg) &&
+         CTUI_getTerminalColorsEqual(a->bg, b->bg);
+}
+
+// Appends the SGR parameters of a fg (is_bg 0) or bg color.
+static void CTUI_appendTerminalColor(CTUI_TerminalConsole *terminal,
+                                     int is_bg, CTUI_Color color) {
+  switch (terminal->palette) {
+  case CTUI_COLOR_PALETTE_16:
+    // 30-37 and 90-97 for fg, 40-47 and 100-107 for bg
+    CTUI_appendTerminalUint(terminal, (color.r < 8 ? 30 : 82) + color.r +
+                                          (is_bg ? 10 : 0));
+    break;
+  case CTUI_COLOR_PALETTE_256:
+    CTUI_appendTerminalCstr(terminal, is_bg ? "48;5;" : "38;5;");
+    CTUI_appendTerminalUint(terminal, color.r);
+    break;
+  default:
+    CTUI_appendTerminalCstr(terminal, is_bg ? "48;2;" : "38;2;");
+    CTUI_appendTerminalUint(terminal, color.r);
+    CTUI_appendTerminalBytes(terminal, ";", 1);
+    CTUI_appendTerminalUint(terminal, color.g);
+    CTUI_appendTerminalBytes(terminal, ";", 1);
+    CTUI_appendTerminalUint(terminal, color.b);
+    break;
+  }
+}
+
+// Emits one SGR sequence for whichever of fg and bg differ from the terminal.
+static void CTUI_setTerminalSgr(CTUI_TerminalConsole *terminal,
+                                CTUI_Color fg, CTUI_Color bg) {
+  const int is_fg_changed =
+      !terminal->is_sgr_known ||
+      !CTUI_getTerminalColorsEqual(terminal->sgr_fg, fg);
+  const int is_bg_changed =
+      !terminal->is_sgr_known ||
+      !CTUI_getTerminalColorsEqual(terminal->sgr_bg, bg);
+  if (!is_fg_changed && !is_bg_changed) {
+    return;
+  }
+  CTUI_appendTerminalBytes(terminal, "\x1b[", 2);
+  if (is_fg_changed) {
+    CTUI_appendTerminalColor(terminal, 0, fg);
+  }
+  if (is_bg_changed) {
+    if (is_fg_changed) {
+      CTUI_appendTerminalBytes(terminal, ";", 1);
+    }
+    CTUI_appendTerminalColor(terminal, 1, bg);
+  }
+  CTUI_appendTerminalBytes(terminal, "m", 1);
+  terminal->is_sgr_known = 1;
+  terminal->sgr_fg = fg;
+  terminal->sgr_bg = bg;
+}
+
+// Returns 1 if the cells between the cursor and x can be rewritten as single
+// bytes without changing SGR, which beats a cursor move for short gaps.
+static int CTUI_getTerminalGapRewritable(CTUI_TerminalConsole *terminal,
+                                         const CTUI_TerminalCell *row,
+                                         size_t x) {
+  const size_t cursor_x = (size_t)terminal->cursor_xy.x;
+  if (x - cursor_x > CTUI_TERMINAL_MAX_REWRITE_GAP || !terminal->is_sgr_known) {
+    return 0;
+  }
+  for (size_t gap_x = cursor_x; gap_x < x; gap_x++) {
+    if (row[gap_x].codepoint >= 0x7F || row[gap_x].codepoint < 0x20 ||
+        !CTUI_getTerminalColorsEqual(row[gap_x].fg, terminal->sgr_fg) ||
+        !CTUI_getTerminalColorsEqual(row[gap_x].bg, terminal->sgr_bg)) {
+      return 0;
+    }
+  }
+  return 1;
+}
+
+static void CTUI_moveTerminalCursor(CTUI_TerminalConsole *terminal,
+                                    const CTUI_TerminalCell *row, size_t x,
+                                    size_t y) {
+  const CTUI_IVector2 cursor_xy = terminal->cursor_xy;
+  if (cursor_xy.x >= 0 && (size_t)cursor_xy.y == y) {
+    if ((size_t)cursor_xy.x == x) {
+      return;
+    }
+    if ((size_t)cursor_xy.x < x) {
+      if (CTUI_getTerminalGapRewritable(terminal, row, x)) {
+        for (size_t gap_x = (size_t)cursor_xy.x; gap_x < x; gap_x++) {
+          const char byte = (char)row[gap_x].codepoint;
+          CTUI_appendTerminalBytes(terminal, &byte, 1);
+        }
+      } else {
+        CTUI_appendTerminalBytes(terminal, "\x1b[", 2);
+        CTUI_appendTerminalUint(terminal, (uint32_t)(x - cursor_xy.x));
+        CTUI_appendTerminalBytes(terminal, "C", 1);
+      }
+      terminal->cursor_xy.x = (int)x;
+      return;
+    }
+  }
+  if (cursor_xy.x >= 0 && x == 0 && (size_t)cursor_xy.y + 1 == y) {
+    CTUI_appendTerminalBytes(terminal, "\r\n", 2);
+  } else if (x == 0 && y == 0) {
+    CTUI_appendTerminalBytes(terminal, "\x1b[H", 3);
+  } else {
+    CTUI_appendTerminalBytes(terminal, "\x1b[", 2);
+    CTUI_appendTerminalUint(terminal, (uint32_t)y + 1);
+    if (x != 0) {
+      CTUI_appendTerminalBytes(terminal, ";", 1);
+      CTUI_appendTerminalUint(terminal, (uint32_t)x + 1);
+    }
+    CTUI_appendTerminalBytes(terminal, "H", 1);
+  }
+  terminal->cursor_xy = (CTUI_IVector2){(int)x, (int)y};
+}
+
+static void CTUI_diffTerminalRow(CTUI_TerminalConsole *terminal, size_t y,
+                                 size_t x0, size_t x1) {
+  const size_t width = terminal->cells_wh.x;
+  CTUI_TerminalCell *front = terminal->front_cells + y * width;
+  const CTUI_TerminalCell *back = terminal->back_cells + y * width;
+  // A wide glyph covers the cell to its right, whose codepoint is not drawn.
+  int is_covered = 0;
+  for (size_t x = 0; x < x0; x++) {
+    is_covered =
+        !is_covered && CTUI_getTerminalCodepointWide(back[x].codepoint);
+  }
+  for (size_t x = x0; x < x1; x++) {
+    if (is_covered) {
+      // Unknown, so it is redrawn once the wide glyph is gone.
+      if (front[x].codepoint != CTUI_TERMINAL_UNKNOWN_CODEPOINT) {
+        front[x].codepoint = CTUI_TERMINAL_UNKNOWN_CODEPOINT;
+        terminal->is_front_hash_valid[y] = 0;
+      }
+      is_covered = 0;
+      continue;
+    }
+    // A wide glyph does not fit the last column, so a space stands in.
+    const int is_wide =
+        CTUI_getTerminalCodepointWide(back[x].codepoint) && x + 1 < width;
+    is_covered = is_wide;
+    if (CTUI_getTerminalCellsEqual(&front[x], &back[x])) {
+      continue;
+    }
+    if (is_wide || CTUI_getTerminalCodepointWide(front[x].codepoint)) {
+      // Drawing or overwriting a wide glyph changes which cells are covered
+      // up to the end of the row.
+      x1 = width;
+    }
+    terminal->is_front_hash_valid[y] = 0;
+    CTUI_moveTerminalCursor(terminal, back, x, y);
+    CTUI_setTerminalSgr(terminal, back[x].fg, back[x].bg);
+    if (!is_wide && CTUI_getTerminalCodepointWide(back[x].codepoint)) {
+      CTUI_appendTerminalCodepoint(terminal, ' ');
+    } else {
+      CTUI_appendTerminalCodepoint(terminal, back[x].codepoint);
+    }
+    front[x] = back[x];
+    // After the last column x == width: the pending wrap state, where only
+    // CR and absolute moves are safe.
+    terminal->cursor_xy.x = (int)x + (is_wide ? 2 : 1);
+  }
+}
+
+// Composes the layers over the cells of rect, bottom layer first: the topmost
+// non-zero codepoint wins and the topmost opaque bg shows through.
+static void CTUI_composeTerminalCells(CTUI_TerminalConsole *terminal,
+                                      CTUI_SRect rect) {
+  CTUI_Console *console = &terminal->base;
+  const size_t width = terminal->cells_wh.x;
+  for (size_t y = rect.xy.y; y < rect.xy.y + rect.wh.y; y++) {
+    for (size_t x = rect.xy.x; x < rect.xy.x + rect.wh.x; x++) {
+      terminal->back_cells[y * width + x] = CTUI_TERMINAL_BLANK_CELL;
+    }
+  }
+  for (size_t layer_i = 0; layer_i < console->_layer_count; layer_i++) {
+    const CTUI_ConsoleLayer *layer = CTUI_getConsoleLayer(console, layer_i);
+    const CTUI_SVector2 tiles_wh = CTUI_getLayerTilesWh(layer);
+    const CTUI_DVector2 div_wh = layer->_tile_div_wh;
+    const uint32_t *codepoints = CTUI_getLayerCodepoints(layer);
+    const CTUI_Color *fgs = CTUI_getLayerFgs(layer);
+    const CTUI_Color *bgs = CTUI_getLayerBgs(layer);
+    for (size_t y = rect.xy.y; y < rect.xy.y + rect.wh.y; y++) {
+      const size_t tile_y = (size_t)((double)y * div_wh.y);
+      if (tile_y >= tiles_wh.y) {
+        break;
+      }
+      CTUI_TerminalCell *row = terminal->back_cells + y * width;
+      for (size_t x = rect.xy.x; x < rect.xy.x + rect.wh.x; x++) {
+        const size_t tile_x = (size_t)((double)x * div_wh.x);
+        if (tile_x >= tiles_wh.x) {
+          break;
+        }
+        const size_t tile_i = tile_y * tiles_wh.x + tile_x;
+        if (bgs[tile_i].a != 0) {
+          row[x].bg = bgs[tile_i];
+        }
+        if (codepoints[tile_i] != 0) {
+          row[x].codepoint = codepoints[tile_i];
+          row[x].fg = fgs[tile_i];
+        }
+      }
+    }
+  }
+}
+
+// Replaces the colors of the cells of rect by their palette indices, a row
+// at a time through the lookup table.
+static void CTUI_quantizeTerminalCells(CTUI_TerminalConsole *terminal,
+                                       CTUI_SRect rect) {
+  const size_t span = rect.wh.x;
+  CTUI_Color *row_colors = terminal->row_colors;
+  uint8_t *row_indices = terminal->row_indices;
+  for (size_t y = rect.xy.y; y < rect.xy.y + rect.wh.y; y++) {
+    CTUI_TerminalCell *row =
+        terminal->back_cells + y * terminal->cells_wh.x + rect.xy.x;
+    for (size_t i = 0; i < span; i++) {
+      row_colors[i] = row[i].fg;
+      row_colors[span + i] = row[i].bg;
+    }
+    CTUI_quantizeColors(terminal->color_lut, row_colors, row_indices,
+                        span * 2);
+    for (size_t i = 0; i < span; i++) {
+      row[i].fg = (CTUI_Color){.r = row_indices[i], .a = 255};
+      row[i].bg = (CTUI_Color){.r = row_indices[span + i], .a = 255};
+    }
+  }
+}
+
+// Console cells covered by the damage of any layer since the last refresh.
+static int CTUI_getTerminalDamage(CTUI_TerminalConsole *terminal,
+                                  CTUI_SRect *out_rect) {
+  CTUI_Console *console = &terminal->base;
+  if (terminal->is_redraw_pending) {
+    out_rect->xy = (CTUI_SVector2){0, 0};
+    out_rect->wh = terminal->cells_wh;
+    return terminal->cells_wh.x != 0 && terminal->cells_wh.y != 0;
+  }
+  size_t min_x = SIZE_MAX, min_y = SIZE_MAX, max_x = 0, max_y = 0;
+  for (size_t layer_i = 0; layer_i < console->_layer_count; layer_i++) {
+    const CTUI_ConsoleLayer *layer = CTUI_getConsoleLayer(console, layer_i);
+    CTUI_SRect damage;
+    if (!CTUI_getLayerDamage(layer, &damage)) {
+      continue;
+    }
+    const CTUI_DVector2 div_wh = layer->_tile_div_wh;
+    const size_t x0 = (size_t)((double)damage.xy.x / div_wh.x);
+    const size_t y0 = (size_t)((double)damage.xy.y / div_wh.y);
+    const size_t x1 =
+        (size_t)((double)(damage.xy.x + damage.wh.x) / div_wh.x + 0.999999);
+    const size_t y1 =
+        (size_t)((double)(damage.xy.y + damage.wh.y) / div_wh.y + 0.999999);
+    min_x = x0 < min_x ? x0 : min_x;
+    min_y = y0 < min_y ? y0 : min_y;
+    max_x = x1 > max_x ? x1 : max_x;
+    max_y = y1 > max_y ? y1 : max_y;
+  }
+  max_x = max_x < terminal->cells_wh.x ? max_x : terminal->cells_wh.x;
+  max_y = max_y < terminal->cells_wh.y ? max_y : terminal->cells_wh.y;
+  if (min_x >= max_x || min_y >= max_y) {
+    return 0;
+  }
+  out_rect->xy = (CTUI_SVector2){min_x, min_y};
+  out_rect->wh = (CTUI_SVector2){max_x - min_x, max_y - min_y};
+  return 1;
+}
+
+static void CTUI_invalidateTerminal(CTUI_TerminalConsole *terminal);
+
+// Sends the whole output buffer, in one write unless the terminal accepts
+// only part of it.
+static void CTUI_writeTerminalOut(CTUI_TerminalConsole *terminal) {
+  size_t written = 0;
+  while (written < terminal->out_size) {
+    const ssize_t result = write(terminal->out_fd, terminal->out + written,
+                                 terminal->out_size - written);
+    terminal->stats.write_calls++;
+    if (result < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    written += (size_t)result;
+  }
+  terminal->stats.bytes_written += written;
+  if (written < terminal->out_size) {
+    // The front buffer, cursor and SGR state already count the dropped bytes
+    // as shown.
+    terminal->is_redraw_pending = 1;
+    CTUI_invalidateTerminal(terminal);
+  }
+  terminal->out_size = 0;
+}
+
+static int CTUI_getSyncUpdateActive(const CTUI_TerminalConsole *terminal) {
+  return terminal->sync_update == CTUI_TERMINAL_SYNC_UPDATE_ON ||
+         (terminal->sync_update == CTUI_TERMINAL_SYNC_UPDATE_AUTO &&
+          terminal->is_sync_update_supported);
+}
+
+// Forgets what the terminal shows so the next refresh redraws every cell.
+static void CTUI_invalidateTerminal(CTUI_TerminalConsole *terminal) {
+  const size_t cell_count = terminal->cells_wh.x * terminal->cells_wh.y;
+  for (size_t i = 0; i < cell_count; i++) {
+    terminal->front_cells[i].codepoint = CTUI_TERMINAL_UNKNOWN_CODEPOINT;
+  }
+  memset(terminal->is_front_hash_valid, 0, terminal->cells_wh.y);
+  terminal->cursor_xy = (CTUI_IVector2){-1, -1};
+  terminal->is_sgr_known = 0;
+}
+
+static uint64_t CTUI_hashTerminalRow(CTUI_TerminalConsole *terminal,
+                                     CTUI_TerminalCell *cells, size_t y) {
+  const size_t width = terminal->cells_wh.x;
+  return FNV_hashNextBuffer64_1a(cells + y * width,
+                                 width * sizeof(CTUI_TerminalCell),
+                                 FNV_64_1A_INIT);
+}
+
+// Finds the longest run of damaged rows that the back buffer holds shifted
+// by shift rows against the front buffer, back row y == front row y + shift.
+// Returns the run length.
+static size_t CTUI_findTerminalScroll(CTUI_TerminalConsole *terminal,
+                                      size_t y0, size_t y1, int *out_shift,
+                                      size_t *out_run_y) {
+  size_t best_length = 0;
+  for (size_t y = y0; y < y1; y++) {
+    terminal->back_hashes[y] =
+        CTUI_hashTerminalRow(terminal, terminal->back_cells, y);
+    if (!terminal->is_front_hash_valid[y]) {
+      terminal->front_hashes[y] =
+          CTUI_hashTerminalRow(terminal, terminal->front_cells, y);
+      terminal->is_front_hash_valid[y] = 1;
+    }
+  }
+  const int row_count = (int)(y1 - y0);
+  for (int shift = 1 - row_count; shift < row_count; shift++) {
+    if (shift == 0) {
+      continue;
+    }
+    size_t length = 0;
+    const size_t begin_y = shift > 0 ? y0 : y0 - shift;
+    const size_t end_y = shift > 0 ? y1 - shift : y1;
+    for (size_t y = begin_y; y < end_y; y++) {
+      if (terminal->back_hashes[y] == terminal->front_hashes[y + shift] &&
+          terminal->back_hashes[y] != terminal->front_hashes[y]) {
+        length++;
+        if (length > best_length) {
+          best_length = length;
+          *out_shift = shift;
+          *out_run_y = y + 1 - length;
+        }
+      } else {
+        length = 0;
+      }
+    }
+  }
+  return best_length;
+}
+
+// Scrolls the terminal when most of the damage is the front buffer moved
+// vertically, as in a log pane, so only the new rows are written. Rows are
+// compared whole since scroll regions have no left and right margin.
+static void CTUI_scrollTerminal(CTUI_TerminalConsole *terminal,
+                                CTUI_SRect damage) {
+  const size_t width = terminal->cells_wh.x;
+  if (damage.wh.y <= CTUI_TERMINAL_MIN_SCROLL_ROWS) {
+    return;
+  }
+  int shift = 0;
+  size_t run_y = 0;
+  const size_t run_length = CTUI_findTerminalScroll(
+      terminal, damage.xy.y, damage.xy.y + damage.wh.y, &shift, &run_y);
+  if (run_length < CTUI_TERMINAL_MIN_SCROLL_ROWS) {
+    return;
+  }
+  const size_t row_size = width * sizeof(CTUI_TerminalCell);
+  for (size_t y = run_y; y < run_y + run_length; y++) {
+    // hash collision
+    if (memcmp(terminal->back_cells + y * width,
+               terminal->front_cells + (y + shift) * width, row_size) != 0) {
+      return;
+    }
+  }
+  // The region covers the run and the rows it moves out of.
+  const size_t distance = (size_t)(shift > 0 ? shift : -shift);
+  const size_t top_y = shift > 0 ? run_y : run_y - distance;
+  const size_t bottom_y = top_y + run_length + distance - 1;
+  const int is_full_screen = top_y == 0 && bottom_y + 1 == terminal->cells_wh.y;
+  if (!is_full_screen) {
+    // DECSTBM
+    CTUI_appendTerminalBytes(terminal, "\x1b[", 2);
+    CTUI_appendTerminalUint(terminal, (uint32_t)top_y + 1);
+    CTUI_appendTerminalBytes(terminal, ";", 1);
+    CTUI_appendTerminalUint(terminal, (uint32_t)bottom_y + 1);
+    CTUI_appendTerminalBytes(terminal, "r", 1);
+  }
+  // SU scrolls content up, SD down
+  CTUI_appendTerminalBytes(terminal, "\x1b[", 2);
+  CTUI_appendTerminalUint(terminal, (uint32_t)distance);
+  CTUI_appendTerminalBytes(terminal, shift > 0 ? "S" : "T", 1);
+  if (!is_full_screen) {
+    CTUI_appendTerminalBytes(terminal, "\x1b[r", 3);
+  }
+  // DECSTBM homes the cursor, SU and SD leave it
+  if (!is_full_screen) {
+    terminal->cursor_xy = (CTUI_IVector2){0, 0};
+  }
+  // Move the front rows along, the rows scrolled in are blank in a color that
+  // depends on the terminal, so they are unknown.
+  const size_t moved_count = run_length;
+  const size_t src_y = shift > 0 ? top_y + distance : top_y;
+  const size_t dst_y = shift > 0 ? top_y : top_y + distance;
+  memmove(terminal->front_cells + dst_y * width,
+          terminal->front_cells + src_y * width, moved_count * row_size);
+  memmove(terminal->front_hashes + dst_y, terminal->front_hashes + src_y,
+          moved_count * sizeof(uint64_t));
+  memmove(terminal->is_front_hash_valid + dst_y,
+          terminal->is_front_hash_valid + src_y, moved_count);
+  const size_t blank_y = shift > 0 ? bottom_y + 1 - distance : top_y;
+  for (size_t y = blank_y; y < blank_y + distance; y++) {
+    for (size_t x = 0; x < width; x++) {
+      terminal->front_cells[y * width + x].codepoint =
+          CTUI_TERMINAL_UNKNOWN_CODEPOINT;
+    }
+    terminal->is_front_hash_valid[y] = 0;
+  }
+}
+
+static void CTUI_refreshTerminalConsole(CTUI_Console *console) {
+  CTUI_TerminalConsole *terminal = (CTUI_TerminalConsole *)console;
+  CTUI_SRect damage;
+  if (!CTUI_getTerminalDamage(terminal, &damage)) {
+    return;
+  }
+  if (damage.wh.y > CTUI_TERMINAL_MIN_SCROLL_ROWS) {
+    // Scroll detection hashes and may blank whole rows.
+    damage.xy.x = 0;
+    damage.wh.x = terminal->cells_wh.x;
+  }
+  CTUI_composeTerminalCells(terminal, damage);
+  if (terminal->palette != CTUI_COLOR_PALETTE_TRUECOLOR) {
+    CTUI_quantizeTerminalCells(terminal, damage);
+  }
+  // The frame goes out as one buffer, between synchronized update markers
+  // when the terminal supports them, so it is never shown half drawn.
+  const size_t frame_begin = terminal->out_size;
+  const int is_sync_update = CTUI_getSyncUpdateActive(terminal);
+  if (is_sync_update) {
+    CTUI_appendTerminalCstr(terminal, "\x1b[?2026h");
+  }
+  const size_t body_begin = terminal->out_size;
+  CTUI_scrollTerminal(terminal, damage);
+  for (size_t y = damage.xy.y; y < damage.xy.y + damage.wh.y; y++) {
+    CTUI_diffTerminalRow(terminal, y, damage.xy.x, damage.xy.x + damage.wh.x);
+  }
+  if (terminal->is_out_failed) {
+    terminal->out_size = 0;
+    terminal->is_out_failed = 0;
+    terminal->is_redraw_pending = 1;
+    CTUI_invalidateTerminal(terminal);
+    return;
+  }
+  terminal->is_redraw_pending = 0;
+  if (terminal->out_size == body_begin) {
+    terminal->out_size = frame_begin;
+    if (terminal->out_size == 0) {
+      return;
+    }
+  } else if (is_sync_update) {
+    CTUI_appendTerminalCstr(terminal, "\x1b[?2026l");
+  }
+  const uint64_t start_ns = CTUI_getMonotonicNs();
+  const uint64_t bytes_written = terminal->stats.bytes_written;
+  CTUI_writeTerminalOut(terminal);
+  CTUI_addFrameStageNs(console->_ctx, CTUI_FRAME_STAGE_SWAP,
+                       CTUI_getMonotonicNs() - start_ns);
+  terminal->stats.frame_count++;
+  terminal->stats.last_frame_bytes =
+      terminal->stats.bytes_written - bytes_written;
+  console->_counters.bytes_uploaded += terminal->stats.last_frame_bytes;
+}
+
+static void CTUI_freeTerminalCells(CTUI_TerminalConsole *terminal) {
+  free(terminal->front_cells);
+  free(terminal->back_cells);
+  free(terminal->row_colors);
+  free(terminal->row_indices);
+  free(terminal->front_hashes);
+  free(terminal->is_front_hash_valid);
+  free(terminal->back_hashes);
+}
+
+static int CTUI_allocTerminalCells(CTUI_TerminalConsole *terminal,
+                                   CTUI_SVector2 cells_wh) {
+  const size_t cell_count = cells_wh.x * cells_wh.y;
+  CTUI_TerminalCell *front_cells =
+      calloc(cell_count, sizeof(CTUI_TerminalCell));
+  CTUI_TerminalCell *back_cells = calloc(cell_count, sizeof(CTUI_TerminalCell));
+  CTUI_Color *row_colors = malloc(sizeof(CTUI_Color) * 2 * cells_wh.x);
+  uint8_t *row_indices = malloc(2 * cells_wh.x);
+  uint64_t *front_hashes = malloc(sizeof(uint64_t) * cells_wh.y);
+  uint8_t *is_front_hash_valid = malloc(cells_wh.y);
+  uint64_t *back_hashes = malloc(sizeof(uint64_t) * cells_wh.y);
+  if (cell_count != 0 &&
+      (front_cells == NULL || back_cells == NULL || row_colors == NULL ||
+       row_indices == NULL || front_hashes == NULL ||
+       is_front_hash_valid == NULL || back_hashes == NULL)) {
+    free(front_cells);
+    free(back_cells);
+    free(row_colors);
+    free(row_indices);
+    free(front_hashes);
+    free(is_front_hash_valid);
+    free(back_hashes);
+    return -1;
+  }
+  CTUI_freeTerminalCells(terminal);
+  terminal->front_cells = front_cells;
+  terminal->back_cells = back_cells;
+  terminal->row_colors = row_colors;
+  terminal->row_indices = row_indices;
+  terminal->front_hashes = front_hashes;
+  terminal->is_front_hash_valid = is_front_hash_valid;
+  terminal->back_hashes = back_hashes;
+  terminal->cells_wh = cells_wh;
+  CTUI_invalidateTerminal(terminal);
+  return 0;
+}
+
+static int CTUI_getTerminalSize(int fd, CTUI_SVector2 *out_cells_wh) {
+  struct winsize size;
+  if (ioctl(fd, TIOCGWINSZ, &size) != 0 || size.ws_col == 0 ||
+      size.ws_row == 0) {
+    return -1;
+  }
+  *out_cells_wh = (CTUI_SVector2){size.ws_col, size.ws_row};
+  return 0;
+}
+
+static void CTUI_resizeTerminalConsole(CTUI_TerminalConsole *terminal,
+                                       CTUI_SVector2 cells_wh) {
+  CTUI_Console *console = &terminal->base;
+  if (CTUI_allocTerminalCells(terminal, cells_wh) != 0 ||
+      CTUI_resizeConsoleLayers(console, cells_wh) != 0) {
+    return;
+  }
+  // Resizing damages every layer, so the next refresh redraws every cell.
+  CTUI_Event ev = {0};
+  ev.type = CTUI_EVENT_RESIZE;
+  ev.console = console;
+  ev.data.resize.console_tile_wh = console->_console_tile_wh;
+  CTUI_pushEvent(console->_ctx, &ev);
+}
+
+static void CTUI_pushTerminalKey(CTUI_Console *console, CTUI_Key key,
+                                 int mods) {
+  // Terminals only report presses, so a release follows at once.
+  CTUI_Event ev = {0};
+  ev.type = CTUI_EVENT_KEY;
+  ev.console = console;
+  ev.data.key.key = key;
+  ev.data.key.action = CTUIA_PRESS;
+  ev.data.key.mods = mods;
+  CTUI_pushEvent(console->_ctx, &ev);
+  ev.data.key.action = CTUIA_RELEASE;
+  CTUI_pushEvent(console->_ctx, &ev);
+}
+
+// Maps a printable ASCII byte to the unshifted US layout key.
+static int CTUI_getTerminalAsciiKey(uint8_t byte, CTUI_Key *out_key,
+                                    int *out_mods) {
+  static const char SHIFTED_DIGITS[] = ")!@#$%^&*(";
+  static const char SHIFTED[] = "~_+{}|:\"<>?";
+  static const char UNSHIFTED[] = "`-=[]\\;',./";
+  *out_mods = 0;
+  if (byte >= 'a' && byte <= 'z') {
+    *out_key = (CTUI_Key)(CTUIK_A + (byte - 'a'));
+    return 1;
+  }
+  if (byte >= 'A' && byte <= 'Z') {
+    *out_key = (CTUI_Key)(CTUIK_A + (byte - 'A'));
+    *out_mods = CTUIM_SHIFT;
+    return 1;
+  }
+  if (byte == ' ' || (byte >= '0' && byte <= '9')) {
+    *out_key = (CTUI_Key)byte;
+    return 1;
+  }
+  const char *shifted_digit = memchr(SHIFTED_DIGITS, byte, 10);
+  if (shifted_digit != NULL) {
+    *out_key = (CTUI_Key)(CTUIK_NUM0 + (shifted_digit - SHIFTED_DIGITS));
+    *out_mods = CTUIM_SHIFT;
+    return 1;
+  }
+  const char *shifted = memchr(SHIFTED, byte, sizeof(SHIFTED) - 1);
+  if (shifted != NULL) {
+    *out_key = (CTUI_Key)UNSHIFTED[shifted - SHIFTED];
+    *out_mods = CTUIM_SHIFT;
+    return 1;
+  }
+  if (memchr(UNSHIFTED, byte, sizeof(UNSHIFTED) - 1) != NULL) {
+    *out_key = (CTUI_Key)byte;
+    return 1;
+  }
+  return 0;
+}
+
+// Input parser states
+enum {
+  CTUI_INPUT_GROUND = 0,
+  CTUI_INPUT_ESCAPE,
+  CTUI_INPUT_CSI,
+  CTUI_INPUT_SS3,
+  CTUI_INPUT_STATE_COUNT
+};
+
+// Input byte classes
+enum {
+  CTUI_INPUT_CLASS_C0 = 0,
+  CTUI_INPUT_CLASS_ESC,
+  // 0x20-0x2F
+  CTUI_INPUT_CLASS_INTERMEDIATE,
+  // 0x30-0x3F, digits, ';' and the private markers '<' '=' '>' '?'
+  CTUI_INPUT_CLASS_PARAM,
+  CTUI_INPUT_CLASS_BRACKET,
+  CTUI_INPUT_CLASS_O,
+  // 0x40-0x7E other than '[' and 'O'
+  CTUI_INPUT_CLASS_FINAL,
+  CTUI_INPUT_CLASS_DEL,
+  // 0x80-0xFF, UTF-8 text, which has no event
+  CTUI_INPUT_CLASS_HIGH,
+  CTUI_INPUT_CLASS_COUNT
+};
+
+// Input parser actions
+enum {
+  CTUI_INPUT_IGNORE = 0,
+  CTUI_INPUT_PRINT,
+  CTUI_INPUT_CONTROL,
+  CTUI_INPUT_ALT_PRINT,
+  CTUI_INPUT_ALT_CONTROL,
+  // a second ESC: the first was the Escape key
+  CTUI_INPUT_ESCAPE_KEY,
+  CTUI_INPUT_CLEAR,
+  CTUI_INPUT_PARAM,
+  CTUI_INPUT_COLLECT,
+  CTUI_INPUT_CSI_DISPATCH,
+  CTUI_INPUT_SS3_DISPATCH
+};
+
+typedef struct CTUI_InputTransition {
+  uint8_t action;
+  uint8_t next_state;
+} CTUI_InputTransition;
+
+#define CTUI_INPUT_TO(ACTION, STATE)                                           \
+  { CTUI_INPUT_##ACTION, CTUI_INPUT_##STATE }
+
+static const CTUI_InputTransition
+    CTUI_INPUT_TRANSITIONS[CTUI_INPUT_STATE_COUNT][CTUI_INPUT_CLASS_COUNT] = {
+        [CTUI_INPUT_GROUND] =
+            {
+                [CTUI_INPUT_CLASS_C0] = CTUI_INPUT_TO(CONTROL, GROUND),
+                [CTUI_INPUT_CLASS_ESC] = CTUI_INPUT_TO(IGNORE, ESCAPE),
+                [CTUI_INPUT_CLASS_INTERMEDIATE] = CTUI_INPUT_TO(PRINT, GROUND),
+                [CTUI_INPUT_CLASS_PARAM] = CTUI_INPUT_TO(PRINT, GROUND),
+                [CTUI_INPUT_CLASS_BRACKET] = CTUI_INPUT_TO(PRINT, GROUND),
+                [CTUI_INPUT_CLASS_O] = CTUI_INPUT_TO(PRINT, GROUND),
+                [CTUI_INPUT_CLASS_FINAL] = CTUI_INPUT_TO(PRINT, GROUND),
+                [CTUI_INPUT_CLASS_DEL] = CTUI_INPUT_TO(CONTROL, GROUND),
+                [CTUI_INPUT_CLASS_HIGH] = CTUI_INPUT_TO(IGNORE, GROUND),
+            },
+        [CTUI_INPUT_ESCAPE] =
+            {
+                [CTUI_INPUT_CLASS_C0] = CTUI_INPUT_TO(ALT_CONTROL, GROUND),
+                [CTUI_INPUT_CLASS_ESC] = CTUI_INPUT_TO(ESCAPE_KEY, ESCAPE),
+                [CTUI_INPUT_CLASS_INTERMEDIATE] =
+                    CTUI_INPUT_TO(ALT_PRINT, GROUND),
+                [CTUI_INPUT_CLASS_PARAM] = CTUI_INPUT_TO(ALT_PRINT, GROUND),
+                [CTUI_INPUT_CLASS_BRACKET] = CTUI_INPUT_TO(CLEAR, CSI),
+                [CTUI_INPUT_CLASS_O] = CTUI_INPUT_TO(CLEAR, SS3),
+                [CTUI_INPUT_CLASS_FINAL] = CTUI_INPUT_TO(ALT_PRINT, GROUND),
+                [CTUI_INPUT_CLASS_DEL] = CTUI_INPUT_TO(ALT_CONTROL, GROUND),
+                [CTUI_INPUT_CLASS_HIGH] = CTUI_INPUT_TO(ESCAPE_KEY, GROUND),
+            },
+        [CTUI_INPUT_CSI] =
+            {
+                [CTUI_INPUT_CLASS_C0] = CTUI_INPUT_TO(IGNORE, CSI),
+                [CTUI_INPUT_CLASS_ESC] = CTUI_INPUT_TO(IGNORE, ESCAPE),
+                [CTUI_INPUT_CLASS_INTERMEDIATE] = CTUI_INPUT_TO(COLLECT, CSI),
+                [CTUI_INPUT_CLASS_PARAM] = CTUI_INPUT_TO(PARAM, CSI),
+                // the Linux console sends F1-F5 as CSI [ A-E
+                [CTUI_INPUT_CLASS_BRACKET] = CTUI_INPUT_TO(COLLECT, CSI),
+                [CTUI_INPUT_CLASS_O] = CTUI_INPUT_TO(CSI_DISPATCH, GROUND),
+                [CTUI_INPUT_CLASS_FINAL] = CTUI_INPUT_TO(CSI_DISPATCH, GROUND),
+                [CTUI_INPUT_CLASS_DEL] = CTUI_INPUT_TO(IGNORE, CSI),
+                [CTUI_INPUT_CLASS_HIGH] = CTUI_INPUT_TO(IGNORE, GROUND),
+            },
+        [CTUI_INPUT_SS3] =
+            {
+                [CTUI_INPUT_CLASS_C0] = CTUI_INPUT_TO(IGNORE, GROUND),
+                [CTUI_INPUT_CLASS_ESC] = CTUI_INPUT_TO(IGNORE, ESCAPE),
+                [CTUI_INPUT_CLASS_INTERMEDIATE] = CTUI_INPUT_TO(IGNORE, GROUND),
+                // modifiers some terminals put before the SS3 final
+                [CTUI_INPUT_CLASS_PARAM] = CTUI_INPUT_TO(PARAM, SS3),
+                [CTUI_INPUT_CLASS_BRACKET] = CTUI_INPUT_TO(IGNORE, GROUND),
+                [CTUI_INPUT_CLASS_O] = CTUI_INPUT_TO(IGNORE, GROUND),
+                [CTUI_INPUT_CLASS_FINAL] = CTUI_INPUT_TO(SS3_DISPATCH, GROUND),
+                [CTUI_INPUT_CLASS_DEL] = CTUI_INPUT_TO(IGNORE, GROUND),
+                [CTUI_INPUT_CLASS_HIGH] = CTUI_INPUT_TO(IGNORE, GROUND),
+            },
+};
+
+static uint8_t CTUI_getInputClass(uint8_t byte) {
+  if (byte == 0x1B) {
+    return CTUI_INPUT_CLASS_ESC;
+  }
+  if (byte < 0x20) {
+    return CTUI_INPUT_CLASS_C0;
+  }
+  if (byte < 0x30) {
+    return CTUI_INPUT_CLASS_INTERMEDIATE;
+  }
+  if (byte < 0x40) {
+    return CTUI_INPUT_CLASS_PARAM;
+  }
+  if (byte == '[') {
+    return CTUI_INPUT_CLASS_BRACKET;
+  }
+  if (byte == 'O') {
+    return CTUI_INPUT_CLASS_O;
+  }
+  if (byte < 0x7F) {
+    return CTUI_INPUT_CLASS_FINAL;
+  }
+  return byte == 0x7F ? CTUI_INPUT_CLASS_DEL : CTUI_INPUT_CLASS_HIGH;
+}
+
+// Maps a control byte (C0 or DEL) to its key.
+static void CTUI_getTerminalControlKey(uint8_t byte, CTUI_Key *out_key,
+                                       int *out_mods) {
+  *out_mods = 0;
+  switch (byte) {
+  case '\r':
+  case '\n':
+    *out_key = CTUIK_ENTER;
+    break;
+  case '\t':
+    *out_key = CTUIK_TAB;
+    break;
+  case 0x08:
+  case 0x7F:
+    *out_key = CTUIK_BACKSPACE;
+    break;
+  case 0x00:
+    *out_key = CTUIK_SPACE;
+    *out_mods = CTUIM_CONTROL;
+    break;
+  default:
+    if (byte <= 0x1A) {
+      *out_key = (CTUI_Key)(CTUIK_A + (byte - 0x01));
+    } else {
+      // 0x1C-0x1F are Ctrl with \ ] ^ _
+      *out_key = (CTUI_Key)(byte + 0x40);
+    }
+    *out_mods = CTUIM_CONTROL;
+    break;
+  }
+}
+
+static uint32_t CTUI_getInputParam(const CTUI_TerminalInput *input,
+                                   size_t param_i, uint32_t default_value) {
+  return param_i < input->param_count && input->params[param_i] != 0
+             ? input->params[param_i]
+             : default_value;
+}
+
+// xterm encodes mods as 1 + shift | alt << 1 | ctrl << 2 | meta << 3.
+static int CTUI_getInputMods(uint32_t param) {
+  const uint32_t bits = param > 0 ? param - 1 : 0;
+  int mods = 0;
+  if (bits & 1)
+    mods |= CTUIM_SHIFT;
+  if (bits & 2)
+    mods |= CTUIM_ALT;
+  if (bits & 4)
+    mods |= CTUIM_CONTROL;
+  if (bits & 8)
+    mods |= CTUIM_SUPER;
+  return mods;
+}
+
+// Key of a final byte shared by CSI and SS3, 0 if none.
+static CTUI_Key CTUI_getInputFinalKey(uint8_t final) {
+  switch (final) {
+  case 'A':
+    return CTUIK_UP;
+  case 'B':
+    return CTUIK_DOWN;
+  case 'C':
+    return CTUIK_RIGHT;
+  case 'D':
+    return CTUIK_LEFT;
+  case 'H':
+    return CTUIK_HOME;
+  case 'F':
+    return CTUIK_END;
+  case 'P':
+    return CTUIK_F1;
+  case 'Q':
+    return CTUIK_F2;
+  case 'R':
+    return CTUIK_F3;
+  case 'S':
+    return CTUIK_F4;
+  case 'M':
+    return CTUIK_KP_ENTER;
+  default:
+    return (CTUI_Key)0;
+  }
+}
+
+// Key of CSI number ~, 0 if none.
+static CTUI_Key CTUI_getInputTildeKey(uint32_t number) {
+  static const uint16_t KEYS[] = {
+      [1] = CTUIK_HOME,     [2] = CTUIK_INSERT,     [3] = CTUIK_DELETE,
+      [4] = CTUIK_END,      [5] = CTUIK_PAGE_UP,    [6] = CTUIK_PAGE_DOWN,
+      [7] = CTUIK_HOME,     [8] = CTUIK_END,        [11] = CTUIK_F1,
+      [12] = CTUIK_F2,      [13] = CTUIK_F3,        [14] = CTUIK_F4,
+      [15] = CTUIK_F5,      [17] = CTUIK_F6,        [18] = CTUIK_F7,
+      [19] = CTUIK_F8,      [20] = CTUIK_F9,        [21] = CTUIK_F10,
+      [23] = CTUIK_F11,     [24] = CTUIK_F12,       [25] = CTUIK_F13,
+      [26] = CTUIK_F14,     [28] = CTUIK_F15,       [29] = CTUIK_F16,
+      [31] = CTUIK_F17,     [32] = CTUIK_F18,       [33] = CTUIK_F19,
+      [34] = CTUIK_F20,
+  };
+  return number < sizeof(KEYS) / sizeof(KEYS[0]) ? (CTUI_Key)KEYS[number]
+                                                 : (CTUI_Key)0;
+}
+
+// SGR 1006 mouse report CSI < b ; x ; y M (press) or m (release).
+static void CTUI_dispatchInputMouse(CTUI_TerminalConsole *terminal,
+                                    uint8_t final) {
+  CTUI_Console *console = &terminal->base;
+  const CTUI_TerminalInput *input = &terminal->input;
+  const uint32_t code = CTUI_getInputParam(input, 0, 0);
+  const CTUI_DVector2 tile_pos = {
+      (double)CTUI_getInputParam(input, 1, 1) - 1.0,
+      (double)CTUI_getInputParam(input, 2, 1) - 1.0,
+  };
+  int mods = 0;
+  if (code & 4)
+    mods |= CTUIM_SHIFT;
+  if (code & 8)
+    mods |= CTUIM_ALT;
+  if (code & 16)
+    mods |= CTUIM_CONTROL;
+  CTUI_Event ev = {0};
+  ev.console = console;
+  if (tile_pos.x != terminal->cursor_tile_pos.x ||
+      tile_pos.y != terminal->cursor_tile_pos.y) {
+    terminal->cursor_tile_pos = tile_pos;
+    ev.type = CTUI_EVENT_CURSOR_POS;
+    ev.data.cursor_pos.viewport_xy = tile_pos;
+    ev.data.cursor_pos.tile_xy = tile_pos;
+    CTUI_pushEvent(console->_ctx, &ev);
+  }
+  if (code & 64) {
+    // wheel: 64 up, 65 down, 66 left, 67 right
+    static const double SCROLL_XY[4][2] = {{0, 1}, {0, -1}, {1, 0}, {-1, 0}};
+    ev.type = CTUI_EVENT_SCROLL;
+    ev.data.scroll.scroll_xy.x = SCROLL_XY[code & 3][0];
+    ev.data.scroll.scroll_xy.y = SCROLL_XY[code & 3][1];
+    CTUI_pushEvent(console->_ctx, &ev);
+    return;
+  }
+  if ((code & 32) || (code & 3) == 3) {
+    // motion, with or without a button held
+    return;
+  }
+  static const int BUTTONS[3] = {CTUIMB_LEFT, CTUIMB_MIDDLE, CTUIMB_RIGHT};
+  const int button = BUTTONS[code & 3];
+  const int is_press = final == 'M';
+  if (is_press) {
+    terminal->mouse_buttons |= 1u << button;
+  } else {
+    terminal->mouse_buttons &= ~(1u << button);
+  }
+  ev.type = CTUI_EVENT_MOUSE_BUTTON;
+  ev.data.mouse_button.button = button;
+  ev.data.mouse_button.action = is_press ? CTUIA_PRESS : CTUIA_RELEASE;
+  ev.data.mouse_button.mods = mods;
+  CTUI_pushEvent(console->_ctx, &ev);
+}
+
+static void CTUI_dispatchInputCsi(CTUI_TerminalConsole *terminal,
+                                  uint8_t final) {
+  CTUI_Console *console = &terminal->base;
+  const CTUI_TerminalInput *input = &terminal->input;
+  if (input->private_marker == '<') {
+    if (final == 'M' || final == 'm') {
+      CTUI_dispatchInputMouse(terminal, final);
+    }
+    return;
+  }
+  if (input->private_marker == '?') {
+    // DECRQM reply CSI ? 2026 ; Ps $ y to the query sent at creation, Ps 1,
+    // 2 and 3 (set, reset, permanently set) mean the mode is known
+    if (final == 'y' && input->intermediate == '$' &&
+        CTUI_getInputParam(input, 0, 0) == 2026) {
+      const uint32_t value = CTUI_getInputParam(input, 1, 0);
+      terminal->is_sync_update_supported = value >= 1 && value <= 3;
+    }
+    return;
+  }
+  if (input->private_marker != 0) {
+    return;
+  }
+  if (input->intermediate == '[') {
+    if (final >= 'A' && final <= 'E') {
+      CTUI_pushTerminalKey(console, (CTUI_Key)(CTUIK_F1 + (final - 'A')), 0);
+    }
+    return;
+  }
+  const int mods = CTUI_getInputMods(CTUI_getInputParam(input, 1, 1));
+  if (final == '~') {
+    const CTUI_Key key = CTUI_getInputTildeKey(CTUI_getInputParam(input, 0, 0));
+    if (key != 0) {
+      CTUI_pushTerminalKey(console, key, mods);
+    }
+    return;
+  }
+  if (final == 'Z') {
+    CTUI_pushTerminalKey(console, CTUIK_TAB, CTUIM_SHIFT);
+    return;
+  }
+  const CTUI_Key key = CTUI_getInputFinalKey(final);
+  if (key != 0 && key != CTUIK_KP_ENTER) {
+    CTUI_pushTerminalKey(console, key, mods);
+  }
+}
+
+static void CTUI_dispatchInputSs3(CTUI_TerminalConsole *terminal,
+                                  uint8_t final) {
+  const CTUI_Key key = CTUI_getInputFinalKey(final);
+  if (key != 0) {
+    CTUI_pushTerminalKey(
+        &terminal->base, key,
+        CTUI_getInputMods(CTUI_getInputParam(&terminal->input, 0, 1)));
+  }
+}
+
+// Runs bytes through the input state machine. A sequence split across reads
+// continues on the next call.
+static void CTUI_parseTerminalInput(CTUI_TerminalConsole *terminal,
+                                    const uint8_t *bytes, size_t size) {
+  CTUI_Console *console = &terminal->base;
+  CTUI_TerminalInput *input = &terminal->input;
+  for (size_t i = 0; i < size; i++) {
+    const uint8_t byte = bytes[i];
+    const CTUI_InputTransition transition =
+        CTUI_INPUT_TRANSITIONS[input->state][CTUI_getInputClass(byte)];
+    input->state = transition.next_state;
+    CTUI_Key key;
+    int mods;
+    switch (transition.action) {
+    case CTUI_INPUT_PRINT:
+      if (CTUI_getTerminalAsciiKey(byte, &key, &mods)) {
+        CTUI_pushTerminalKey(console, key, mods);
+      }
+      break;
+    case CTUI_INPUT_CONTROL:
+      CTUI_getTerminalControlKey(byte, &key, &mods);
+      CTUI_pushTerminalKey(console, key, mods);
+      break;
+    case CTUI_INPUT_ALT_PRINT:
+      if (CTUI_getTerminalAsciiKey(byte, &key, &mods)) {
+        CTUI_pushTerminalKey(console, key, mods | CTUIM_ALT);
+      }
+      break;
+    case CTUI_INPUT_ALT_CONTROL:
+      CTUI_getTerminalControlKey(byte, &key, &mods);
+      CTUI_pushTerminalKey(console, key, mods | CTUIM_ALT);
+      break;
+    case CTUI_INPUT_ESCAPE_KEY:
+      CTUI_pushTerminalKey(console, CTUIK_ESCAPE, 0);
+      break;
+    case CTUI_INPUT_CLEAR:
+      input->private_marker = 0;
+      input->intermediate = 0;
+      input->param_count = 0;
+      break;
+    case CTUI_INPUT_PARAM:
+      if (byte >= '0' && byte <= '9') {
+        if (input->param_count == 0) {
+          input->param_count = 1;
+          input->params[0] = 0;
+        }
+        uint32_t *param = &input->params[input->param_count - 1];
+        *param = *param < 100000 ? *param * 10 + (byte - '0') : *param;
+      } else if (byte == ';' || byte == ':') {
+        if (input->param_count == 0) {
+          input->param_count = 1;
+          input->params[0] = 0;
+        }
+        if (input->param_count < CTUI_TERMINAL_MAX_INPUT_PARAMS) {
+          input->params[input->param_count++] = 0;
+        }
+      } else if (input->param_count == 0) {
+        input->private_marker = byte;
+      }
+      break;
+    case CTUI_INPUT_COLLECT:
+      input->intermediate = byte;
+      break;
+    case CTUI_INPUT_CSI_DISPATCH:
+      CTUI_dispatchInputCsi(terminal, byte);
+      break;
+    case CTUI_INPUT_SS3_DISPATCH:
+      CTUI_dispatchInputSs3(terminal, byte);
+      break;
+    default:
+      break;
+    }
+  }
+}
+
+static void CTUI_pollEventsTerminalConsole(CTUI_Console *console) {
+  CTUI_TerminalConsole *terminal = (CTUI_TerminalConsole *)console;
+  CTUI_SVector2 cells_wh;
+  if (CTUI_getTerminalSize(terminal->out_fd, &cells_wh) == 0 &&
+      (cells_wh.x != terminal->cells_wh.x ||
+       cells_wh.y != terminal->cells_wh.y)) {
+    CTUI_resizeTerminalConsole(terminal, cells_wh);
+  }
+  // VMIN = VTIME = 0, so reads return at once when no input is pending.
+  uint8_t bytes[4096];
+  ssize_t size;
+  int is_read = 0;
+  while ((size = read(terminal->in_fd, bytes, sizeof(bytes))) > 0) {
+    CTUI_parseTerminalInput(terminal, bytes, (size_t)size);
+    is_read = 1;
+  }
+  if (terminal->input.state != CTUI_INPUT_ESCAPE) {
+    return;
+  }
+  // Only an ESC enters the escape state, so it ended what was just read. A
+  // sequence can be split across reads, so the ESC is the Escape key only
+  // once nothing followed it for CTUI_TERMINAL_ESCAPE_TIMEOUT_NS.
+  const uint64_t now_ns = CTUI_getMonotonicNs();
+  if (is_read) {
+    terminal->escape_ns = now_ns;
+  } else if (now_ns - terminal->escape_ns >= CTUI_TERMINAL_ESCAPE_TIMEOUT_NS) {
+    terminal->input.state = CTUI_INPUT_GROUND;
+    CTUI_pushTerminalKey(console, CTUIK_ESCAPE, 0);
+  }
+}
+
+static uint64_t CTUI_getWaitTimeoutTerminal(CTUI_Console *console) {
+  CTUI_TerminalConsole *terminal = (CTUI_TerminalConsole *)console;
+  if (terminal->input.state != CTUI_INPUT_ESCAPE) {
+    return CTUI_WAIT_FOREVER;
+  }
+  const uint64_t elapsed_ns = CTUI_getMonotonicNs() - terminal->escape_ns;
+  return elapsed_ns < CTUI_TERMINAL_ESCAPE_TIMEOUT_NS
+             ? CTUI_TERMINAL_ESCAPE_TIMEOUT_NS - elapsed_ns
+             : 0;
+}
+
+static CTUI_DVector2 CTUI_getCursorTilePosTerminal(CTUI_Console *console) {
+  return ((CTUI_TerminalConsole *)console)->cursor_tile_pos;
+}
+
+static int CTUI_getMouseButtonTerminal(CTUI_Console *console, int button) {
+  CTUI_TerminalConsole *terminal = (CTUI_TerminalConsole *)console;
+  return button >= 0 && button < 32 && (terminal->mouse_buttons >> button) & 1;
+}
+
+static int CTUI_getWaitFdTerminal(CTUI_Console *console) {
+  CTUI_TerminalConsole *terminal = (CTUI_TerminalConsole *)console;
+  return terminal->in_fd;
+}
+
+static void CTUI_destroyTerminalConsole(CTUI_Console *console) {
+  CTUI_TerminalConsole *terminal = (CTUI_TerminalConsole *)console;
+  terminal->out_size = 0;
+  CTUI_appendTerminalCstr(terminal, "\x1b[?1006l\x1b[?1003l\x1b[0m\x1b[?25h"
+                                    "\x1b[?1049l");
+  CTUI_writeTerminalOut(terminal);
+  if (terminal->is_termios_saved) {
+    tcsetattr(terminal->in_fd, TCSAFLUSH, &terminal->saved_termios);
+  }
+  sigaction(SIGWINCH, &terminal->saved_sigwinch, NULL);
+  CTUI_freeConsoleLayers(console);
+  CTUI_freeTerminalCells(terminal);
+  free(terminal->color_lut);
+  free(terminal->out);
+  free(terminal);
+}
+
+// Platform vtable
+static CTUI_PlatformVtable CTUI_PLATFORM_VTABLE_TERMINAL = {
+    // the terminal, not the application, decides the size
+    .is_resizable = 0,
+    .destroy = CTUI_destroyTerminalConsole,
+    .resize = NULL,
+    .refresh = CTUI_refreshTerminalConsole,
+    .pollEvents = CTUI_pollEventsTerminalConsole,
+    .getCursorViewportPos = CTUI_getCursorTilePosTerminal,
+    .getCursorTilePos = CTUI_getCursorTilePosTerminal,
+    .getMouseButton = CTUI_getMouseButtonTerminal,
+    .getWaitFd = CTUI_getWaitFdTerminal,
+    .getWaitTimeout = CTUI_getWaitTimeoutTerminal,
+    .layer_size = 0,
+    // Tiles go to the default dense layer grid.
+    .pushCodepoint = NULL,
+    .fill = NULL,
+    .pushCodepoints = NULL,
+};
+
+// Guesses the palette from COLORTERM and TERM, as terminals do not report it.
+static CTUI_ColorPalette CTUI_getDefaultTerminalPalette() {
+  const char *colorterm = getenv("COLORTERM");
+  if (colorterm != NULL && (strcmp(colorterm, "truecolor") == 0 ||
+                            strcmp(colorterm, "24bit") == 0)) {
+    return CTUI_COLOR_PALETTE_TRUECOLOR;
+  }
+  const char *term = getenv("TERM");
+  if (term != NULL && strstr(term, "256color") != NULL) {
+    return CTUI_COLOR_PALETTE_256;
+  }
+  return CTUI_COLOR_PALETTE_16;
+}
+
+// SIGWINCH is ignored by default, which would not interrupt a poll() in
+// CTUI_waitEvents; an empty handler does.
+static void CTUI_handleTerminalSigwinch(int signal_number) {
+  (void)signal_number;
+}
+
+CTUI_Console *CTUI_createTerminalConsoleFds(CTUI_Context *context, int in_fd,
+                                            int out_fd, size_t layer_count,
+                                            const CTUI_LayerInfo *layer_infos) {
+  CTUI_SVector2 cells_wh;
+  if (!isatty(in_fd) || CTUI_getTerminalSize(out_fd, &cells_wh) != 0) {
+    return NULL;
+  }
+  CTUI_TerminalConsole *terminal = calloc(1, sizeof(CTUI_TerminalConsole));
+  if (terminal == NULL) {
+    return NULL;
+  }
+  terminal->in_fd = in_fd;
+  terminal->out_fd = out_fd;
+
+  // Initialize console base
+  CTUI_Console *console = &terminal->base;
+  console->_platform = &CTUI_PLATFORM_VTABLE_TERMINAL;
+  console->_ctx = context;
+  console->_is_real_terminal = 1;
+  console->_console_tile_wh = cells_wh;
+  if (CTUI_allocTerminalCells(terminal, cells_wh) != 0 ||
+      CTUI_initConsoleLayers(console, layer_count, layer_infos) != 0) {
+    CTUI_freeTerminalCells(terminal);
+    free(terminal);
+    return NULL;
+  }
+  CTUI_setTerminalColorPalette(console, CTUI_getDefaultTerminalPalette(),
+                               CTUI_COLOR_METRIC_RGB);
+
+  // Raw mode, with non-blocking reads
+  if (tcgetattr(in_fd, &terminal->saved_termios) == 0) {
+    terminal->is_termios_saved = 1;
+    struct termios raw = terminal->saved_termios;
+    raw.c_iflag &= ~(IGNBRK | BRKINT | PARMRK | ISTRIP | INLCR | IGNCR |
+                     ICRNL | IXON);
+    raw.c_oflag &= ~OPOST;
+    raw.c_lflag &= ~(ECHO | ECHONL | ICANON | ISIG | IEXTEN);
+    raw.c_cflag &= ~(CSIZE | PARENB);
+    raw.c_cflag |= CS8;
+    raw.c_cc[VMIN] = 0;
+    raw.c_cc[VTIME] = 0;
+    tcsetattr(in_fd, TCSAFLUSH, &raw);
+  }
+  struct sigaction sigwinch = {0};
+  sigwinch.sa_handler = CTUI_handleTerminalSigwinch;
+  sigemptyset(&sigwinch.sa_mask);
+  sigaction(SIGWINCH, &sigwinch, &terminal->saved_sigwinch);
+
+  // alternate screen, hidden cursor, cleared, SGR mouse reports with motion,
+  // then ask for mode 2026
+  CTUI_appendTerminalCstr(terminal, "\x1b[?1049h\x1b[?25l\x1b[0m\x1b[2J"
+                                    "\x1b[?1003h\x1b[?1006h\x1b[?2026$p");
+  CTUI_writeTerminalOut(terminal);
+
+  // Link to context
+  if (context->_first_console != NULL) {
+    context->_first_console->_prev = console;
+  }
+  console->_next = context->_first_console;
+  context->_first_console = console;
+
+  return console;
+}
+
+CTUI_Console *CTUI_createTerminalConsole(CTUI_Context *context,
+                                         size_t layer_count,
+                                         const CTUI_LayerInfo *layer_infos) {
+  return CTUI_createTerminalConsoleFds(context, STDIN_FILENO, STDOUT_FILENO,
+                                       layer_count, layer_infos);
+}
+
+void CTUI_setTerminalSyncUpdate(CTUI_Console *console,
+                                CTUI_TerminalSyncUpdate sync_update) {
+  if (console->_platform != &CTUI_PLATFORM_VTABLE_TERMINAL) {
+    return;
+  }
+  ((CTUI_TerminalConsole *)console)->sync_update = sync_update;
+}
+
+CTUI_TerminalSyncUpdate
+CTUI_getTerminalSyncUpdate(const CTUI_Console *console) {
+  if (console->_platform != &CTUI_PLATFORM_VTABLE_TERMINAL) {
+    return CTUI_TERMINAL_SYNC_UPDATE_OFF;
+  }
+  return ((const CTUI_TerminalConsole *)console)->sync_update;
+}
+
+int CTUI_getTerminalSyncUpdateActive(const CTUI_Console *console) {
+  if (console->_platform != &CTUI_PLATFORM_VTABLE_TERMINAL) {
+    return 0;
+  }
+  return CTUI_getSyncUpdateActive((const CTUI_TerminalConsole *)console);
+}
+
+CTUI_TerminalStats CTUI_getTerminalStats(const CTUI_Console *console) {
+  if (console->_platform != &CTUI_PLATFORM_VTABLE_TERMINAL) {
+    return (CTUI_TerminalStats){0};
+  }
+  return ((const CTUI_TerminalConsole *)console)->stats;
+}
+
+int CTUI_setTerminalColorPalette(CTUI_Console *console,
+                                 CTUI_ColorPalette palette,
+                                 CTUI_ColorMetric metric) {
+  if (console->_platform != &CTUI_PLATFORM_VTABLE_TERMINAL) {
+    return -1;
+  }
+  CTUI_TerminalConsole *terminal = (CTUI_TerminalConsole *)console;
+  if (palette != CTUI_COLOR_PALETTE_TRUECOLOR) {
+    if (terminal->color_lut == NULL) {
+      terminal->color_lut = malloc(CTUI_COLOR_LUT_SIZE);
+      if (terminal->color_lut == NULL) {
+        return -1;
+      }
+    }
+    CTUI_buildColorLut(terminal->color_lut, palette, metric);
+  }
+  terminal->palette = palette;
+  terminal->is_redraw_pending = 1;
+  CTUI_invalidateTerminal(terminal);
+  return 0;
+}
+
+CTUI_ColorPalette CTUI_getTerminalColorPalette(const CTUI_Console *console) {
+  if (console->_platform != &CTUI_PLATFORM_VTABLE_TERMINAL) {
+    return CTUI_COLOR_PALETTE_TRUECOLOR;
+  }
+  return ((const CTUI_TerminalConsole *)console)->palette;
+}
+#else
+CTUI_Console *CTUI_createTerminalConsoleFds(CTUI_Context *context, int in_fd,
+                                            int out_fd, size_t layer_count,
+                                            const CTUI_LayerInfo *layer_infos) {
+  (void)context;
+  (void)in_fd;
+  (void)out_fd;
+  (void)layer_count;
+  (void)layer_infos;
+  return NULL;
+}
+
+CTUI_Console *CTUI_createTerminalConsole(CTUI_Context *context,
+                                         size_t layer_count,
+                                         const CTUI_LayerInfo *layer_infos) {
+  return CTUI_createTerminalConsoleFds(context, 0, 1, layer_count,
+                                       layer_infos);
+}
+
+void CTUI_setTerminalSyncUpdate(CTUI_Console *console,
+                                CTUI_TerminalSyncUpdate sync_update) {
+  (void)console;
+  (void)sync_update;
+}
+
+CTUI_TerminalSyncUpdate
+CTUI_getTerminalSyncUpdate(const CTUI_Console *console) {
+  (void)console;
+  return CTUI_TERMINAL_SYNC_UPDATE_OFF;
+}
+
+int CTUI_getTerminalSyncUpdateActive(const CTUI_Console *console) {
+  (void)console;
+  return 0;
+}
+
+CTUI_TerminalStats CTUI_getTerminalStats(const CTUI_Console *console) {
+  (void)console;
+  return (CTUI_TerminalStats){0};
+}
+
+int CTUI_setTerminalColorPalette(CTUI_Console *console,
+                                 CTUI_ColorPalette palette,
+                                 CTUI_ColorMetric metric) {
+  (void)console;
+  (void)palette;
+  (void)metric;
+  return -1;
+}
+
+CTUI_ColorPalette CTUI_getTerminalColorPalette(const CTUI_Console *console) {
+  (void)console;
+  return CTUI_COLOR_PALETTE_TRUECOLOR;
+}
+#endif
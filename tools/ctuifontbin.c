@@ -0,0 +1,44 @@
+// Converts a .ctuifont and its atlas pages into a .ctuifontbin that
+// CTUI_createFont maps without decoding images or parsing glyph lines.
+//
+// usage: ctuifontbin <out.ctuifontbin> <in.ctuifont> <page.png>...
+
+#include <ctui/ctui.h>
+#include <stdio.h>
+
+int main(int argc, const char **argv) {
+  if (argc < 4) {
+    fprintf(stderr,
+            "usage: %s <out.ctuifontbin> <in.ctuifont> <page.png>...\n",
+            argv[0]);
+    return 1;
+  }
+  CTUI_Font *font = CTUI_createFont(argv[2], &argv[3], (size_t)(argc - 3));
+  if (font == NULL) {
+    fprintf(stderr, "%s: failed to load font %s\n", argv[0], argv[2]);
+    return 1;
+  }
+  if (CTUI_writeFontBin(font, argv[1]) != 0) {
+    CTUI_destroyFont(font);
+    fprintf(stderr, "%s: failed to write %s\n", argv[0], argv[1]);
+    return 1;
+  }
+  // Load the output back so a file the loader rejects is never shipped.
+  CTUI_Font *bin_font = CTUI_createFont(argv[1], NULL, 0);
+  const int is_same =
+      bin_font != NULL &&
+      CTUI_getFontImageWidth(bin_font) == CTUI_getFontImageWidth(font) &&
+      CTUI_getFontImageHeight(bin_font) == CTUI_getFontImageHeight(font) &&
+      CTUI_getFontImagePages(bin_font) == CTUI_getFontImagePages(font) &&
+      CTUI_getGlyphTableStats(bin_font).glyph_count ==
+          CTUI_getGlyphTableStats(font).glyph_count;
+  if (bin_font != NULL) {
+    CTUI_destroyFont(bin_font);
+  }
+  CTUI_destroyFont(font);
+  if (!is_same) {
+    fprintf(stderr, "%s: failed to load back %s\n", argv[0], argv[1]);
+    return 1;
+  }
+  return 0;
+}